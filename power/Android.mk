@@ -14,6 +14,31 @@
 
 LOCAL_PATH := $(call my-dir)
 
+power_hal_src_files := \
+    boost_adapt.c \
+    clock.c \
+    common.c \
+    sprd_power.c \
+    config.c \
+    devfreq.c \
+    cpufreq.c \
+    hint_class.c \
+    hint_ring.c \
+    hint_server.c \
+    hint_trace.c \
+    input_boost.c \
+    lockstat.c \
+    pm_qos.c \
+    psi_monitor.c \
+    recorder.c \
+    residency.c \
+    stats.c \
+    thread_sched.c \
+    trace.c \
+    utils.c \
+    vfs.c \
+    write_latency.c
+
 # HAL module implemenation stored in
 # hw/<POWERS_HARDWARE_MODULE_ID>.<ro.hardware>.so
 include $(CLEAR_VARS)
@@ -21,14 +46,7 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := power.sprd
 LOCAL_MODULE_TAGS := optional
 
-LOCAL_SRC_FILES := \
-    common.c \
-    sprd_power.c \
-    config.c \
-    devfreq.c \
-    cpufreq.c \
-    pm_qos.c \
-    utils.c
+LOCAL_SRC_FILES := $(power_hal_src_files)
 
 LOCAL_REQUIRED_MODULES := \
     power_scene_config.xml \
@@ -54,6 +72,122 @@ endif
 
 include $(BUILD_SHARED_LIBRARY)
 
+# The HAL core for the host, runs against a fake node tree (host/fakefs.h)
+# with host/include standing in for libcutils, liblog and libhardware.
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := libpowerhint_host
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := \
+    $(power_hal_src_files) \
+    host/fakefs.c \
+    host/properties.c
+
+LOCAL_STATIC_LIBRARIES := \
+    libxml2
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/host/include \
+    external/libxml2/include
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/host/include
+
+LOCAL_CFLAGS := -DDEBUG=0 -DDEBUG_V=0 -DPOWER_HOST
+LOCAL_CFLAGS += -DBOOST_SPECIFICED
+LOCAL_LDLIBS := -lrt -lpthread
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+
+# Benchmark of the hint engine, e.g.
+#   powerhint_bench -o result.json device/.../power/config_files/sharkl3
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := powerhint_bench
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := host/powerhint_bench.c
+
+LOCAL_STATIC_LIBRARIES := \
+    libpowerhint_host \
+    libxml2
+
+LOCAL_CFLAGS := -DDEBUG=0 -DDEBUG_V=0 -DPOWER_HOST
+LOCAL_LDLIBS := -lrt -lpthread
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Contention stress of the HAL entry points with a pm->lock profile
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := powerhint_stress
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := host/powerhint_stress.c
+
+LOCAL_STATIC_LIBRARIES := \
+    libpowerhint_host \
+    libxml2
+
+LOCAL_CFLAGS := -DDEBUG=0 -DDEBUG_V=0 -DPOWER_HOST
+LOCAL_LDLIBS := -lrt -lpthread
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Replay of a hint trace recorded with persist.vendor.power.hint_trace=1
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := powerhint_replay
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := host/powerhint_replay.c
+
+LOCAL_STATIC_LIBRARIES := \
+    libpowerhint_host \
+    libxml2
+
+LOCAL_CFLAGS := -DDEBUG=0 -DDEBUG_V=0 -DPOWER_HOST
+LOCAL_LDLIBS := -lrt -lpthread
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Scene verification of a config, the host side of test/powerhint_test.py
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := powerhint_verify
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := host/powerhint_verify.c
+
+LOCAL_STATIC_LIBRARIES := \
+    libpowerhint_host \
+    libxml2
+
+LOCAL_CFLAGS := -DDEBUG=0 -DDEBUG_V=0 -DPOWER_HOST
+LOCAL_LDLIBS := -lrt -lpthread
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Energy estimate of scene configs over a hint trace, e.g.
+#   powerhint_energy opp_sharkl3.txt hint_trace.bin config_a config_b
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := powerhint_energy
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := host/powerhint_energy.c
+
+LOCAL_STATIC_LIBRARIES := \
+    libpowerhint_host \
+    libxml2
+
+LOCAL_CFLAGS := -DDEBUG=0 -DDEBUG_V=0 -DPOWER_HOST
+LOCAL_LDLIBS := -lrt -lpthread
+
+include $(BUILD_HOST_EXECUTABLE)
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := power_scene_config.xml
 LOCAL_MODULE_CLASS := ETC
@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "boost_adapt.h"
+#include "clock.h"
+#include "common.h"
+#include "sprd_power.h"
+#include "utils.h"
+#include "vfs.h"
+
+bool boost_adapt = false;
+
+static const char *type_names[BOOST_ADAPT_MAX] = {
+    [BOOST_ADAPT_INTERACTION] = "interaction",
+    [BOOST_ADAPT_LAUNCH] = "launch",
+};
+
+static struct boost_adapt_type types[BOOST_ADAPT_MAX];
+// Guards types[] and the state below, interaction hints come in concurrently
+static pthread_mutex_t adapt_lock = PTHREAD_MUTEX_INITIALIZER;
+static int64_t last_flush_ns = 0;
+
+// The last interaction hint and when its boost ends under either policy
+static int64_t interaction_ns = 0;
+static int64_t fixed_until_ns = 0;
+static int64_t adaptive_until_ns = 0;
+
+// The launch in progress, 0 if none, and when the window ended it
+static int64_t launch_ns = 0;
+static int64_t launch_ended_ns = 0;
+
+// The last /proc/stat sample
+static unsigned long long cpu_busy = 0;
+static unsigned long long cpu_total = 0;
+static int64_t cpu_sample_ns = 0;
+static int cpu_busy_pct = -1;
+
+/*
+ * The load of all CPUs since the last sample, read at most every
+ * BOOST_ADAPT_LOAD_INTERVAL_MS
+ * return: the busy percentage, -1 if unknown
+ */
+static int read_cpu_busy(int64_t now)
+{
+    char buf[256] = {'\0'};
+    unsigned long long v[8] = {0};
+    unsigned long long busy = 0;
+    unsigned long long total = 0;
+
+    if (cpu_sample_ns != 0 && now - cpu_sample_ns < BOOST_ADAPT_LOAD_INTERVAL_MS * MS_TO_NS)
+        return cpu_busy_pct;
+
+    if (sprd_read(PATH_PROC_STAT, buf, sizeof(buf)) != 0
+        || sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu %llu"
+            , &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) != 8) {
+        cpu_sample_ns = now;
+        cpu_busy_pct = -1;
+        cpu_total = 0;
+        return -1;
+    }
+
+    for (int i = 0; i < 8; i++)
+        total += v[i];
+    // Not idle nor iowait
+    busy = total - v[3] - v[4];
+    cpu_busy_pct = (cpu_total != 0 && total > cpu_total)
+        ? (int)((busy - cpu_busy) * 100 / (total - cpu_total)): -1;
+    cpu_busy = busy;
+    cpu_total = total;
+    cpu_sample_ns = now;
+
+    return cpu_busy_pct;
+}
+
+// Add a length, halving the old ones once there are BOOST_ADAPT_SAMPLES_MAX
+static void learn(struct boost_adapt_type *type, int64_t length_ns)
+{
+    struct hist *hist = &type->lengths;
+
+    if (hist->count >= BOOST_ADAPT_SAMPLES_MAX) {
+        hist->count = 0;
+        for (int i = 0; i < NUM_HIST_BUCKET; i++) {
+            hist->buckets[i] /= 2;
+            hist->count += hist->buckets[i];
+        }
+        hist->sum_us /= 2;
+    }
+    hist_add(hist, length_ns / MS_TO_US);
+}
+
+/*
+ * The window covering BOOST_ADAPT_PERCENTILE of the lengths of @type
+ * within [BOOST_ADAPT_WINDOW_MIN_MS, @max_ms], or 0 if too few are known
+ */
+static int window_ms(struct boost_adapt_type *type, int max_ms)
+{
+    uint64_t ms = 0;
+
+    if (type->lengths.count < BOOST_ADAPT_SAMPLES_MIN) {
+        type->window_ms = 0;
+        return 0;
+    }
+
+    ms = (hist_percentile(&type->lengths, BOOST_ADAPT_PERCENTILE) + MS_TO_US - 1) / MS_TO_US;
+    if (ms < BOOST_ADAPT_WINDOW_MIN_MS)
+        ms = BOOST_ADAPT_WINDOW_MIN_MS;
+    if (ms > (uint64_t)max_ms)
+        ms = max_ms;
+    type->window_ms = (int)ms;
+
+    return type->window_ms;
+}
+
+// The time boosting @ms from @now adds to the boost ending at @until
+static uint64_t extend(int64_t now, int ms, int64_t *until)
+{
+    int64_t end = now + ms * MS_TO_NS;
+    int64_t start = (*until > now)? *until: now;
+
+    if (end <= start)
+        return 0;
+
+    *until = end;
+    return (end - start) / MS_TO_NS;
+}
+
+// Saves the lengths on the timer thread, off the hint path and the HAL lock
+static timer_t flush_timer;
+
+static void flush_timeout(void)
+{
+    boost_adapt_flush_file();
+}
+
+static void flush_if_due(int64_t now)
+{
+    int64_t last = __atomic_load_n(&last_flush_ns, __ATOMIC_RELAXED);
+
+    if (now - last > BOOST_ADAPT_FLUSH_INTERVAL_MS * MS_TO_NS
+        && __atomic_compare_exchange_n(&last_flush_ns, &last, now, false
+            , __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        sprd_timer_settime(flush_timer, 1);
+}
+
+/**
+ * boost_adapt_interaction - the boost window of an interaction hint
+ * @duration: the window of the fixed policy in ms
+ * return: the window to boost for in ms
+ */
+int boost_adapt_interaction(int duration)
+{
+    struct boost_adapt_type *type = &types[BOOST_ADAPT_INTERACTION];
+    int64_t now = clock_monotonic_ns();
+    int window = duration;
+    int learned = 0;
+
+    if (CC_LIKELY(!boost_adapt))
+        return duration;
+
+    pthread_mutex_lock(&adapt_lock);
+    // A hint the fixed window covers continues the burst
+    if (interaction_ns != 0 && now - interaction_ns < BOOST_DURATION_MAX * MS_TO_NS) {
+        learn(type, now - interaction_ns);
+        if (now >= adaptive_until_ns && now < fixed_until_ns)
+            type->misses++;
+    }
+    interaction_ns = now;
+
+    learned = window_ms(type, duration);
+    if (learned > 0 && read_cpu_busy(now) < BOOST_ADAPT_BUSY_PCT)
+        window = learned;
+
+    type->fixed_ms += extend(now, duration, &fixed_until_ns);
+    type->adaptive_ms += extend(now, window, &adaptive_until_ns);
+    pthread_mutex_unlock(&adapt_lock);
+
+    flush_if_due(now);
+    return window;
+}
+
+/**
+ * boost_adapt_launch - a launch starts or is released
+ * return: for a start, how long to boost before boost_adapt_launch_timeout()
+ *         in ms, 0 if the launch was already in progress
+ */
+int boost_adapt_launch(bool launch)
+{
+    struct boost_adapt_type *type = &types[BOOST_ADAPT_LAUNCH];
+    int64_t now = clock_monotonic_ns();
+    int window = 0;
+
+    if (CC_LIKELY(!boost_adapt))
+        return 0;
+
+    pthread_mutex_lock(&adapt_lock);
+    if (launch) {
+        if (launch_ns != 0 && launch_ended_ns == 0) {
+            pthread_mutex_unlock(&adapt_lock);
+            return 0;
+        }
+
+        // The release of the last launch never came, the fixed policy would boost still
+        if (launch_ns != 0) {
+            type->fixed_ms += (now - launch_ns) / MS_TO_NS;
+            type->adaptive_ms += (launch_ended_ns - launch_ns) / MS_TO_NS;
+        }
+        launch_ns = now;
+        launch_ended_ns = 0;
+        window = window_ms(type, BOOST_ADAPT_LAUNCH_MAX_MS);
+        if (window == 0)
+            window = BOOST_ADAPT_LAUNCH_MAX_MS;
+    } else if (launch_ns != 0) {
+        learn(type, now - launch_ns);
+        type->fixed_ms += (now - launch_ns) / MS_TO_NS;
+        type->adaptive_ms += (((launch_ended_ns != 0)? launch_ended_ns: now) - launch_ns) / MS_TO_NS;
+        launch_ns = 0;
+        launch_ended_ns = 0;
+    }
+    pthread_mutex_unlock(&adapt_lock);
+
+    flush_if_due(now);
+    return window;
+}
+
+/**
+ * boost_adapt_launch_timeout - the window of the launch in progress is over
+ * return: how much longer to boost in ms as the CPU is still busy, 0 to
+ *         end the launch boost, -1 if no launch is in progress
+ */
+int boost_adapt_launch_timeout(void)
+{
+    struct boost_adapt_type *type = &types[BOOST_ADAPT_LAUNCH];
+    int64_t now = clock_monotonic_ns();
+    int window = 0;
+
+    pthread_mutex_lock(&adapt_lock);
+    if (launch_ns == 0 || launch_ended_ns != 0) {
+        pthread_mutex_unlock(&adapt_lock);
+        return -1;
+    }
+
+    if (now - launch_ns < BOOST_ADAPT_LAUNCH_MAX_MS * MS_TO_NS
+        && read_cpu_busy(now) >= BOOST_ADAPT_BUSY_PCT) {
+        window = window_ms(type, BOOST_ADAPT_LAUNCH_MAX_MS);
+        if (window == 0 || now + window * MS_TO_NS > launch_ns + BOOST_ADAPT_LAUNCH_MAX_MS * MS_TO_NS)
+            window = BOOST_ADAPT_LAUNCH_MAX_MS - (now - launch_ns) / MS_TO_NS;
+        type->extended++;
+    } else {
+        launch_ended_ns = now;
+        type->ended++;
+    }
+    pthread_mutex_unlock(&adapt_lock);
+
+    return window;
+}
+
+const struct boost_adapt_type *boost_adapt_get(int type)
+{
+    return &types[type];
+}
+
+/*
+ * Load the lengths from PATH_BOOST_ADAPT,
+ * "lengths <type> <max_us> <sum_us> <bucket>:<count> ..." lines
+ */
+static void load_file(void)
+{
+    char line[2048] = {'\0'};
+    char name[16] = {'\0'};
+    struct hist *hist = NULL;
+    unsigned long long max_us = 0;
+    unsigned long long sum_us = 0;
+    unsigned int index = 0;
+    unsigned int count = 0;
+    char *tok = NULL;
+    char *save = NULL;
+    FILE *fp = NULL;
+
+    fp = vfs_fopen(PATH_BOOST_ADAPT, "r");
+    if (fp == NULL)
+        return;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "lengths %15s %llu %llu", name, &max_us, &sum_us) != 3)
+            continue;
+
+        hist = NULL;
+        for (int i = 0; i < BOOST_ADAPT_MAX; i++) {
+            if (strcmp(type_names[i], name) == 0)
+                hist = &types[i].lengths;
+        }
+        if (hist == NULL)
+            continue;
+
+        memset(hist, 0, sizeof(*hist));
+        hist->max_us = max_us;
+        hist->sum_us = sum_us;
+        strtok_r(line, " \n", &save);
+        strtok_r(NULL, " \n", &save);
+        strtok_r(NULL, " \n", &save);
+        strtok_r(NULL, " \n", &save);
+        while ((tok = strtok_r(NULL, " \n", &save)) != NULL) {
+            if (sscanf(tok, "%u:%u", &index, &count) != 2 || index >= NUM_HIST_BUCKET)
+                continue;
+            hist->buckets[index] = count;
+            hist->count += count;
+        }
+        ALOGD("Load %llu %s lengths", (unsigned long long)hist->count, name);
+    }
+    fclose(fp);
+}
+
+/**
+ * boost_adapt_init - load the learned lengths, called after config_read()
+ * and before start_thread_for_timing_request()
+ */
+void boost_adapt_init(void)
+{
+    memset(types, 0, sizeof(types));
+    interaction_ns = fixed_until_ns = adaptive_until_ns = 0;
+    launch_ns = launch_ended_ns = 0;
+    cpu_sample_ns = 0;
+    boost_adapt = property_get_int32(POWER_BOOST_ADAPT_PROP, 0) != 0;
+    last_flush_ns = clock_monotonic_ns();
+    load_file();
+    if (boost_adapt)
+        add_timing_timer(&flush_timer, flush_timeout);
+    ALOGD_IF(boost_adapt, "Power HAL adaptive boost enabled");
+}
+
+int boost_adapt_dump(int fd)
+{
+    struct boost_adapt_type copy[BOOST_ADAPT_MAX];
+    struct boost_adapt_type *type = NULL;
+
+    // Written from a copy, the hints don't wait for the file
+    pthread_mutex_lock(&adapt_lock);
+    memcpy(copy, types, sizeof(copy));
+    pthread_mutex_unlock(&adapt_lock);
+
+    dprintf(fd, "# Adaptive boost%s: type samples p50_ms p%d_ms window_ms fixed_ms adaptive_ms"
+        " saved_ms misses extended ended\n", boost_adapt? "": " (disabled)", BOOST_ADAPT_PERCENTILE);
+    for (int i = 0; i < BOOST_ADAPT_MAX; i++) {
+        type = &copy[i];
+        dprintf(fd, "%s %llu %llu %llu %d %llu %llu %lld %llu %llu %llu\n", type_names[i]
+            , (unsigned long long)type->lengths.count
+            , (unsigned long long)(hist_percentile(&type->lengths, 50) / MS_TO_US)
+            , (unsigned long long)(hist_percentile(&type->lengths, BOOST_ADAPT_PERCENTILE) / MS_TO_US)
+            , type->window_ms
+            , (unsigned long long)type->fixed_ms, (unsigned long long)type->adaptive_ms
+            , (long long)type->fixed_ms - (long long)type->adaptive_ms
+            , (unsigned long long)type->misses, (unsigned long long)type->extended
+            , (unsigned long long)type->ended);
+    }
+    for (int i = 0; i < BOOST_ADAPT_MAX; i++) {
+        type = &copy[i];
+        if (type->lengths.count == 0)
+            continue;
+
+        dprintf(fd, "lengths %s %llu %llu", type_names[i], (unsigned long long)type->lengths.max_us
+            , (unsigned long long)type->lengths.sum_us);
+        for (int j = 0; j < NUM_HIST_BUCKET; j++) {
+            if (type->lengths.buckets[j] != 0)
+                dprintf(fd, " %d:%u", j, type->lengths.buckets[j]);
+        }
+        dprintf(fd, "\n");
+    }
+
+    return 0;
+}
+
+/**
+ * boost_adapt_flush_file - save the learned lengths to PATH_BOOST_ADAPT
+ */
+void boost_adapt_flush_file(void)
+{
+    int fd = -1;
+
+    __atomic_store_n(&last_flush_ns, clock_monotonic_ns(), __ATOMIC_RELAXED);
+    fd = vfs_open(PATH_BOOST_ADAPT, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        ALOGD_IF(DEBUG_V, "open %s failed: %s", PATH_BOOST_ADAPT, strerror(errno));
+        return;
+    }
+    boost_adapt_dump(fd);
+    vfs_close(fd);
+}
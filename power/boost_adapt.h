@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INCLUDE_POWER_BOOST_ADAPT_H
+#define INCLUDE_POWER_BOOST_ADAPT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stats.h"
+
+#define POWER_BOOST_ADAPT_PROP            "persist.vendor.power.adaptive_boost"
+#define PATH_BOOST_ADAPT                  "/data/vendor/power/boost_adapt.txt"
+#define PATH_PROC_STAT                    "/proc/stat"
+#define BOOST_ADAPT_FLUSH_INTERVAL_MS     60000L
+
+// The learned window covers this percentile of the observed lengths
+#define BOOST_ADAPT_PERCENTILE            90
+// The fixed policy is kept until a type has this many samples
+#define BOOST_ADAPT_SAMPLES_MIN           16
+// Past this many samples the old ones are halved, so the window follows the usage
+#define BOOST_ADAPT_SAMPLES_MAX           512
+#define BOOST_ADAPT_WINDOW_MIN_MS         50
+// A launch whose release doesn't come is ended after at most this long
+#define BOOST_ADAPT_LAUNCH_MAX_MS         10000
+// The CPU is still busy with the interaction or launch above this load
+#define BOOST_ADAPT_BUSY_PCT              60
+#define BOOST_ADAPT_LOAD_INTERVAL_MS      20
+
+enum {
+    BOOST_ADAPT_INTERACTION = 0,
+    BOOST_ADAPT_LAUNCH,
+    BOOST_ADAPT_MAX,
+};
+
+/**
+ * struct boost_adapt_type - what is learned about one hint type
+ * @lengths: the observed lengths in microseconds, the gaps between the
+ *           interaction hints of a burst or the time from a launch to
+ *           its release
+ * @window_ms: the boost window in force, 0 while the fixed policy is
+ * @fixed_ms: time boosted under the fixed policy
+ * @adaptive_ms: time boosted under the learned windows
+ * @misses: interaction hints after their window ended that the fixed
+ *          window still covered
+ * @extended: launches kept boosted past the window because the CPU was busy
+ * @ended: launches ended by the window before their release came
+ */
+struct boost_adapt_type {
+    struct hist lengths;
+    int window_ms;
+    uint64_t fixed_ms;
+    uint64_t adaptive_ms;
+    uint64_t misses;
+    uint64_t extended;
+    uint64_t ended;
+};
+
+// Whether persist.vendor.power.adaptive_boost is set
+extern bool boost_adapt;
+
+/*
+ * With the adaptive mode the interaction boost lasts for the window
+ * covering BOOST_ADAPT_PERCENTILE of the gaps between the interaction
+ * hints of a burst, never longer than the requested duration, and the
+ * full duration while the CPU is busy. A launch boost ends after the
+ * window covering BOOST_ADAPT_PERCENTILE of the observed launch lengths
+ * unless the CPU is still busy, so a lost release doesn't keep it on.
+ * The lengths are saved to PATH_BOOST_ADAPT by the timer thread at most
+ * every BOOST_ADAPT_FLUSH_INTERVAL_MS and loaded at init. The boosted time of
+ * both policies is accounted for the dump.
+ *
+ * boost_adapt_launch() and boost_adapt_launch_timeout() are called with
+ * the HAL lock held exclusive, boost_adapt_interaction() with it shared.
+ */
+void boost_adapt_init(void);
+int boost_adapt_interaction(int duration);
+int boost_adapt_launch(bool launch);
+int boost_adapt_launch_timeout(void);
+const struct boost_adapt_type *boost_adapt_get(int type);
+int boost_adapt_dump(int fd);
+void boost_adapt_flush_file(void);
+
+/*
+ * boost_adapt_init() and, if enabled, the timer ending launches whose
+ * release doesn't come. Defined by sprd_power.c, called before
+ * start_thread_for_timing_request().
+ */
+void power_boost_adapt_init(void);
+#endif
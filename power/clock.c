@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include <cutils/compiler.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "clock.h"
+
+/**
+ * struct clock_timer - a timer of the virtual clock
+ * @timer_id: the timer id owned by the caller, handed to the expire handler
+ * @deadline_ns: when the timer expires, 0 if it is disarmed
+ */
+struct clock_timer {
+    timer_t *timer_id;
+    int64_t deadline_ns;
+};
+
+static bool virtual_clock = false;
+static int64_t virtual_now_ns = 0;
+static struct clock_timer timers[NUM_CLOCK_TIMER_MAX];
+static int timer_count = 0;
+static clock_expire_func_t expire_handler = NULL;
+
+void clock_monotonic(struct timespec *ts)
+{
+    if (CC_LIKELY(!virtual_clock)) {
+        clock_gettime(CLOCK_MONOTONIC, ts);
+        return;
+    }
+
+    ts->tv_sec = virtual_now_ns / 1000000000L;
+    ts->tv_nsec = virtual_now_ns % 1000000000L;
+}
+
+int64_t clock_monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_monotonic(&ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * clock_use_virtual - switch to a simulated clock starting at @start_ns
+ *
+ * A request whose end time is 0 has no duration, so the clock must not
+ * start at 0.
+ */
+void clock_use_virtual(int64_t start_ns)
+{
+    virtual_clock = true;
+    virtual_now_ns = (start_ns > 0)? start_ns: 1000000000LL;
+    memset(timers, 0, sizeof(timers));
+    timer_count = 0;
+}
+
+bool clock_is_virtual(void)
+{
+    return virtual_clock;
+}
+
+void clock_set_expire_handler(clock_expire_func_t expire)
+{
+    expire_handler = expire;
+}
+
+// The timer that expires first, the one created first on a tie
+static struct clock_timer *next_timer(void)
+{
+    struct clock_timer *next = NULL;
+
+    for (int i = 0; i < timer_count; i++) {
+        if (timers[i].deadline_ns == 0)
+            continue;
+        if (next == NULL || timers[i].deadline_ns < next->deadline_ns)
+            next = &timers[i];
+    }
+
+    return next;
+}
+
+/**
+ * clock_advance - move the virtual clock forward by @ns
+ *
+ * Each timer expiring on the way runs with the clock at its deadline,
+ * so a handler that re-arms a timer sees the same time a real one would.
+ */
+void clock_advance(int64_t ns)
+{
+    int64_t target = virtual_now_ns + ns;
+    struct clock_timer *timer = NULL;
+
+    if (!virtual_clock || ns < 0)
+        return;
+
+    while ((timer = next_timer()) != NULL && timer->deadline_ns <= target) {
+        virtual_now_ns = timer->deadline_ns;
+        timer->deadline_ns = 0;
+        if (expire_handler != NULL)
+            expire_handler(timer->timer_id);
+    }
+    virtual_now_ns = target;
+}
+
+/**
+ * clock_next_expiry_ns - the deadline of the next timer, 0 if none is armed
+ */
+int64_t clock_next_expiry_ns(void)
+{
+    struct clock_timer *timer = next_timer();
+
+    return (timer != NULL)? timer->deadline_ns: 0;
+}
+
+void clock_timer_create(timer_t *timer_id)
+{
+    if (timer_count >= NUM_CLOCK_TIMER_MAX) {
+        ALOGE("%s: too many timers", __func__);
+        return;
+    }
+
+    timers[timer_count].timer_id = timer_id;
+    timers[timer_count].deadline_ns = 0;
+    // The id is the index plus 1, 0 stays an invalid timer
+    *timer_id = (timer_t)(uintptr_t)(++timer_count);
+}
+
+/**
+ * clock_timer_settime - arm the timer to expire in @value_ms, disarm it if 0
+ */
+void clock_timer_settime(timer_t timer_id, long long value_ms)
+{
+    uintptr_t index = (uintptr_t)timer_id;
+
+    if (index == 0 || index > (uintptr_t)timer_count)
+        return;
+
+    timers[index - 1].deadline_ns = (value_ms > 0)? virtual_now_ns + value_ms * 1000000LL: 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INCLUDE_POWER_CLOCK_H
+#define INCLUDE_POWER_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define NUM_CLOCK_TIMER_MAX               128
+
+typedef void (*clock_expire_func_t)(timer_t *timer_id);
+
+/*
+ * The clock of all request timing. It is CLOCK_MONOTONIC with POSIX
+ * timers unless clock_use_virtual() is called before the HAL is
+ * initialized: time then only moves in clock_advance(), which runs
+ * every timer that expires on the way in deadline order. The virtual
+ * clock is meant for one driving thread, e.g. a host replay.
+ */
+void clock_monotonic(struct timespec *ts);
+int64_t clock_monotonic_ns(void);
+
+void clock_use_virtual(int64_t start_ns);
+bool clock_is_virtual(void);
+void clock_set_expire_handler(clock_expire_func_t expire);
+void clock_advance(int64_t ns);
+int64_t clock_next_expiry_ns(void);
+
+void clock_timer_create(timer_t *timer_id);
+void clock_timer_settime(timer_t timer_id, long long value_ms);
+#endif
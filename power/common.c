@@ -19,15 +19,26 @@
 #include "config.h"
 #include "devfreq.h"
 #include "pm_qos.h"
+#include "psi_monitor.h"
 #include "cpufreq.h"
 #include "utils.h"
 #include "hint_id.h"
+#include "lockstat.h"
+#include "stats.h"
+#include "thread_sched.h"
+#include "trace.h"
+#include "vfs.h"
+#include "write_latency.h"
 
 struct resources resources;
 
 struct mode *default_mode = NULL;
 struct mode *current_mode = NULL;
 int power_mode = POWER_HINT_VENDOR_MODE_NORMAL;
+// Bumped by clear_requests_for_all_file(), so on every mode switch too
+unsigned int clear_generation = 0;
+// The scene being applied by boost() on this thread, owner of the new requests
+__thread const char *boosting_scene = NULL;
 
 struct func compare_funcs[] = {
     {.name = FUNC_NAME(common_comp_ascend_order), .f = {.comp = &common_comp_ascend_order}},
@@ -109,6 +120,8 @@ int init_file(struct file_node *file_node)
     }
     file = &(path_file->files[path_file->count++]);
     strncpy(file->name, file_node->file, LEN_FILE_MAX);
+    file->id = resources.file_count++;
+    pthread_mutex_init(&(file->lock), NULL);
 
     if (file_node->clear == NULL) {
         file->clear = NULL;
@@ -173,20 +186,177 @@ int config_read()
     return 1;
 }
 
+/**
+ * expire_request_for_file - drop the elapsed requests of @file, called when its timer fires
+ */
+void expire_request_for_file(const char *path, struct file *file)
+{
+    flight_record(FR_EV_TIMEOUT, __func__, file->id, 0);
+    ALOGD_IF(DEBUG_V, "##Timing deboost");
+    memset(file->value.target_value, 0, LEN_VALUE_MAX);
+    file->set(0, 0, path, file);
+}
+
+// The files whose requests wait for apply_deferred_requests()
+static bool deferring = false;
+static struct boost_entry deferred[NUM_DEFERRED_FILE_MAX];
+static int deferred_count = 0;
+
+/**
+ * begin_deferred_requests - record the requests of the following boosts
+ * without writing any node until apply_deferred_requests()
+ */
+void begin_deferred_requests(void)
+{
+    deferring = true;
+    deferred_count = 0;
+}
+
+/**
+ * defer_request_for_file - called by a set function once the request is
+ * recorded, true if applying the requests of @file is deferred
+ */
+bool defer_request_for_file(const char *path, struct file *file)
+{
+    if (!deferring)
+        return false;
+
+    for (int i = 0; i < deferred_count; i++) {
+        if (deferred[i].file == file)
+            return true;
+    }
+
+    // Apply it right away rather than lose it
+    if (deferred_count >= NUM_DEFERRED_FILE_MAX)
+        return false;
+
+    deferred[deferred_count].path = (char *)path;
+    deferred[deferred_count++].file = file;
+    return true;
+}
+
+/**
+ * apply_deferred_requests - arbitrate every deferred file once and write
+ * its final value, the way an expired timer does
+ */
+void apply_deferred_requests(void)
+{
+    struct file *file = NULL;
+
+    deferring = false;
+    write_latency_sort(deferred, deferred_count);
+    for (int i = 0; i < deferred_count; i++) {
+        uint64_t writes = 0;
+        int64_t start = write_latency_begin(&writes);
+
+        file = deferred[i].file;
+        memset(file->value.target_value, 0, LEN_VALUE_MAX);
+        file->set(0, 0, deferred[i].path, file);
+        write_latency_end(file, start, writes);
+    }
+    deferred_count = 0;
+}
+
+// The module passed to start_thread_for_timing_request()
+static struct sprd_power_module *timing_pm = NULL;
+
+/**
+ * struct timing_timer - a timer other than the ones of the files
+ * @timer_id: created by the timer thread, armed by the owner
+ * @expire: called by the timer thread when it expires
+ */
+struct timing_timer {
+    timer_t *timer_id;
+    timing_expire_func_t expire;
+};
+
+static struct timing_timer timing_timers[NUM_TIMING_TIMER_MAX];
+static int timing_timer_count = 0;
+
+/**
+ * add_timing_timer - have the timer thread create and run @timer_id
+ *
+ * Must be called before start_thread_for_timing_request(). @expire takes
+ * the HAL lock itself.
+ * return: 0, or -ENOSPC if there are too many timers
+ */
+int add_timing_timer(timer_t *timer_id, timing_expire_func_t expire)
+{
+    for (int i = 0; i < timing_timer_count; i++) {
+        if (timing_timers[i].timer_id == timer_id)
+            return 0;
+    }
+
+    if (timing_timer_count >= NUM_TIMING_TIMER_MAX)
+        return -ENOSPC;
+
+    timing_timers[timing_timer_count].timer_id = timer_id;
+    timing_timers[timing_timer_count].expire = expire;
+    timing_timer_count++;
+
+    return 0;
+}
+
+// Expire the request of the file owning @timer_id
+static void handle_timeout(struct sprd_power_module *pm, void *timer_id)
+{
+    struct file *file = NULL;
+    struct stats_ctx ctx;
+    int64_t wake_ns = clock_monotonic_ns();
+    int64_t due_ns = 0;
+
+    for (int i = 0; i < timing_timer_count; i++) {
+        if (timer_id == timing_timers[i].timer_id) {
+            timing_timers[i].expire();
+            return;
+        }
+    }
+
+    for (int i = 0; i < resources.count; i++) {
+        for (int j = 0; j < resources.path_files[i].count; j++) {
+            file = &(resources.path_files[i].files[j]);
+            if (timer_id != &(file->timer_id))
+                continue;
+
+            ALOGD_IF(DEBUG_V, "Timeout deboost: %p bgn", file);
+            stats_begin(&ctx, STATS_SRC_TIMER, 0);
+            // Only the file expires, boosts of other files go on meanwhile
+            power_lock_shared(__func__);
+            pthread_mutex_lock(&(file->lock));
+            stats_locked(&ctx);
+            stats_set_scene("timeout");
+            TRACE_BEGIN("timeout %s/%s", resources.path_files[i].path, file->name);
+            due_ns = file->timer_due_ns;
+            expire_request_for_file(resources.path_files[i].path, file);
+            if (due_ns != 0)
+                thread_sched_timer_latency(due_ns, wake_ns, clock_monotonic_ns());
+            TRACE_END();
+            pthread_mutex_unlock(&(file->lock));
+            power_unlock();
+            stats_end(&ctx);
+            ALOGD_IF(DEBUG_V, "Timeout deboost: %p end", file);
+            return;
+        }
+    }
+}
+
+static void virtual_timer_expired(timer_t *timer_id)
+{
+    handle_timeout(timing_pm, timer_id);
+}
+
 // Handle request timeout
 static void *signal_handler(void *args)
 {
     struct sprd_power_module *pm = (struct sprd_power_module *)args;
     sigset_t sigset, old_sigset;
     struct file *file = NULL;
-    bool found = false;
     siginfo_t info;
-    int i = 0;
 
     if (CC_UNLIKELY(pm == NULL)) return NULL;
 
     prctl(PR_SET_NAME, "power_hint");
-    setpriority(PRIO_PROCESS, 0, getpriority(PRIO_PROCESS, 0) + 4);
+    thread_sched_apply(THREAD_TIMER);
 
     sigemptyset(&sigset);
 	sigaddset(&sigset, SIGALRM);
@@ -201,30 +371,13 @@ static void *signal_handler(void *args)
             sprd_timer_create(SIGALRM, &(file->timer_id), gettid());
         }
     }
+    for (int i = 0; i < timing_timer_count; i++)
+        sprd_timer_create(SIGALRM, timing_timers[i].timer_id, gettid());
 
     while (1) {
         if(sigwaitinfo(&sigset, &info) > 0) {
             ALOGD_IF(DEBUG_V, "%s: catch signo:%d, value=0x%lx", __func__, info.si_signo, *((long *)info.si_value.sival_ptr));
-
-            found = false;
-            for (int i = 0; i < resources.count; i++) {
-                for (int j = 0; j < resources.path_files[i].count; j++) {
-                    file = &(resources.path_files[i].files[j]);
-                    if (info.si_value.sival_ptr == &(file->timer_id)) {
-                        ALOGD_IF(DEBUG_V, "Timeout deboost: %p bgn", file);
-                        pthread_mutex_lock(&pm->lock);
-                        ALOGD("##Timing deboost");
-                        memset(file->value.target_value, 0, LEN_VALUE_MAX);
-                        file->set(0, 0, resources.path_files[i].path, file);
-                        pthread_mutex_unlock(&pm->lock);
-                        ALOGD_IF(DEBUG_V, "Timeout deboost: %p end", file);
-                        found = true;
-                        break;
-                    }
-                }
-
-                if (found) break;
-            }
+            handle_timeout(pm, info.si_value.sival_ptr);
         }
     }
 
@@ -233,12 +386,26 @@ static void *signal_handler(void *args)
 
 /**
  * start_thread_for_timing_request - create thread hanling the timeout signal
+ *
+ * With the virtual clock no thread is needed, timers expire in clock_advance().
  */
 void start_thread_for_timing_request(void *args)
 {
     pthread_t tid;
     pthread_attr_t attr;
 
+    timing_pm = (struct sprd_power_module *)args;
+    if (clock_is_virtual()) {
+        for (int i = 0; i < resources.count; i++) {
+            for (int j = 0; j < resources.path_files[i].count; j++)
+                sprd_timer_create(SIGALRM, &(resources.path_files[i].files[j].timer_id), 0);
+        }
+        for (int i = 0; i < timing_timer_count; i++)
+            sprd_timer_create(SIGALRM, timing_timers[i].timer_id, 0);
+        clock_set_expire_handler(virtual_timer_expired);
+        return;
+    }
+
     pthread_attr_init(&attr);
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
     if (pthread_create(&tid, &attr, &signal_handler, args) != 0) {
@@ -249,37 +416,88 @@ void start_thread_for_timing_request(void *args)
     pthread_attr_destroy(&attr);
 }
 
-// Get default value of files included by subsystem
-static int get_default_value_for_subsys()
+/*
+ * Read the default values of the inodes of @subsys once and reset their
+ * target values to them, with the lock of the subsys file held.
+ * return: true if a default value was read
+ */
+static bool subsys_default_to_target(struct subsys *subsys)
 {
     char buf[128] = {'\0'};
-    struct file *file = NULL;
-    bool log = false;
-    struct subsys *subsys = NULL;
     struct subsys_inode *inode = NULL;
+    bool read = false;
 
-    for (int i = 0; i < resources.subsys_count; i++) {
-        subsys = &(resources.subsystems[i]);
-        if (subsys->def_val_check)
-            continue;
-        for (int j = 0; j < subsys->inode_count; j++) {
-            inode = &(subsys->inodes[j]);
-            if (inode->no_has_def == 0) {
-                if (strlen(inode->value.def_value) == 0) {
-                    snprintf(buf, sizeof(buf), "%s/%s", inode->path, inode->file);
-                    if ((access(buf, F_OK|R_OK|W_OK) != 0) || get_string_default_value(buf, inode->value.def_value, LEN_VALUE_MAX) == 0) {
-                        ALOGD("!!!Get %s default value failed", buf);
-                        subsys->def_val_check = 1;
-                        break;
-                    } else {
-                        log = true;
-                    }
+    if (subsys->def_val_check)
+        return false;
+
+    for (int j = 0; j < subsys->inode_count; j++) {
+        inode = &(subsys->inodes[j]);
+        if (inode->no_has_def == 0) {
+            if (strlen(inode->value.def_value) == 0) {
+                snprintf(buf, sizeof(buf), "%s/%s", inode->path, inode->file);
+                if ((vfs_access(buf, F_OK|R_OK|W_OK) != 0) || get_string_default_value(buf, inode->value.def_value, LEN_VALUE_MAX) == 0) {
+                    ALOGD("!!!Get %s default value failed", buf);
+                    subsys->def_val_check = 1;
+                    break;
+                } else {
+                    read = true;
+                }
+            }
+            strcpy(inode->value.target_value, inode->value.def_value);
+        } else {
+            memset(inode->value.target_value, 0, sizeof(LEN_VALUE_MAX));
+        }
+    }
+
+    return read;
+}
+
+/*
+ * Read the default value of @file once and reset its target value to
+ * it, with the lock of @file held.
+ * return: true if the default value was read
+ */
+static bool file_default_to_target(const char *path, struct file *file)
+{
+    char buf[128] = {'\0'};
+    bool read = false;
+
+    if (file->def_val_check)
+        return false;
+
+    snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
+    if (file->no_has_def == 0) {
+        if (strlen(file->value.def_value) == 0) {
+            if (strncmp(path, "subsys", 6) != 0) {
+                if((vfs_access(buf, F_OK|R_OK|W_OK) != 0) || (get_string_default_value(buf, file->value.def_value, LEN_VALUE_MAX) == 0)) {
+                    ALOGE("!!!Get %s default value failed", buf);
+                    file->def_val_check = 1;
+                    return false;
+                } else {
+                    read = true;
                 }
-                strcpy(inode->value.target_value, inode->value.def_value);
             } else {
-                memset(inode->value.target_value, 0, sizeof(LEN_VALUE_MAX));
+                ALOGE("!!!Must specific the default value for subsys %s file node", file->name);
             }
         }
+        strcpy(file->value.target_value, file->value.def_value);
+    } else {
+        memset(file->value.target_value, 0, sizeof(LEN_VALUE_MAX));
+    }
+
+    return read;
+}
+
+// Get default value of files included by subsystem
+static int get_default_value_for_subsys()
+{
+    bool log = false;
+    struct subsys *subsys = NULL;
+    struct subsys_inode *inode = NULL;
+
+    for (int i = 0; i < resources.subsys_count; i++) {
+        if (subsys_default_to_target(&(resources.subsystems[i])))
+            log = true;
     }
 
     if (log) {
@@ -301,34 +519,13 @@ static int get_default_value_for_subsys()
 
 static int get_or_set_default_value_to_target()
 {
-    char buf[128] = {'\0'};
     struct file *file = NULL;
     bool log = false;
 
     for (int i = 0; i < resources.count; i++) {
         for (int j = 0; j < resources.path_files[i].count; j++) {
-            file = &(resources.path_files[i].files[j]);
-            snprintf(buf, sizeof(buf), "%s/%s", resources.path_files[i].path, file->name);
-            if (file->def_val_check)
-                continue;
-            if (file->no_has_def == 0) {
-                if (strlen(file->value.def_value) == 0) {
-                    if (strncmp(resources.path_files[i].path, "subsys", 6) != 0) {
-                        if((access(buf, F_OK|R_OK|W_OK) != 0) || (get_string_default_value(buf, file->value.def_value, LEN_VALUE_MAX) == 0)) {
-                            ALOGE("!!!Get %s default value failed", buf);
-                            file->def_val_check = 1;
-                            continue;
-                        } else {
-                            log = true;
-                        }
-                    } else {
-                        ALOGE("!!!Must specific the default value for subsys %s file node", file->name);
-                    }
-                }
-                strcpy(file->value.target_value, file->value.def_value);
-            } else {
-                memset(file->value.target_value, 0, sizeof(LEN_VALUE_MAX));
-            }
+            if (file_default_to_target(resources.path_files[i].path, &(resources.path_files[i].files[j])))
+                log = true;
         }
     }
 
@@ -349,20 +546,135 @@ static int get_or_set_default_value_to_target()
     return 1;
 }
 
+// Whether the first boost has read the default value of every file
+static bool defaults_read = false;
+
+/**
+ * resource_defaults_read - whether boost() may run with the HAL lock held shared
+ *
+ * The first boost reads the default value of every resource file, that
+ * needs the HAL lock held exclusive.
+ */
+bool resource_defaults_read(void)
+{
+    return __atomic_load_n(&defaults_read, __ATOMIC_ACQUIRE);
+}
+
+#ifdef BOOST_SPECIFICED
+/*
+ * Lock the files of @entries in ascending file id, the lock order of
+ * resource files, skipping the files listed twice. @files returns them
+ * in that order for unlock_files().
+ * return: the number of files locked
+ */
+static int lock_files(const struct boost_entry *entries, int count, struct file **files)
+{
+    struct file *file = NULL;
+    int64_t start = 0;
+    int locked = 0;
+    int j = 0;
+
+    for (int i = 0; i < count; i++) {
+        file = entries[i].file;
+        for (j = locked - 1; j >= 0 && files[j]->id > file->id; j--)
+            ;
+        if (j >= 0 && files[j] == file)
+            continue;
+
+        memmove(&files[j + 2], &files[j + 1], (locked - j - 1) * sizeof(files[0]));
+        files[j + 1] = file;
+        locked++;
+    }
+
+    for (int i = 0; i < locked; i++) {
+        if (pthread_mutex_trylock(&(files[i]->lock)) == 0)
+            continue;
+
+        start = stats_now_ns();
+        pthread_mutex_lock(&(files[i]->lock));
+        lock_profile_file_wait((stats_now_ns() - start) / MS_TO_US);
+    }
+
+    return locked;
+}
+
+static void unlock_files(struct file **files, int count)
+{
+    for (int i = count - 1; i >= 0; i--)
+        pthread_mutex_unlock(&(files[i]->lock));
+}
+#endif
+
 static int _boost(const struct scene *scene, int enable, int data)
 {
-    struct path_file *path_file = NULL;
+    const struct set_entry *entry = NULL;
     struct file *file = NULL;
-    struct set *set = NULL;
-    struct subsys *subsys = NULL;
-    bool found = false;
 #ifdef BOOST_SPECIFICED
-    struct boost_entry boost_entrys[NUM_RESOURCE_MAX];
+    struct boost_entry boost_entrys[NUM_FILE_MAX];
+    struct file *locked_files[NUM_FILE_MAX];
+    int locked = 0;
     int count = 0;
+    int ret = 0;
 
     memset(boost_entrys, 0, sizeof(boost_entrys));
-#endif
 
+    for (int i = 0; i < scene->count; i++) {
+        entry = scene_set_entry(scene, i);
+        if (entry->file == NULL) {
+            ALOGE("!!!Undefined resource %s/%s", entry->set.path, entry->set.file);
+            return 0;
+        }
+        boost_entrys[count].path = entry->path_file->path;
+        boost_entrys[count++].file = entry->file;
+    }
+
+    if (CC_UNLIKELY(!defaults_read)) {
+        get_or_set_default_value_to_target();
+        get_default_value_for_subsys();
+        __atomic_store_n(&defaults_read, true, __ATOMIC_RELEASE);
+    }
+
+    // Maybe the scene don't hava set node
+    if (count == 0) return 0;
+
+    // The files are the scene's from their target values to the last write
+    locked = lock_files(boost_entrys, count, locked_files);
+    for (int i = 0; i < scene->count; i++) {
+        entry = scene_set_entry(scene, i);
+        file = entry->file;
+        file_default_to_target(entry->path_file->path, file);
+        if (entry->subsys != NULL)
+            subsys_default_to_target(entry->subsys);
+
+        if (strncmp(entry->path_file->path, "subsys", 6) != 0) {
+            if (file->def_val_check) {
+                ALOGE("!!!default value check failed");
+                goto out;
+            }
+        } else if (entry->subsys != NULL && entry->subsys->def_val_check) {
+            ALOGE("!!!subsys default value check failed");
+            goto out;
+        }
+        strncpy(file->value.target_value, entry->set.value, LEN_VALUE_MAX);
+    }
+
+    TRACE_BEGIN("_boost %s enable=%d data=%d", scene->name, enable, data);
+    write_latency_sort(boost_entrys, count);
+    for (int i = 0; i < count; i++) {
+        uint64_t writes = 0;
+        int64_t start = write_latency_begin(&writes);
+
+        file = boost_entrys[i].file;
+        file->set(enable, data, boost_entrys[i].path, file);
+        write_latency_end(file, start, writes);
+    }
+    TRACE_END();
+    ret = 1;
+
+out:
+    unlock_files(locked_files, locked);
+    return ret;
+#else
     if (get_or_set_default_value_to_target() == 0)
         return 0;
 
@@ -370,61 +682,29 @@ static int _boost(const struct scene *scene, int enable, int data)
         return 0;
 
     for (int i = 0; i < scene->count; i++) {
-        found = false;
-        set = &(scene->sets[i]);
-        for (int j = 0; j < resources.count; j++) {
-            if (strcmp(set->path, resources.path_files[j].path) == 0) {
-                path_file = &(resources.path_files[j]);
-                for (int k = 0; k < path_file->count; k++) {
-                    if (strcmp(set->file, path_file->files[k].name) == 0) {
-                        file = &(path_file->files[k]);
-                        if (strncmp(path_file->path, "subsys", 6) != 0) {
-                            if (file->def_val_check) {
-                                ALOGE("!!!default value check failed");
-                                return 0;
-                            }
-                        } else {
-                            for (int g = 0; g < resources.subsys_count; g++) {
-                                subsys = &(resources.subsystems[g]);
-                                if (strcmp(file->name, subsys->name) == 0) {
-                                    if (subsys->def_val_check) {
-                                        ALOGE("!!!subsys default value check failed");
-                                        return 0;
-                                    } else {
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                        strncpy(file->value.target_value, set->value, LEN_VALUE_MAX);
-                        found = true;
-#ifdef BOOST_SPECIFICED
-                        boost_entrys[count].path = path_file->path;
-                        boost_entrys[count++].file = file;
-#endif
-                        break;
-                    }
-                }
-            }
-            if (found)
-                break;
+        entry = scene_set_entry(scene, i);
+        file = entry->file;
+        if (file == NULL) {
+            ALOGE("!!!Undefined resource %s/%s", entry->set.path, entry->set.file);
+            return 0;
         }
 
-        if (!found) {
-            ALOGE("!!!Undefined resource %s/%s", set->path, set->file);
+        if (strncmp(entry->path_file->path, "subsys", 6) != 0) {
+            if (file->def_val_check) {
+                ALOGE("!!!default value check failed");
+                return 0;
+            }
+        } else if (entry->subsys != NULL && entry->subsys->def_val_check) {
+            ALOGE("!!!subsys default value check failed");
             return 0;
         }
+        strncpy(file->value.target_value, entry->set.value, LEN_VALUE_MAX);
     }
 
     // Maybe the scene don't hava set node
-    if (!found) return 0;
+    if (scene->count == 0) return 0;
 
-#ifdef BOOST_SPECIFICED
-    for (int i = 0; i < count; i++) {
-        file = boost_entrys[i].file;
-        file->set(enable, data, boost_entrys[i].path, file);
-    }
-#else
+    TRACE_BEGIN("_boost %s enable=%d data=%d", scene->name, enable, data);
     for (int i = 0; i < resources.count; i++) {
         for (int j = 0; j < resources.path_files[i].count; j++) {
             file = &(resources.path_files[i].files[j]);
@@ -432,9 +712,10 @@ static int _boost(const struct scene *scene, int enable, int data)
                 file->set(enable, data, resources.path_files[i].path, file);
         }
     }
-#endif
+    TRACE_END();
 
     return 1;
+#endif
 }
 
 /**
@@ -480,20 +761,45 @@ int boost(int scene_id, int subtype, int enable, int data)
     }
 
     if (scene->duration > 500) {
-        ALOGD("Use scene duration parameter");
+        ALOGD_IF(DEBUG_V, "Use scene duration parameter");
         data = scene->duration;
     }
 
+    psi_monitor_scene(scene, enable, data);
+    stats_set_scene(scene_name);
+    flight_record(enable? FR_EV_BOOST: FR_EV_DEBOOST, __func__, FR_NODE_NONE
+        , ((int64_t)scene_id << 32) | (uint32_t)data);
+    TRACE_BEGIN("boost %s %s", enable?"enter": "exit", scene_name);
     ALOGD_IF(DEBUG, "###%s %s scene bgn###", enable?"Enter": "Exit", scene_name);
+    boosting_scene = scene_name;
     _boost(scene, enable, data);
+    boosting_scene = NULL;
     ALOGD_IF(DEBUG, "###%s %s scene end###", enable?"Enter": "Exit", scene_name);
+    TRACE_END();
     return 1;
 }
 
+/**
+ * find_file_by_id - the resource file whose id is @id, NULL if none
+ */
+struct file *find_file_by_id(int id)
+{
+    for (int i = 0; i < resources.count; i++) {
+        for (int j = 0; j < resources.path_files[i].count; j++) {
+            if (resources.path_files[i].files[j].id == id)
+                return &(resources.path_files[i].files[j]);
+        }
+    }
+
+    return NULL;
+}
+
 void clear_requests_for_all_file()
 {
     struct file *file = NULL;
 
+    clear_generation++;
+
     for (int i = 0; i < resources.count; i++) {
         for (int j = 0; j < resources.path_files[i].count; j++) {
             file = &(resources.path_files[i].files[j]);
@@ -531,39 +837,176 @@ int update_mode(int mode, int enable)
     return 1;
 }
 
+/**
+ * file_value_base - the base of the values of a file, 16 for hex nodes
+ */
+int file_value_base(const struct file *file)
+{
+    if (file->comp == &common_comp_ascend_order_hex || file->comp == &common_comp_descend_order_hex)
+        return 16;
+
+    return 10;
+}
+
+/**
+ * req_value_parse - convert the string @str requested for @file to the value
+ * kept in struct req_item
+ *
+ * Subsys requests keep the index of the config in the low 32 bits and its
+ * priority in the high 32 bits, the config name stays in the subsys table.
+ * Other requests keep the number in the base of the node.
+ */
+int req_value_parse(const struct file *file, const char *str, int64_t *value)
+{
+    char *end = NULL;
+
+    if (file->comp == &common_subsys_comp) {
+        struct subsys *subsys = find_subsys_by_name((char *)file->name);
+
+        if (subsys == NULL) {
+            ALOGE("Don't support subsys %s", file->name);
+            return 0;
+        }
+
+        for (int i = 0; i < subsys->config_count; i++) {
+            if (strcmp(str, subsys->configs[i].name) == 0) {
+                *value = ((int64_t)subsys->configs[i].priority << 32) | (uint32_t)i;
+                return 1;
+            }
+        }
+
+        ALOGE("Don't find config: %s in %s subsys", str, subsys->name);
+        return 0;
+    }
+
+    *value = strtoll(str, &end, file_value_base(file));
+    if (end == str) {
+        ALOGE("Invalid value %s for %s", str, file->name);
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * req_value_format - the string to write for the request value @value of @file
+ */
+char *req_value_format(const struct file *file, int64_t value, char *buf, int size)
+{
+    if (file->comp == &common_subsys_comp) {
+        struct subsys *subsys = find_subsys_by_name((char *)file->name);
+        int index = (uint32_t)value;
+
+        if (subsys != NULL && index < subsys->config_count)
+            snprintf(buf, size, "%s", subsys->configs[index].name);
+        else
+            snprintf(buf, size, "%s", "");
+    } else if (file_value_base(file) == 16) {
+        snprintf(buf, size, "%llX", (unsigned long long)value);
+    } else {
+        snprintf(buf, size, "%lld", (long long)value);
+    }
+
+    return buf;
+}
+
+/**
+ * req_now_ms - the monotonic time in the 32-bit ms ticks of req_item deadlines
+ */
+uint32_t req_now_ms(void)
+{
+    return (uint32_t)(clock_monotonic_ns() / MS_TO_NS);
+}
+
+/**
+ * req_remaining_ms - the time left before the deadline of @item, 0 if it has none
+ */
+long long req_remaining_ms(const struct req_item *item)
+{
+    if (item->deadline == 0)
+        return 0;
+
+    // Wrap safe as long as durations stay below 24 days
+    return (int32_t)(item->deadline - req_now_ms());
+}
+
+/**
+ * req_arm_timer - arm the timer of @file to expire in @value_ms, 0 disarms it
+ *
+ * The deadline is kept so the timer thread can tell how late it ran.
+ */
+void req_arm_timer(struct file *file, long long value_ms)
+{
+    file->timer_due_ns = (value_ms > 0)? clock_monotonic_ns() + value_ms * MS_TO_NS: 0;
+    sprd_timer_settime(file->timer_id, value_ms);
+}
+
+/**
+ * req_dump - log all requests of @file, @name is the node
+ */
+void req_dump(const char *name, const struct file *file)
+{
+    char value[LEN_VALUE_MAX] = {'\0'};
+
+    ALOGD(">>>>>>>>>>>>>>>>>>>>");
+    ALOGD("%s:", name);
+    for (int i = 0; i < file->stat.count; i++) {
+        ALOGD("  value:%s, times:%d, remaining: %lldms"
+            , req_value_format(file, file->stat.items[i].value, value, sizeof(value))
+            , file->stat.items[i].times, req_remaining_ms(&(file->stat.items[i])));
+    }
+    ALOGD("<<<<<<<<<<<<<<<<<<<<");
+}
+
+/**
+ * req_set_current - make @item the request in force for @file
+ */
+void req_set_current(struct file *file, const struct req_item *item)
+{
+    char value[LEN_VALUE_MAX] = {'\0'};
+
+    memcpy(&(file->stat.current), item, sizeof(struct req_item));
+    residency_update(file, req_value_format(file, item->value, value, sizeof(value)), item->scene);
+}
+
+static int comp_value(int64_t a, int64_t b)
+{
+    return (a > b) - (a < b);
+}
+
 // The value bigger, the priority higher
 int common_comp_ascend_order(const void *a, const void *b)
 {
-    struct req_item  *aa = (struct req_item *)a;
-    struct req_item  *bb = (struct req_item *)b;
+    const struct req_item *aa = (const struct req_item *)a;
+    const struct req_item *bb = (const struct req_item *)b;
 
-    return (strtol(aa->value, NULL, 10) - strtol(bb->value, NULL, 10));
+    return comp_value(aa->value, bb->value);
 }
 
 // The value bigger, the priority lower
 int common_comp_descend_order(const void *a, const void *b)
 {
-    struct req_item  *aa = (struct req_item *)a;
-    struct req_item  *bb = (struct req_item *)b;
+    const struct req_item *aa = (const struct req_item *)a;
+    const struct req_item *bb = (const struct req_item *)b;
 
-    return (strtol(bb->value, NULL, 10) - strtol(aa->value, NULL, 10));
+    return comp_value(bb->value, aa->value);
 }
 
-// For hex value
+// For hex value, the values are parsed in base 16 by req_value_parse()
 int common_comp_ascend_order_hex(const void *a, const void *b)
 {
-    struct req_item  *aa = (struct req_item *)a;
-    struct req_item  *bb = (struct req_item *)b;
+    const struct req_item *aa = (const struct req_item *)a;
+    const struct req_item *bb = (const struct req_item *)b;
 
-    return (strtol(aa->value, NULL, 16) - strtol(bb->value, NULL, 16));
+    return comp_value(aa->value, bb->value);
 }
 
 int common_comp_descend_order_hex(const void *a, const void *b)
 {
-    struct req_item  *aa = (struct req_item *)a;
-    struct req_item  *bb = (struct req_item *)b;
+    const struct req_item *aa = (const struct req_item *)a;
+    const struct req_item *bb = (const struct req_item *)b;
 
-    return (strtol(bb->value, NULL, 16) - strtol(aa->value, NULL, 16));
+    return comp_value(bb->value, aa->value);
 }
 
 /**
@@ -574,15 +1017,17 @@ int common_clear(const char *path, struct file *file)
     if (path == NULL || file == NULL) return 0;
 
     ENTER();
-    sprd_timer_settime(file->timer_id, 0);
+    req_arm_timer(file, 0);
     memset(&(file->stat), 0, sizeof(struct request_stat));
+    residency_update(file, file->value.def_value, NULL);
 
     if (strlen(file->value.def_value) > 0) {
         char buf[128] = {'\0'};
 
         snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
-        if (access(buf, F_OK) == 0) {
+        if (vfs_access(buf, F_OK) == 0) {
             sprd_write(buf, file->value.def_value);
+            NODE_VALUE(buf, file, file->value.def_value, file_value_base(file));
             ALOGD_IF(DEBUG_D, "Set %s: %s", buf, file->value.def_value);
         }
     }
@@ -593,7 +1038,7 @@ int common_clear(const char *path, struct file *file)
 int common_set(int enable, int duration, const char *path, struct file *file)
 {
     char buf[128] = {'\0'};
-    struct timespec now;
+    char value[LEN_VALUE_MAX] = {'\0'};
     struct req_item *req_item = NULL;
     long long time_value;
 
@@ -603,21 +1048,13 @@ int common_set(int enable, int duration, const char *path, struct file *file)
     ENTER("enable:%d, duration: %d, %s/%s: %s", enable, duration, path, file->name
         , file->value.target_value);
 
-    memset(&now, 0, sizeof(now));
     snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
 
     sort_request_for_file(enable, duration, file);
-    if (DEBUG_V) {
-        char time[20] = {'\0'};
-        ALOGD(">>>>>>>>>>>>>>>>>>>>");
-        ALOGD("%s:", buf);
-        for (int i = 0; i < file->stat.count; i++) {
-            sprd_strftime(time, 20, file->stat.items[i].duration_end_time);
-            ALOGD("  value:%s, times:%d, end_time: %s", file->stat.items[i].value
-                , file->stat.items[i].times, time);
-        }
-        ALOGD("<<<<<<<<<<<<<<<<<<<<");
-    }
+    if (DEBUG_V)
+        req_dump(buf, file);
+    if (defer_request_for_file(path, file))
+        return 1;
 
     if (file->stat.count <= 0) {
         common_clear(path, file);
@@ -625,25 +1062,26 @@ int common_set(int enable, int duration, const char *path, struct file *file)
     }
 
     // Set timer if the highest priority request has duration time
-    clock_gettime(CLOCK_MONOTONIC, &now);
     req_item = &(file->stat.items[file->stat.count - 1]);
-    time_value = calc_timespan_ms(now, req_item->duration_end_time);
+    time_value = req_remaining_ms(req_item);
     if (time_value > 0) {
-        sprd_timer_settime(file->timer_id, time_value);
+        req_arm_timer(file, time_value);
     }
 
     // If the highest priority request is the same with
     // current, don't need send the request to driver
-    if(strlen(file->stat.current.value) != 0
+    if(file->stat.current.times != 0
         && file->comp((void *)req_item, (void *)(&(file->stat.current))) == 0)
         return 1;
 
     // Update current request
-    memcpy(&(file->stat.current), req_item, sizeof(struct req_item));
+    req_set_current(file, req_item);
 
-    if (access(buf, F_OK) == 0) {
-        ALOGD_IF(DEBUG_D, "Set %s: %s", buf, req_item->value);
-        sprd_write(buf, req_item->value);
+    if (vfs_access(buf, F_OK) == 0) {
+        req_value_format(file, req_item->value, value, sizeof(value));
+        ALOGD_IF(DEBUG_D, "Set %s: %s", buf, value);
+        sprd_write(buf, value);
+        NODE_VALUE(buf, file, value, file_value_base(file));
     }
 
     return 1;
@@ -664,38 +1102,12 @@ void *find_subsys_by_name(char *name)
     return NULL;
 }
 
-int add_priority_to_target_value(struct file *file)
-{
-    struct subsys *subsys = NULL;
-
-    if (file == NULL) return 0;
-
-    subsys = find_subsys_by_name(file->name);
-    if (subsys == NULL) {
-        ALOGE("Don't support subsys %s", file->name);
-        return 0;
-    }
-
-    for (int i = 0; i < subsys->config_count; i++) {
-        if (strcmp(file->value.target_value, subsys->configs[i].name) == 0) {
-            snprintf(file->value.target_value + strlen(file->value.target_value)
-                ,LEN_VALUE_MAX - strlen(file->value.target_value)
-                ,":%d", subsys->configs[i].priority);
-            return 1;
-        }
-    }
-
-    return 0;
-}
-
 static int common_subsys_set_current_config(struct file *file)
 {
     struct subsys *subsys = NULL;
     struct config *config = NULL;
     struct subsys_inode *inode = NULL;
-    char *conf_name = NULL;
-    int conf_name_len = 0;
-    char *ptr = NULL;
+    uint32_t index = 0;
     char buf[128] = {'\0'};
 
     ENTER();
@@ -707,21 +1119,13 @@ static int common_subsys_set_current_config(struct file *file)
         return 0;
     }
 
-    conf_name = file->stat.current.value;
-    ptr = strchr(file->stat.current.value, ':');
-    conf_name_len = ptr - conf_name;
-
-    for (int i = 0; i < subsys->config_count; i++) {
-        if (strncmp(conf_name, subsys->configs[i].name, conf_name_len) == 0) {
-            config = &(subsys->configs[i]);
-            break;
-        }
-    }
-
-    if (config == NULL) {
-        ALOGE("Don't find config: %s in %s subsys", conf_name, subsys->name);
+    // The config index is kept in the low 32 bits, see req_value_parse()
+    index = (uint32_t)file->stat.current.value;
+    if (index >= (uint32_t)subsys->config_count) {
+        ALOGE("Don't find config: %u in %s subsys", index, subsys->name);
         return 0;
     }
+    config = &(subsys->configs[index]);
 
     // Set target_value to def_value
     for (int j = 0; j < subsys->inode_count; j++) {
@@ -746,8 +1150,9 @@ static int common_subsys_set_current_config(struct file *file)
         inode = &(subsys->inodes[i]);
         if (strlen(inode->value.target_value) != 0) {
             snprintf(buf, sizeof(buf), "%s/%s", inode->path, inode->file);
-            if (access(buf, F_OK) == 0) {
+            if (vfs_access(buf, F_OK) == 0) {
                 sprd_write(buf, inode->value.target_value);
+                NODE_VALUE(buf, file, inode->value.target_value, 10);
                 ALOGD_IF(DEBUG_D, "Set %s: %s", buf, inode->value.target_value);
             }
         }
@@ -758,34 +1163,25 @@ static int common_subsys_set_current_config(struct file *file)
 
 int common_subsys_set(int enable, int duration, const char *path, struct file *file)
 {
-    struct timespec now;
     struct req_item *req_item = NULL;
+    int64_t value;
     long long time_value;
 
     if (CC_UNLIKELY(path == NULL || file == NULL))
         return 0;
 
-    if (strlen(file->value.target_value) != 0 && add_priority_to_target_value(file) == 0) {
-        ALOGE("Add priority for %s failed", file->value.target_value);
+    if (strlen(file->value.target_value) != 0
+        && req_value_parse(file, file->value.target_value, &value) == 0)
         return 0;
-    }
 
     ENTER("enable:%d, duration: %d, %s:%s: %s", enable, duration, path, file->name
         , file->value.target_value);
-    memset(&now, 0, sizeof(now));
 
     sort_request_for_file(enable, duration, file);
-    if (DEBUG_V) {
-        char time[20] = {'\0'};
-        ALOGD(">>>>>>>>>>>>>>>>>>>>");
-        ALOGD("%s:", file->name);
-        for (int i = 0; i < file->stat.count; i++) {
-            sprd_strftime(time, sizeof(time), file->stat.items[i].duration_end_time);
-            ALOGD("  value:%s, times:%d, end_time: %s", file->stat.items[i].value
-                , file->stat.items[i].times, time);
-        }
-        ALOGD("<<<<<<<<<<<<<<<<<<<<");
-    }
+    if (DEBUG_V)
+        req_dump(file->name, file);
+    if (defer_request_for_file(path, file))
+        return 1;
 
     if (file->stat.count <= 0) {
         common_subsys_clear(path, file);
@@ -793,22 +1189,21 @@ int common_subsys_set(int enable, int duration, const char *path, struct file *f
     }
 
     // Set timer if the highest priority request has duration time
-    clock_gettime(CLOCK_MONOTONIC, &now);
     req_item = &(file->stat.items[file->stat.count - 1]);
-    time_value = calc_timespan_ms(now, req_item->duration_end_time);
+    time_value = req_remaining_ms(req_item);
     if (time_value > 0) {
-        sprd_timer_settime(file->timer_id, time_value);
+        req_arm_timer(file, time_value);
     }
 
     // If the highest priority request is the same with
     // current, don't need send the request to driver
-    if(strlen(file->stat.current.value) != 0
+    if(file->stat.current.times != 0
         && file->comp((void *)req_item, (void *)(&(file->stat.current))) == 0)
         return 1;
 
     // Update current request
-    memcpy(&(file->stat.current), req_item, sizeof(struct req_item));
-    ALOGD_IF(DEBUG_V, "current value: %s", file->stat.current.value);
+    req_set_current(file, req_item);
+    ALOGD_IF(DEBUG_V, "current config: %u", (uint32_t)file->stat.current.value);
     common_subsys_set_current_config(file);
 
     return 1;
@@ -830,15 +1225,17 @@ int common_subsys_clear(const char *path, struct file *file)
         return 0;
     }
 
-    sprd_timer_settime(file->timer_id, 0);
+    req_arm_timer(file, 0);
     memset(&(file->stat), 0, sizeof(struct request_stat));
+    residency_update(file, file->value.def_value, NULL);
 
     for (int i = 0; i < subsys->inode_count; i++) {
         inode = &(subsys->inodes[i]);
         if (inode->no_has_def == 0) {
             snprintf(buf, sizeof(buf), "%s/%s", inode->path, inode->file);
-            if (access(buf, F_OK) == 0) {
+            if (vfs_access(buf, F_OK) == 0) {
                 sprd_write(buf, inode->value.def_value);
+                NODE_VALUE(buf, file, inode->value.def_value, 10);
                 ALOGD_IF(DEBUG_D, "Set %s: %s", buf, inode->value.def_value);
             }
         }
@@ -850,20 +1247,11 @@ int common_subsys_clear(const char *path, struct file *file)
 // used by qsort()
 int common_subsys_comp(const void *a, const void *b)
 {
-    struct req_item  *aa = (struct req_item *)a;
-    struct req_item  *bb = (struct req_item *)b;
-    int level_a = 0;
-    int level_b = 0;
-    // value: conf_num:level
-    char *aaa = strchr(aa->value, ':');
-    char *bbb = strchr(bb->value, ':');
-
-    if (aaa == NULL || bbb == NULL) {
-        ALOGE("Request item don't include priority");
-        return 0;
-    }
-    level_a = atoi(aaa + 1);
-    level_b = atoi(bbb + 1);
+    const struct req_item *aa = (const struct req_item *)a;
+    const struct req_item *bb = (const struct req_item *)b;
+    // value: level << 32 | conf index
+    int level_a = (int)(aa->value >> 32);
+    int level_b = (int)(bb->value >> 32);
 
     return level_a - level_b;
 }
@@ -877,11 +1265,19 @@ int common_clear_for_release_when_close(const char *path, struct file *file)
         return 0;
 
     if (file->fd > 0) {
-        close(file->fd);
+        vfs_close(file->fd);
         file->fd = -1;
+        flight_record(FR_EV_WRITE, __func__, file->id, 0);
+        if (TRACE_ENABLED()) {
+            char buf[128] = {'\0'};
+
+            snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
+            TRACE_COUNTER(buf, "0", 10);
+        }
     }
-    sprd_timer_settime(file->timer_id, 0);
+    req_arm_timer(file, 0);
     memset(&(file->stat), 0, sizeof(struct request_stat));
+    residency_update(file, file->value.def_value, NULL);
 
     return 1;
 }
@@ -889,7 +1285,7 @@ int common_clear_for_release_when_close(const char *path, struct file *file)
 int common_set_for_release_when_close(int enable, int duration,const char *path, struct file *file)
 {
     char buf[128] = {'\0'};
-    struct timespec now;
+    char value[LEN_VALUE_MAX] = {'\0'};
     struct req_item *req_item = NULL;
     long long time_value;
 
@@ -899,56 +1295,53 @@ int common_set_for_release_when_close(int enable, int duration,const char *path,
     ENTER("enable:%d, duration: %d, %s/%s: %s", enable, duration, path, file->name
         , file->value.target_value);
 
-    memset(&now, 0, sizeof(now));
     snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
 
     sort_request_for_file(enable, duration, file);
-    if (DEBUG_V) {
-        char time[20] = {'\0'};
-        ALOGD(">>>>>>>>>>>>>>>>>>>>");
-        ALOGD("%s:", buf);
-        for (int i = 0; i < file->stat.count; i++) {
-            sprd_strftime(time, sizeof(time), file->stat.items[i].duration_end_time);
-            ALOGD("  value:%s, times:%d, end_time: %s", file->stat.items[i].value
-                , file->stat.items[i].times, time);
-        }
-        ALOGD("<<<<<<<<<<<<<<<<<<<<");
-    }
+    if (DEBUG_V)
+        req_dump(buf, file);
+    if (defer_request_for_file(path, file))
+        return 1;
 
     if (file->stat.count <= 0) {
-        ALOGD("ALL %s requests has been handled", file->name);
+        ALOGD_IF(DEBUG_V, "ALL %s requests has been handled", file->name);
         common_clear_for_release_when_close(path, file);
         return 1;
     }
 
     // Set timer if the highest priority request has duration time
-    clock_gettime(CLOCK_MONOTONIC, &now);
     req_item = &(file->stat.items[file->stat.count - 1]);
-    time_value = calc_timespan_ms(now, req_item->duration_end_time);
+    time_value = req_remaining_ms(req_item);
     if (time_value > 0) {
-        sprd_timer_settime(file->timer_id, time_value);
+        req_arm_timer(file, time_value);
     }
 
     // If the highest priority request is the same with
     // current, don't need send the request to driver
-    if(strlen(file->stat.current.value) != 0
+    if(file->stat.current.times != 0
         && file->comp((void *)req_item, (void *)(&(file->stat.current))) == 0)
         return 1;
 
     // Update current request
-    memcpy(&(file->stat.current), req_item, sizeof(struct req_item));
+    req_set_current(file, req_item);
 
     if (file->fd <= 0) {
-        file->fd = open(buf, O_RDWR);
+        file->fd = vfs_open(buf, O_RDWR);
         if (file->fd <= 0) {
             ALOGE("open(%s) failed:%s", buf, strerror(errno));
             return 0;
         }
     }
 
-    if (access(buf, F_OK) == 0) {
-        ALOGD("Set %s: %s", buf, req_item->value);
-        write(file->fd, req_item->value, strlen(req_item->value));
+    if (vfs_access(buf, F_OK) == 0) {
+        int64_t start = stats_io_begin();
+        req_value_format(file, req_item->value, value, sizeof(value));
+        ALOGD_IF(DEBUG_D, "Set %s: %s", buf, value);
+        TRACE_BEGIN("write %s=%s", buf, value);
+        vfs_write(file->fd, value, strlen(value));
+        TRACE_END();
+        stats_io_end(start);
+        NODE_VALUE(buf, file, value, file_value_base(file));
     }
 
     return 1;
@@ -959,46 +1352,38 @@ int common_set_for_release_when_close(int enable, int duration,const char *path,
 static void remove_invalid_item(struct file *file)
 {
     int j = 0;
-    struct req_item tmp[NUM_REQUST_FOR_FILE_MAX];
 
     if (DEBUG_V) ENTER();
 
-    for (int i = 0; i <= file->stat.count; i++) {
+    for (int i = 0; i < file->stat.count; i++) {
         if (file->stat.items[i].times > 0) {
-            memcpy(&tmp[j++], &(file->stat.items[i]), sizeof(struct req_item));
+            if (i != j)
+                file->stat.items[j] = file->stat.items[i];
+            j++;
         }
     }
+    memset(&(file->stat.items[j]), 0, (file->stat.count - j) * sizeof(struct req_item));
     file->stat.count = j;
-    memset(file->stat.items, 0, sizeof(file->stat.items));
-
-    if (file->stat.count <= 0) return;
-    memcpy(file->stat.items, tmp, j*sizeof(struct req_item));
 }
 
 static void remove_eplased_item(struct file *file)
 {
-    struct timespec now;
-    long long diff_ms = -1;
-    struct request_stat *stat = NULL;
+    struct req_item *item = NULL;
 
     if (DEBUG_V) ENTER();
 
-    clock_gettime(CLOCK_MONOTONIC, &now);
-    for (int i = 0; i <= file->stat.count; i++) {
-        stat = &(file->stat);
-        if (stat->items[i].duration_end_time.tv_sec > 0 || stat->items[i].duration_end_time.tv_nsec > 0) {
-            diff_ms = calc_timespan_ms(now, stat->items[i].duration_end_time);
-            if (diff_ms <= 0) {
-                stat->items[i].times--;
-                memset(&(stat->items[i].duration_end_time), 0, sizeof(struct timespec));
-            }
+    for (int i = 0; i < file->stat.count; i++) {
+        item = &(file->stat.items[i]);
+        if (item->deadline != 0 && req_remaining_ms(item) <= 0) {
+            item->times--;
+            item->deadline = 0;
         }
     }
 
     remove_invalid_item(file);
 }
 
-static int find_item_by_value(const struct file *file)
+static int find_item_by_value(const struct file *file, int64_t value)
 {
     struct req_item tmp;
 
@@ -1006,7 +1391,7 @@ static int find_item_by_value(const struct file *file)
 
     if (DEBUG_V) ENTER();
     memset(&tmp, 0, sizeof(tmp));
-    strcpy(tmp.value, file->value.target_value);
+    tmp.value = value;
 
     for (int i = 0; i < file->stat.count; i++) {
         if (file->comp((void *)&tmp, (void *)(&(file->stat.items[i]))) == 0) {
@@ -1024,12 +1409,19 @@ static void request_item_sort(struct file *file)
         qsort(file->stat.items, file->stat.count, sizeof(struct req_item), file->comp);
 }
 
+// A deadline of 0 means no duration, skip it when the tick counter wraps
+static uint32_t req_deadline(int duration)
+{
+    uint32_t deadline = req_now_ms() + (uint32_t)duration;
+
+    return (deadline != 0)? deadline: 1;
+}
+
 void sort_request_for_file(int enable, int duration, struct file *file)
 {
     int index = -1;
-    struct timespec now;
-    static struct timespec duration_end_time;
-    long long diff_ms;
+    int64_t value = 0;
+    struct req_item *item = NULL;
 
     if (DEBUG_V) ENTER();
     if (CC_UNLIKELY(enable == 1 && strlen(file->value.target_value) == 0)) {
@@ -1043,7 +1435,10 @@ void sort_request_for_file(int enable, int duration, struct file *file)
     }
 
     remove_eplased_item(file);
-    index = find_item_by_value(file);
+    if (req_value_parse(file, file->value.target_value, &value) == 0)
+        return;
+
+    index = find_item_by_value(file, value);
     if (enable) {
         if (index == -1) {
             if (file->stat.count >= NUM_REQUST_FOR_FILE_MAX) {
@@ -1051,31 +1446,23 @@ void sort_request_for_file(int enable, int duration, struct file *file)
                 return;
             }
 
-            strcpy(file->stat.items[file->stat.count].value, file->value.target_value);
-            file->stat.items[file->stat.count].times = 1;
-            if (duration > 0) {
-                clock_gettime(CLOCK_MONOTONIC, &now);
-                file->stat.items[file->stat.count].duration_end_time.tv_sec = now.tv_sec + duration/SEC_TO_MS;
-                file->stat.items[file->stat.count].duration_end_time.tv_nsec = now.tv_nsec + (duration%SEC_TO_MS)*MS_TO_NS;
-            }
+            item = &(file->stat.items[file->stat.count]);
+            item->value = value;
+            item->times = 1;
+            item->scene = boosting_scene;
+            item->deadline = (duration > 0)? req_deadline(duration): 0;
             file->stat.count++;
 
             request_item_sort(file);
         } else {
+            item = &(file->stat.items[index]);
             if (duration == 0) {
-                file->stat.items[index].times++;
-            } else {
-                clock_gettime(CLOCK_MONOTONIC, &now);
-                diff_ms = calc_timespan_ms(now, file->stat.items[index].duration_end_time);
-                if (diff_ms < duration) {
-                    if (file->stat.items[index].duration_end_time.tv_sec == 0
-                        && file->stat.items[index].duration_end_time.tv_nsec == 0) {
-                        file->stat.items[index].times++;
-                    }
-
-                    file->stat.items[index].duration_end_time.tv_sec = now.tv_sec + duration/SEC_TO_MS;
-                    file->stat.items[index].duration_end_time.tv_nsec = now.tv_nsec + (duration%SEC_TO_MS)*MS_TO_NS;
-                }
+                item->times++;
+            } else if (req_remaining_ms(item) < duration) {
+                if (item->deadline == 0)
+                    item->times++;
+
+                item->deadline = req_deadline(duration);
             }
         }
     } else {
@@ -32,12 +32,17 @@
 #include <math.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
+#include <pthread.h>
 
 #define LOG_TAG "PowerHAL"
 #include <utils/Log.h>
 
+#include "recorder.h"
+#include "trace.h"
+#include "residency.h"
+
 #define LEN_PATH_MAX                      60
-#define LEN_FILE_MAX                      30
+#define LEN_FILE_MAX                      32
 #define LEN_VALUE_MAX                     60
 
 #define NUM_FILE_MAX                      20
@@ -48,10 +53,14 @@
 #define LEN_CONFIG_NAME_MAX               20
 
 #define NUM_REQUST_FOR_FILE_MAX           20
+// Files a batch defers, see begin_deferred_requests()
+#define NUM_DEFERRED_FILE_MAX             64
 
 extern int power_mode;
+extern unsigned int clear_generation;
 extern struct mode *current;
 extern int DEBUG_D;
+extern __thread const char *boosting_scene;
 
 struct file;
 
@@ -61,20 +70,23 @@ typedef int (*set_func_ptr_t)(int enable, int duration,const char *path, struct
 
 /**
  * struct req_item - record a request info
- * @value: the value to set
+ * @value: the requested value, see req_value_parse()
  * @times: the times of request the value
- * @duration_end_time: the duration time of one request
+ * @deadline: when the duration of the request ends in ms ticks of
+ *            req_now_ms(), 0 if the request has no duration
+ * @scene: the scene that requested the value first, used by residency accounting
  */
 struct req_item {
-    char value[LEN_VALUE_MAX];
-    int times;
-    struct timespec duration_end_time;
+    int64_t value;
+    int32_t times;
+    uint32_t deadline;
+    const char *scene;
 };
 
 /**
  * struct request_stat - record all requests for a file
  * @count: the number of request item for current file
- * @current: the value currently in force
+ * @current: the value currently in force, valid if current.times is not 0
  * @items: record every request item
  */
 struct request_stat {
@@ -86,17 +98,22 @@ struct request_stat {
 /**
  * struct file - the all info for a file
  * @name: the file name
+ * @id: index of the file in all resource files, used by the flight recorder
  * @fd: record the file descriptor, used if request is released when close the file
  * @value: the def_value or target value
  * @no_has_defalut: if the file has default value, 0 if hava, default 0
  * @timer_id: the timer id
+ * @timer_due_ns: monotonic time the armed timer expires, 0 if it is disarmed
  * @comp: the comppare function used by request sort
  * @clear: clear all requests for current file
  * @set: called when boost or deboost
  * @stat: record all resources for the file
+ * @lock: guards @value and @stat while the HAL lock is held shared, taken in
+ *        ascending @id when a scene needs several, see lock_files()
  */
 struct file {
     char name[LEN_FILE_MAX];
+    int id;
     int fd;
     struct {
         char def_value[LEN_VALUE_MAX];
@@ -105,10 +122,12 @@ struct file {
     int no_has_def;
     int def_val_check;
     timer_t timer_id;
+    int64_t timer_due_ns;
     comp_func_ptr_t comp;
     clear_func_ptr_t clear;
     set_func_ptr_t set;
     struct request_stat stat;
+    pthread_mutex_t lock;
 };
 
 /**
@@ -187,10 +206,12 @@ struct subsys {
  * struct resources - record all resource info
  * @count: the number of the resource directory
  * @path_files: record all supported resource files
+ * @file_count: the number of files in all path_files
  */
 struct resources {
     int count;
     struct path_file path_files[NUM_PATH_MAX];
+    int file_count;
     int subsys_count;
     struct subsys subsystems[NUM_SUBSYS_MAX];
 };
@@ -231,6 +252,22 @@ int common_subsys_clear(const char *path, struct file *file);
 int common_subsys_comp(const void *a, const void *b);
 int common_clear_for_release_when_close(const char *path, struct file *file);
 int common_set_for_release_when_close(int enable, int duration,const char *path, struct file *file);
+int file_value_base(const struct file *file);
+int req_value_parse(const struct file *file, const char *str, int64_t *value);
+char *req_value_format(const struct file *file, int64_t value, char *buf, int size);
+uint32_t req_now_ms(void);
+long long req_remaining_ms(const struct req_item *item);
+void req_dump(const char *name, const struct file *file);
+void req_set_current(struct file *file, const struct req_item *item);
+void req_arm_timer(struct file *file, long long value_ms);
+struct file *find_file_by_id(int id);
+
+// Record the effective value of a node to the flight recorder and ftrace
+#define NODE_VALUE(path, file, value, base) \
+    do { \
+        flight_record(FR_EV_WRITE, __func__, (file)->id, strtoll(value, NULL, base)); \
+        TRACE_COUNTER(path, value, base); \
+    } while (0)
 
 int config_read();
 
@@ -246,11 +283,20 @@ struct file_node {
 int init_file(struct file_node *file_node);
 void start_thread_for_timing_request(void *args);
 
+// Timers besides the ones of the files, run by the timer thread
+#define NUM_TIMING_TIMER_MAX              8
+typedef void (*timing_expire_func_t)(void);
+int add_timing_timer(timer_t *timer_id, timing_expire_func_t expire);
+
 int boost(int scene_id, int subtype, int enable, int data);
 int update_mode(int mode, int enable);
 void sort_request_for_file(int enable, int duration, struct file *file);
+void expire_request_for_file(const char *path, struct file *file);
+bool resource_defaults_read(void);
+void begin_deferred_requests(void);
+bool defer_request_for_file(const char *path, struct file *file);
+void apply_deferred_requests(void);
 void clear_requests_for_all_file();
 
 void *find_subsys_by_name(char *name);
-int add_priority_to_target_value(struct file *file);
 #endif
@@ -27,6 +27,8 @@
 #include <utils/Log.h>
 
 #include "config.h"
+#include "thread_sched.h"
+#include "vfs.h"
 
 struct power power;
 
@@ -62,6 +64,74 @@ static xmlXPathObjectPtr get_node_set(xmlDocPtr doc, xmlChar *xpath)
     return result;
 }
 
+/**
+ * bind_set - resolve the resource file of @entry once, so boost doesn't
+ * look it up by name
+ */
+static void bind_set(struct set_entry *entry)
+{
+    struct path_file *path_file = NULL;
+
+    for (int i = 0; i < resources.count; i++) {
+        path_file = &(resources.path_files[i]);
+        if (strcmp(entry->set.path, path_file->path) != 0)
+            continue;
+
+        for (int j = 0; j < path_file->count; j++) {
+            if (strcmp(entry->set.file, path_file->files[j].name) == 0) {
+                entry->path_file = path_file;
+                entry->file = &(path_file->files[j]);
+                if (strncmp(path_file->path, "subsys", 6) == 0)
+                    entry->subsys = find_subsys_by_name(entry->file->name);
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * intern_set - the index of @set in power.sets[], it is added if no
+ * scene uses it yet
+ *
+ * @return the index, -1 if power.sets[] is full
+ */
+static int intern_set(const struct set *set)
+{
+    struct set_entry *entry = NULL;
+
+    for (int i = 0; i < power.set_count; i++) {
+        entry = &(power.sets[i]);
+        if (strcmp(set->file, entry->set.file) == 0
+            && strcmp(set->value, entry->set.value) == 0
+            && strcmp(set->path, entry->set.path) == 0)
+            return i;
+    }
+
+    if (power.set_count >= NUM_SET_MAX) {
+        ALOGE("!!!The sets[] of power is full");
+        return -1;
+    }
+
+    entry = &(power.sets[power.set_count]);
+    memcpy(&(entry->set), set, sizeof(struct set));
+    bind_set(entry);
+
+    return power.set_count++;
+}
+
+/**
+ * scene_set_entry - the @index-th set of @scene
+ */
+const struct set_entry *scene_set_entry(const struct scene *scene, int index)
+{
+    return &(power.sets[scene->sets[index]]);
+}
+
+const struct set *scene_set(const struct scene *scene, int index)
+{
+    return &(power.sets[scene->sets[index]].set);
+}
+
 /**
  * Parse scene node
  */
@@ -74,7 +144,9 @@ static int parse_scene_node(xmlNodePtr cur, struct scene *scene)
     xmlChar *name = NULL;
     xmlChar *duration = NULL;
     xmlChar *enable = NULL;
-    struct set *set = NULL;
+    xmlChar *escalate = NULL;
+    struct set set;
+    int index = -1;
 
     name = xmlGetProp(cur, (const xmlChar*) "name");
     strncpy(scene->name, (const char *)name, LEN_SCENE_NAME_MAX);
@@ -85,8 +157,12 @@ static int parse_scene_node(xmlNodePtr cur, struct scene *scene)
     enable = xmlGetProp(cur, (const xmlChar*) "enable");
     scene->enable = (enable != NULL)? atoi(enable): 1;
     xmlFree(enable);
-    ALOGD_IF(DEBUG_V, "  <%s name=\"%s\" duration=\"%d\" enable=\"%d\" />"
-        , cur->name, scene->name, scene->duration, scene->enable);
+    escalate = xmlGetProp(cur, (const xmlChar*) "escalate");
+    if (escalate != NULL)
+        strncpy(scene->escalate, (const char *)escalate, LEN_SCENE_NAME_MAX - 1);
+    xmlFree(escalate);
+    ALOGD_IF(DEBUG_V, "  <%s name=\"%s\" duration=\"%d\" enable=\"%d\" escalate=\"%s\" />"
+        , cur->name, scene->name, scene->duration, scene->enable, scene->escalate);
 
     cur = cur->xmlChildrenNode;
     while (cur) {
@@ -96,7 +172,6 @@ static int parse_scene_node(xmlNodePtr cur, struct scene *scene)
                 return 0;
             }
 
-            set = &(scene->sets[scene->count++]);
             path = xmlGetProp(cur, (const xmlChar*) "path");
             file = xmlGetProp(cur, (const xmlChar*) "file");
             value = xmlGetProp(cur, (const xmlChar*) "value");
@@ -107,15 +182,21 @@ static int parse_scene_node(xmlNodePtr cur, struct scene *scene)
                 if (value !=NULL) xmlFree(value);
                 return 0;
             }
-            strncpy(set->path, (const char *)path, LEN_PATH_MAX);
-            if (set->path[strlen(set->path) - 1] == '/')
-                set->path[strlen(set->path) - 1] = '\0';
-            strncpy(set->file, (const char *)file, LEN_FILE_MAX);
-            strncpy(set->value, (const char *)value, LEN_VALUE_MAX);
+            memset(&set, 0, sizeof(set));
+            strncpy(set.path, (const char *)path, LEN_PATH_MAX);
+            if (set.path[strlen(set.path) - 1] == '/')
+                set.path[strlen(set.path) - 1] = '\0';
+            strncpy(set.file, (const char *)file, LEN_FILE_MAX);
+            strncpy(set.value, (const char *)value, LEN_VALUE_MAX);
 
             xmlFree(path);
             xmlFree(file);
             xmlFree(value);
+
+            index = intern_set(&set);
+            if (index < 0)
+                return 0;
+            scene->sets[scene->count++] = index;
         }
         cur = cur->next;
     }
@@ -124,6 +205,31 @@ static int parse_scene_node(xmlNodePtr cur, struct scene *scene)
     return 1;
 }
 
+/*
+ * An escalation must name another scene of @mode that doesn't escalate
+ * itself, else it is dropped
+ */
+static void check_escalations(struct mode *mode)
+{
+    struct scene *target = NULL;
+
+    for (int i = 0; i < mode->count; i++) {
+        if (mode->scenes[i].escalate[0] == '\0')
+            continue;
+
+        target = NULL;
+        for (int j = 0; j < mode->count; j++) {
+            if (j != i && strcmp(mode->scenes[j].name, mode->scenes[i].escalate) == 0)
+                target = &(mode->scenes[j]);
+        }
+        if (target == NULL || target->escalate[0] != '\0') {
+            ALOGE("%s: %s can't escalate to %s", mode->name, mode->scenes[i].name
+                , mode->scenes[i].escalate);
+            mode->scenes[i].escalate[0] = '\0';
+        }
+    }
+}
+
 /**
  * Parse a mode node
  */
@@ -160,6 +266,7 @@ static int parse_mode_node(xmlNodePtr cur)
         cur = cur->next;
     }
 
+    check_escalations(mode);
     ALOGD_IF(DEBUG_V, "</mode>");
     return 1;
 }
@@ -174,7 +281,8 @@ int read_scene_config(void)
     xmlNodePtr tmp;
 
     memset(&power, 0, sizeof(power));
-    xmlDocPtr doc = xmlParseFile(PATH_SCENE_CONFIG);
+    char path[LEN_VFS_PATH_MAX];
+    xmlDocPtr doc = xmlParseFile(vfs_path(PATH_SCENE_CONFIG, path, sizeof(path)));
     if (doc == NULL) {
         xmlCleanupParser();
         ALOGE("Alloc xmlDoc failed!!!");
@@ -248,6 +356,24 @@ int scene_name_to_scene_id(char *scene_name)
     return 0;
 }
 
+/**
+ * scene_name_to_id_subtype - the scene id and subtype of @scene_name
+ *
+ * @return 1 if found, else 0.
+ */
+int scene_name_to_id_subtype(const char *scene_name, int *scene_id, int *subtype)
+{
+    for (int i = 0; i < scene_id_count; i++) {
+        if (strcmp(scene_name, scene_ids[i].scene_name) == 0) {
+            *scene_id = scene_ids[i].id;
+            *subtype = scene_ids[i].subtype;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int read_scene_id_define_file()
 {
     FILE *fp = NULL;
@@ -258,7 +384,8 @@ int read_scene_id_define_file()
     struct scene_id *scene_id = NULL;
 
     memset(scene_ids, 0, sizeof(scene_ids));
-    fp = fopen(PATH_SCENE_ID_DEFINE, "r");
+    scene_id_count = 0;
+    fp = vfs_fopen(PATH_SCENE_ID_DEFINE, "r");
     if (fp == NULL) {
         ALOGE("open failed(%s)", strerror(errno));
         return 0;
@@ -546,7 +673,8 @@ int parse_resource_path(bool subsys)
         xpath = (xmlChar*)RESOURCE_FILE_PATH;
     }
 
-    xmlDocPtr doc = xmlParseFile(PATH_RESOURCE_FILE_INFO);
+    char path[LEN_VFS_PATH_MAX];
+    xmlDocPtr doc = xmlParseFile(vfs_path(PATH_RESOURCE_FILE_INFO, path, sizeof(path)));
     if (doc == NULL) {
         xmlCleanupParser();
         return 0;
@@ -582,6 +710,68 @@ out0:
     return ret;
 }
 
+/**
+ * Parse thread node in resource file
+ */
+static int parse_thread_node(xmlNodePtr cur)
+{
+    const char *attrs[] = {"name", "nice", "cpus", "timer_slack_ns"};
+    xmlChar *values[sizeof(attrs) / sizeof(attrs[0])];
+    int count = sizeof(attrs) / sizeof(attrs[0]);
+    int ret = 0;
+
+    for (int i = 0; i < count; i++)
+        values[i] = xmlGetProp(cur, (const xmlChar*)attrs[i]);
+
+    ALOGD_IF(DEBUG_V, "<thread name=\"%s\" nice=\"%s\" cpus=\"%s\" timer_slack_ns=\"%s\" />"
+        , values[0], values[1], values[2], values[3]);
+    ret = thread_sched_parse((const char *)values[0], (const char *)values[1], (const char *)values[2]
+        , (const char *)values[3]);
+
+    for (int i = 0; i < count; i++) {
+        if (values[i] != NULL) xmlFree(values[i]);
+    }
+
+    return ret;
+}
+
+/**
+ * Parse the optional thread nodes, a thread with none keeps its scheduling
+ */
+static int parse_resource_threads(void)
+{
+    int ret = 1;
+    char path[LEN_VFS_PATH_MAX];
+    xmlDocPtr doc = xmlParseFile(vfs_path(PATH_RESOURCE_FILE_INFO, path, sizeof(path)));
+    xmlXPathContextPtr context = NULL;
+    xmlXPathObjectPtr result = NULL;
+
+    thread_sched_reset();
+    if (doc == NULL) {
+        xmlCleanupParser();
+        return 0;
+    }
+
+    context = xmlXPathNewContext(doc);
+    if (context != NULL) {
+        result = xmlXPathEvalExpression((xmlChar*)RESOURCE_THREAD_PATH, context);
+        xmlXPathFreeContext(context);
+    }
+
+    if (result != NULL && !xmlXPathNodeSetIsEmpty(result->nodesetval)) {
+        for (int i = 0; i < result->nodesetval->nodeNr && ret != 0; i++)
+            ret = parse_thread_node(result->nodesetval->nodeTab[i]);
+    }
+
+    if (result != NULL) xmlXPathFreeObject(result);
+    xmlFreeDoc(doc);
+    xmlCleanupParser();
+
+    ALOGE_IF(ret == 0, "%s parse thread failed.", PATH_RESOURCE_FILE_INFO);
+
+    return ret;
+}
+
 /**
  * Parse the resource file
  */
@@ -590,6 +780,7 @@ int read_resource_config(void)
     int ret = 0;
 
     ret = parse_resource_path(false);
+    parse_resource_threads();
     if ((parse_resource_path(true) == 0) && (ret == 0))
         return 0;
     else
@@ -36,21 +36,39 @@
 #define LEN_SCENE_NAME_MAX                40
 #define NUM_SCENE_MAX                     40
 #define NUM_SCENE_ID_ENTRY_MAX            60
+#define NUM_SET_MAX                       128
+
+/**
+ * struct set_entry - a set shared by all the scenes and modes using it
+ * @set: the configuration of the file
+ * @path_file: the resource directory of the file, NULL if it is undefined
+ * @file: the resource file, NULL if it is undefined
+ * @subsys: the subsystem if the file is a subsys, else NULL
+ */
+struct set_entry {
+    struct set set;
+    struct path_file *path_file;
+    struct file *file;
+    struct subsys *subsys;
+};
 
 /**
  * struct scene - record the configuration of a scene
  * @name: the scene name
  * @count: the number of element in sets array
- * @sets: the configuration of the scene
+ * @sets: the configuration of the scene, indexes of power.sets[]
  * @duration: duration time of scene, only for test
  * @enable: enable or disable this scene
+ * @escalate: the scene entered on top of this one while CPU pressure is
+ *            high, empty if none, see psi_monitor.h
  */
 struct scene {
     char name[LEN_SCENE_NAME_MAX];
     int count;
-    struct set sets[NUM_FILE_MAX];
+    uint16_t sets[NUM_FILE_MAX];
     int duration;
     int enable;
+    char escalate[LEN_SCENE_NAME_MAX];
 };
 
 /**
@@ -69,15 +87,23 @@ struct mode {
  * struct power - record all info for all modes
  * @count: the number of mode
  * @modes: the configuration of all supported modes
+ * @set_count: the number of element in sets array
+ * @sets: the distinct sets of all scenes, identical sets are stored once
  */
 struct power {
     int count;
     struct mode modes[NUM_MODE_MAX];
+    int set_count;
+    struct set_entry sets[NUM_SET_MAX];
 };
 
 extern struct power power;
+extern struct mode *default_mode;
+extern struct mode *current_mode;
 
 int read_scene_config(void);
+const struct set_entry *scene_set_entry(const struct scene *scene, int index);
+const struct set *scene_set(const struct scene *scene, int index);
 
 // Store id info from power_scene_id_define.txt
 struct scene_id {
@@ -89,6 +115,7 @@ struct scene_id {
 int read_scene_id_define_file();
 char *scene_id_to_string(int scene_id, int subtype);
 int scene_name_to_scene_id(char *scene_name);
+int scene_name_to_id_subtype(const char *scene_name, int *scene_id, int *subtype);
 
 int read_resource_config(void);
 #endif
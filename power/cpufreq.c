@@ -16,6 +16,7 @@
 
 #include "utils.h"
 #include "common.h"
+#include "trace.h"
 
 int sprdemand_boost_set(int enable, int duration, const char *path, struct file *file)
 {
@@ -25,9 +26,13 @@ int sprdemand_boost_set(int enable, int duration, const char *path, struct file
         return 0;
 
     ENTER();
+    if (defer_request_for_file(path, file))
+        return 1;
+
     snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
-    ALOGD("Set %s: 4", buf);
+    ALOGD_IF(DEBUG_D, "Set %s: 4", buf);
     sprd_write(buf, "4");
+    NODE_VALUE(buf, file, "4", 10);
 
     return 1;
 }
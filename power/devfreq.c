@@ -17,9 +17,13 @@
 #include "common.h"
 #include "utils.h"
 #include "devfreq.h"
+#include "trace.h"
+#include "vfs.h"
 
 // Storage the frequency supported by kernel
 static int devfreq_ddr_freqs[NUM_DEVFREQ_AVAILABLE_FREQ_MAX] = {0};
+// The ddr files may be set concurrently, only one reads the table
+static pthread_mutex_t devfreq_ddr_freqs_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static int integer_compare(const void *aa,const void *bb)
 {
@@ -46,18 +50,18 @@ static int init_available_freqs(const char *path, int *value)
 
     if (CC_UNLIKELY(path == NULL || value == NULL)) return 0;
 
-    fd = open(path, O_RDONLY);
+    fd = vfs_open(path, O_RDONLY);
     if (fd < 0) {
         ALOGE("Open %s fail: %s\n", path, strerror(errno));
         return 0;
     }
-    n = read(fd, buf, sizeof(buf));
+    n = vfs_read(fd, buf, sizeof(buf) - 1);
     if (n == -1) {
         ALOGE("Reading %s fail: %s\n", path, strerror(errno));
-        close(fd);
+        vfs_close(fd);
         return 0;
     }
-    close(fd);
+    vfs_close(fd);
 
     item = strtok(buf," ");
     while (item != NULL) {
@@ -93,13 +97,15 @@ int devfreq_ddr_clear(const char *path, struct file *file)
 
     snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
 
-    sprd_timer_settime(file->timer_id, 0);
-    if ((strlen(file->stat.current.value) != 0) && (access(buf, F_OK) == 0)) {
-        snprintf(value, sizeof(value), "%d %s", 0, file->stat.current.value);
+    req_arm_timer(file, 0);
+    if ((file->stat.current.times != 0) && (vfs_access(buf, F_OK) == 0)) {
+        snprintf(value, sizeof(value), "%d %lld", 0, (long long)file->stat.current.value);
         ALOGD_IF(DEBUG_D, "set %s: %s ", buf, value);
         sprd_write(buf, value);
+        NODE_VALUE(buf, file, "0", 10);
     }
     memset(&(file->stat), 0, sizeof(struct request_stat));
+    residency_update(file, file->value.def_value, NULL);
     return 1;
 }
 
@@ -107,7 +113,6 @@ int devfreq_ddr_set(int enable, int duration, const char *path, struct file *fil
 {
     char buf[128] = {'\0'};
     char value[LEN_VALUE_MAX] = {'\0'};
-    struct timespec now;
     struct req_item *req_item = NULL;
     long long time_value;
 
@@ -117,9 +122,26 @@ int devfreq_ddr_set(int enable, int duration, const char *path, struct file *fil
     ENTER("enable:%d, duration: %d, %s/%s: %s", enable, duration, path, file->name
         , file->value.target_value);
 
-    if (CC_UNLIKELY(devfreq_ddr_freqs[1] == 0)) {
-        ALOGD("%s: Get available ddr freqs", __func__);
-        if (init_available_freqs(PATH_DEVFREQ_DDR_FREQ_TABLE, devfreq_ddr_freqs) == 0)
+    if (CC_UNLIKELY(__atomic_load_n(&devfreq_ddr_freqs[1], __ATOMIC_ACQUIRE) == 0)) {
+        int ret = 1;
+
+        pthread_mutex_lock(&devfreq_ddr_freqs_lock);
+        if (devfreq_ddr_freqs[1] == 0) {
+            int freqs[NUM_DEVFREQ_AVAILABLE_FREQ_MAX] = {0};
+
+            ALOGD("%s: Get available ddr freqs", __func__);
+            ret = init_available_freqs(PATH_DEVFREQ_DDR_FREQ_TABLE, freqs);
+            if (ret != 0) {
+                // freqs[1] last, it tells the table is read
+                for (int i = 0; i < NUM_DEVFREQ_AVAILABLE_FREQ_MAX; i++) {
+                    if (i != 1)
+                        devfreq_ddr_freqs[i] = freqs[i];
+                }
+                __atomic_store_n(&devfreq_ddr_freqs[1], freqs[1], __ATOMIC_RELEASE);
+            }
+        }
+        pthread_mutex_unlock(&devfreq_ddr_freqs_lock);
+        if (ret == 0)
             return 0;
     }
 
@@ -128,21 +150,13 @@ int devfreq_ddr_set(int enable, int duration, const char *path, struct file *fil
             , devfreq_ddr_freqs[NUM_DEVFREQ_AVAILABLE_FREQ_MAX - 1]);
     }
 
-    memset(&now, 0, sizeof(now));
     snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
 
     sort_request_for_file(enable, duration, file);
-    if (DEBUG_V) {
-        char time[20] = {'\0'};
-        ALOGD(">>>>>>>>>>>>>>>>>>>>");
-        ALOGD("%s:", buf);
-        for (int i = 0; i < file->stat.count; i++) {
-            sprd_strftime(time, sizeof(time), file->stat.items[i].duration_end_time);
-            ALOGD("  value:%s, times:%d, end_time: %s", file->stat.items[i].value
-                , file->stat.items[i].times, time);
-        }
-        ALOGD("<<<<<<<<<<<<<<<<<<<<");
-    }
+    if (DEBUG_V)
+        req_dump(buf, file);
+    if (defer_request_for_file(path, file))
+        return 1;
 
     if (file->stat.count <= 0) {
         devfreq_ddr_clear(path, file);
@@ -150,33 +164,33 @@ int devfreq_ddr_set(int enable, int duration, const char *path, struct file *fil
     }
 
     // Set timer if the highest priority request has duration time
-    clock_gettime(CLOCK_MONOTONIC, &now);
     req_item = &(file->stat.items[file->stat.count - 1]);
-    time_value = calc_timespan_ms(now, req_item->duration_end_time);
+    time_value = req_remaining_ms(req_item);
     if (time_value > 0) {
-        sprd_timer_settime(file->timer_id, time_value);
+        req_arm_timer(file, time_value);
     }
 
     // If the highest priority request is the same with
     // current, don't need send the request to driver
-    if(strlen(file->stat.current.value) != 0
+    if(file->stat.current.times != 0
         && file->comp((void *)req_item, (void *)(&(file->stat.current))) == 0)
         return 1;
 
-    if (access(buf, F_OK) == 0) {
-        if (strlen(file->stat.current.value) != 0) {
-            snprintf(value, sizeof(value), "%d %s", 0, file->stat.current.value);
-            ALOGD("set %s: %s", buf, value);
+    if (vfs_access(buf, F_OK) == 0) {
+        if (file->stat.current.times != 0) {
+            snprintf(value, sizeof(value), "%d %lld", 0, (long long)file->stat.current.value);
+            ALOGD_IF(DEBUG_D, "set %s: %s", buf, value);
             sprd_write(buf, value);
         }
 
-        memcpy(&(file->stat.current), req_item, sizeof(struct req_item));
-        snprintf(value, sizeof(value), "%d %s", 1, file->stat.current.value);
+        req_set_current(file, req_item);
+        snprintf(value, sizeof(value), "%d %lld", 1, (long long)file->stat.current.value);
         ALOGD_IF(DEBUG_D, "set %s: %s ", buf, value);
         sprd_write(buf, value);
+        NODE_VALUE(buf, file, value + 2, 10);
     } else {
         // Update current request
-        memcpy(&(file->stat.current), req_item, sizeof(struct req_item));
+        req_set_current(file, req_item);
     }
 
     return 1;
@@ -201,14 +215,15 @@ int clear_func_subsys_dfs_ddr(const char *path, struct file *file)
         return 0;
     }
 
-    sprd_timer_settime(file->timer_id, 0);
+    req_arm_timer(file, 0);
     memset(&(file->stat), 0, sizeof(struct request_stat));
+    residency_update(file, file->value.def_value, NULL);
 
     for (int i = 0; i < subsys->inode_count; i++) {
         inode = &(subsys->inodes[i]);
         if (inode->no_has_def == 0) {
             snprintf(buf, sizeof(buf), "%s/%s", inode->path, inode->file);
-            if (access(buf, F_OK) != 0)
+            if (vfs_access(buf, F_OK) != 0)
                 continue;
 
             if (strstr(inode->file, "overflow") || strstr(inode->file, "underflow")) {
@@ -228,6 +243,7 @@ int clear_func_subsys_dfs_ddr(const char *path, struct file *file)
                 }
             } else {
                 sprd_write(buf, inode->value.def_value);
+                NODE_VALUE(buf, file, inode->value.def_value, 10);
             }
             ALOGD_IF(DEBUG, "Set %s: %s", buf, inode->value.def_value);
         }
@@ -241,9 +257,7 @@ static int subsys_dfs_ddr_set_current_config(struct file *file)
     struct subsys *subsys = NULL;
     struct config *config = NULL;
     struct subsys_inode *inode = NULL;
-    char *conf_name = NULL;
-    int conf_name_len = 0;
-    char *ptr = NULL;
+    uint32_t index = 0;
     char buf[128] = {'\0'};
 
     ENTER();
@@ -255,21 +269,13 @@ static int subsys_dfs_ddr_set_current_config(struct file *file)
         return 0;
     }
 
-    conf_name = file->stat.current.value;
-    ptr = strchr(file->stat.current.value, ':');
-    conf_name_len = ptr - conf_name;
-
-    for (int i = 0; i < subsys->config_count; i++) {
-        if (strncmp(conf_name, subsys->configs[i].name, conf_name_len) == 0) {
-            config = &(subsys->configs[i]);
-            break;
-        }
-    }
-
-    if (config == NULL) {
-        ALOGE("Don't find config: %s in %s subsys", conf_name, subsys->name);
+    // The config index is kept in the low 32 bits, see req_value_parse()
+    index = (uint32_t)file->stat.current.value;
+    if (index >= (uint32_t)subsys->config_count) {
+        ALOGE("Don't find config: %u in %s subsys", index, subsys->name);
         return 0;
     }
+    config = &(subsys->configs[index]);
 
     for (int i = 0; i < config->count; i++) {
         for (int j = 0; j < subsys->inode_count; j++) {
@@ -285,7 +291,7 @@ static int subsys_dfs_ddr_set_current_config(struct file *file)
         inode = &(subsys->inodes[i]);
         if (strlen(inode->value.target_value) != 0) {
             snprintf(buf, sizeof(buf), "%s/%s", inode->path, inode->file);
-            if (access(buf, F_OK) != 0)
+            if (vfs_access(buf, F_OK) != 0)
                 continue;
 
             if (strstr(inode->file, "overflow") || strstr(inode->file, "underflow")) {
@@ -305,6 +311,7 @@ static int subsys_dfs_ddr_set_current_config(struct file *file)
                 }
             } else {
                 sprd_write(buf, inode->value.target_value);
+                NODE_VALUE(buf, file, inode->value.target_value, 10);
             }
             ALOGD_IF(DEBUG_D, "Set %s: %s", buf, inode->value.target_value);
         }
@@ -318,34 +325,25 @@ static int subsys_dfs_ddr_set_current_config(struct file *file)
  */
 int set_func_subsys_dfs_ddr(int enable, int duration,const char *path, struct file *file)
 {
-    struct timespec now;
     struct req_item *req_item = NULL;
+    int64_t value;
     long long time_value;
 
     if (CC_UNLIKELY(path == NULL || file == NULL))
         return 0;
 
-    if (strlen(file->value.target_value) != 0 && add_priority_to_target_value(file) == 0) {
-        ALOGE("Add priority for %s failed", file->value.target_value);
+    if (strlen(file->value.target_value) != 0
+        && req_value_parse(file, file->value.target_value, &value) == 0)
         return 0;
-    }
 
     ENTER("enable:%d, duration: %d, %s:%s: %s", enable, duration, path, file->name
         , file->value.target_value);
-    memset(&now, 0, sizeof(now));
 
     sort_request_for_file(enable, duration, file);
-    if (DEBUG_V) {
-        char time[20] = {'\0'};
-        ALOGD(">>>>>>>>>>>>>>>>>>>>");
-        ALOGD("%s:", file->name);
-        for (int i = 0; i < file->stat.count; i++) {
-            sprd_strftime(time, sizeof(time), file->stat.items[i].duration_end_time);
-            ALOGD("  value:%s, times:%d, end_time: %s", file->stat.items[i].value
-                , file->stat.items[i].times, time);
-        }
-        ALOGD("<<<<<<<<<<<<<<<<<<<<");
-    }
+    if (DEBUG_V)
+        req_dump(file->name, file);
+    if (defer_request_for_file(path, file))
+        return 1;
 
     if (file->stat.count <= 0) {
         clear_func_subsys_dfs_ddr(path, file);
@@ -353,22 +351,21 @@ int set_func_subsys_dfs_ddr(int enable, int duration,const char *path, struct fi
     }
 
     // Set timer if the highest priority request has duration time
-    clock_gettime(CLOCK_MONOTONIC, &now);
     req_item = &(file->stat.items[file->stat.count - 1]);
-    time_value = calc_timespan_ms(now, req_item->duration_end_time);
+    time_value = req_remaining_ms(req_item);
     if (time_value > 0) {
-        sprd_timer_settime(file->timer_id, time_value);
+        req_arm_timer(file, time_value);
     }
 
     // If the highest priority request is the same with
     // current, don't need send the request to driver
-    if(strlen(file->stat.current.value) != 0
+    if(file->stat.current.times != 0
         && file->comp((void *)req_item, (void *)(&(file->stat.current))) == 0)
         return 1;
 
     // Update current request
-    memcpy(&(file->stat.current), req_item, sizeof(struct req_item));
-    ALOGD_IF(DEBUG_V, "current value: %s", file->stat.current.value);
+    req_set_current(file, req_item);
+    ALOGD_IF(DEBUG_V, "current config: %u", (uint32_t)file->stat.current.value);
     subsys_dfs_ddr_set_current_config(file);
 
     return 1;
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "clock.h"
+#include "hint_class.h"
+#include "hint_id.h"
+#include "thread_sched.h"
+#include "utils.h"
+
+static const char *class_names[HINT_CLASS_MAX] = {
+    [HINT_CLASS_CRITICAL] = "critical",
+    [HINT_CLASS_NORMAL] = "normal",
+    [HINT_CLASS_BACKGROUND] = "background",
+};
+
+/**
+ * struct hint_queue - the background hints waiting for the worker
+ * @lock: guards the queue
+ * @more: signaled when a hint is queued or the last critical hint ends
+ * @space: signaled when the worker empties the queue
+ * @count: the number of queued hints, read without @lock to skip signaling
+ * @force: the queue is full, apply it without waiting for critical hints
+ * @ops: the queued hints, oldest first
+ */
+struct hint_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t more;
+    pthread_cond_t space;
+    int count;
+    bool force;
+    struct hint_queued ops[NUM_HINT_CLASS_QUEUE_MAX];
+};
+
+static struct hint_queue queue = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .space = PTHREAD_COND_INITIALIZER,
+};
+static bool worker_running = false;
+// Critical hints between hint_class_enter() and hint_class_exit()
+static int critical_inflight = 0;
+
+static struct hint_class_stats class_stats[HINT_CLASS_MAX];
+
+int hint_class_of(power_hint_t hint)
+{
+    switch ((int)hint) {
+        case POWER_HINT_INTERACTION:
+        case POWER_HINT_LAUNCH:
+        case POWER_HINT_VENDOR_INTERACTION_OTHER:
+        case POWER_HINT_VENDOR_INTERACTION_TOUCH:
+        case POWER_HINT_VENDOR_INTERACTION_LAUNCH:
+        case POWER_HINT_VENDOR_INTERACTION_FLING:
+        case POWER_HINT_VENDOR_INTERACTION_FLING_1:
+        case POWER_HINT_VENDOR_INTERACTION_BUTTON:
+        case POWER_HINT_VENDOR_INTERACTION_WAKEUP:
+            return HINT_CLASS_CRITICAL;
+        case POWER_HINT_VENDOR_SCREENOFF_MP3_PLAYBACK:
+        case POWER_HINT_VENDOR_TEMP_CTRL:
+        case POWER_HINT_VENDOR_AUDIO_PLAYBACK:
+            return HINT_CLASS_BACKGROUND;
+        default:
+            return HINT_CLASS_NORMAL;
+    }
+}
+
+const char *hint_class_name(int cls)
+{
+    return class_names[cls];
+}
+
+static void *hint_class_worker(void *args)
+{
+    struct sprd_power_module *pm = (struct sprd_power_module *)args;
+    struct timespec ts;
+    int64_t due_ns = 0;
+    bool starved = false;
+
+    prctl(PR_SET_NAME, "power_hint_bg");
+    thread_sched_apply(THREAD_BACKGROUND);
+
+    pthread_mutex_lock(&queue.lock);
+    for (;;) {
+        if (queue.count == 0) {
+            pthread_cond_wait(&queue.more, &queue.lock);
+            continue;
+        }
+
+        starved = false;
+        if (!queue.force && __atomic_load_n(&critical_inflight, __ATOMIC_ACQUIRE) > 0) {
+            due_ns = queue.ops[0].enqueue_ns + HINT_CLASS_STARVATION_MS * MS_TO_NS;
+            if (stats_now_ns() < due_ns) {
+                ts.tv_sec = due_ns / (SEC_TO_MS * MS_TO_NS);
+                ts.tv_nsec = due_ns % (SEC_TO_MS * MS_TO_NS);
+                pthread_cond_timedwait(&queue.more, &queue.lock, &ts);
+                continue;
+            }
+            starved = true;
+        }
+
+        if (starved)
+            class_stats[HINT_CLASS_BACKGROUND].starved += queue.count;
+        if (queue.force)
+            class_stats[HINT_CLASS_BACKGROUND].forced += queue.count;
+        queue.force = false;
+        pthread_mutex_unlock(&queue.lock);
+
+        // Takes the queue with the HAL lock held, unless a drain got it first
+        power_hint_apply_queued(pm);
+
+        pthread_mutex_lock(&queue.lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * hint_class_start - start the background worker unless disabled
+ * return: 0, or -errno if the worker can't be created
+ */
+int hint_class_start(struct sprd_power_module *pm)
+{
+    pthread_condattr_t attr;
+    pthread_attr_t thread_attr;
+    pthread_t tid;
+
+    if (worker_running || clock_is_virtual()
+        || property_get_int32(POWER_HINT_CLASS_PROP, 1) == 0)
+        return 0;
+
+    // The starvation deadline is in stats_now_ns() time
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&queue.more, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_attr_init(&thread_attr);
+    pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&tid, &thread_attr, &hint_class_worker, pm) != 0) {
+        pthread_attr_destroy(&thread_attr);
+        ALOGE("%s: Thread create fail", __func__);
+        return -EAGAIN;
+    }
+    pthread_attr_destroy(&thread_attr);
+
+    __atomic_store_n(&worker_running, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * hint_class_defer - queue @hint if it is a background hint
+ * @data: the data of powerHint()
+ * return: true if the worker applies it, false if the caller must
+ */
+bool hint_class_defer(power_hint_t hint, const int *data)
+{
+    struct hint_queued *queued = NULL;
+
+    if (hint_class_of(hint) != HINT_CLASS_BACKGROUND
+        || !__atomic_load_n(&worker_running, __ATOMIC_ACQUIRE))
+        return false;
+
+    pthread_mutex_lock(&queue.lock);
+    while (queue.count >= NUM_HINT_CLASS_QUEUE_MAX) {
+        queue.force = true;
+        pthread_cond_signal(&queue.more);
+        pthread_cond_wait(&queue.space, &queue.lock);
+    }
+
+    queued = &queue.ops[queue.count];
+    queued->op.hint = hint;
+    queued->op.enable = (data != NULL)? 1: 0;
+    queued->op.data = (data != NULL)? *data: 0;
+    queued->enqueue_ns = stats_now_ns();
+    __atomic_store_n(&queue.count, queue.count + 1, __ATOMIC_RELAXED);
+    class_stats[HINT_CLASS_BACKGROUND].deferred++;
+    pthread_cond_signal(&queue.more);
+    pthread_mutex_unlock(&queue.lock);
+
+    return true;
+}
+
+/**
+ * hint_class_take - empty the queue into @ops, oldest first
+ * return: the number of hints taken
+ *
+ * Called with the HAL lock held exclusive, for the worker and by the
+ * exclusive hints before they run, so a hint queued before a mode
+ * switch is never applied after it.
+ */
+int hint_class_take(struct hint_queued *ops)
+{
+    int count = 0;
+
+    if (__atomic_load_n(&queue.count, __ATOMIC_RELAXED) == 0)
+        return 0;
+
+    pthread_mutex_lock(&queue.lock);
+    count = queue.count;
+    memcpy(ops, queue.ops, count * sizeof(ops[0]));
+    __atomic_store_n(&queue.count, 0, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&queue.space);
+    pthread_mutex_unlock(&queue.lock);
+
+    return count;
+}
+
+// Called before a hint of @cls waits for the HAL lock
+void hint_class_enter(int cls)
+{
+    if (cls == HINT_CLASS_CRITICAL)
+        __atomic_fetch_add(&critical_inflight, 1, __ATOMIC_ACQ_REL);
+}
+
+// Called once the hint has released the HAL lock, wakes the worker held back by it
+void hint_class_exit(int cls)
+{
+    if (cls != HINT_CLASS_CRITICAL
+        || __atomic_sub_fetch(&critical_inflight, 1, __ATOMIC_ACQ_REL) != 0
+        || __atomic_load_n(&queue.count, __ATOMIC_RELAXED) == 0)
+        return;
+
+    pthread_mutex_lock(&queue.lock);
+    pthread_cond_signal(&queue.more);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+/**
+ * hint_class_locked - record the queueing delay of a hint of @cls
+ * @enter_ns: when the hint arrived, or was queued if deferred
+ * @locked_ns: when the HAL lock was taken to apply it
+ */
+void hint_class_locked(int cls, int64_t enter_ns, int64_t locked_ns)
+{
+    hist_add(&class_stats[cls].queue, (locked_ns - enter_ns) / MS_TO_US);
+}
+
+const struct hint_class_stats *hint_class_stats_get(int cls)
+{
+    return &class_stats[cls];
+}
+
+int hint_class_dump(int fd)
+{
+    pthread_mutex_lock(&queue.lock);
+    dprintf(fd, "Hint classes%s: queued=%d deferred=%llu starved=%llu forced=%llu\n"
+        , __atomic_load_n(&worker_running, __ATOMIC_ACQUIRE)? "": " (no background worker)"
+        , queue.count
+        , (unsigned long long)class_stats[HINT_CLASS_BACKGROUND].deferred
+        , (unsigned long long)class_stats[HINT_CLASS_BACKGROUND].starved
+        , (unsigned long long)class_stats[HINT_CLASS_BACKGROUND].forced);
+    pthread_mutex_unlock(&queue.lock);
+    for (int i = 0; i < HINT_CLASS_MAX; i++)
+        hist_dump(fd, class_names[i], &class_stats[i].queue);
+
+    return 0;
+}
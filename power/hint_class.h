@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INCLUDE_POWER_HINT_CLASS_H
+#define INCLUDE_POWER_HINT_CLASS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sprd_power.h"
+#include "stats.h"
+
+#define POWER_HINT_CLASS_PROP             "persist.vendor.power.hint_class"
+
+#define NUM_HINT_CLASS_QUEUE_MAX          64
+// The longest a queued background hint waits for critical hints to finish
+#define HINT_CLASS_STARVATION_MS          100
+
+enum {
+    HINT_CLASS_CRITICAL = 0,
+    HINT_CLASS_NORMAL,
+    HINT_CLASS_BACKGROUND,
+    HINT_CLASS_MAX,
+};
+
+/**
+ * struct hint_queued - a background hint waiting to be applied
+ * @op: the hint
+ * @enqueue_ns: monotonic time it was queued, see stats_now_ns()
+ */
+struct hint_queued {
+    struct power_hint_op op;
+    int64_t enqueue_ns;
+};
+
+/**
+ * struct hint_class_stats - what the hints of one class went through
+ * @queue: from the hint arriving to the HAL lock being taken to apply it
+ * @deferred: hints queued to the background worker
+ * @starved: hints applied after HINT_CLASS_STARVATION_MS with a
+ *           critical hint still in flight
+ * @forced: hints applied early because the queue was full
+ */
+struct hint_class_stats {
+    struct hist queue;
+    uint64_t deferred;
+    uint64_t starved;
+    uint64_t forced;
+};
+
+/*
+ * Touch and launch hints are critical, a few hints whose effect isn't
+ * bound to frames, like audio playback and temp_ctrl, are background
+ * and the rest are normal. Critical and
+ * normal hints are applied by the caller at once. Background hints are
+ * queued and applied in order by the power_hint_bg thread as a batch,
+ * once no critical hint is in flight, so they never hold the HAL lock
+ * while a touch boost waits for it. A background hint waits at most
+ * HINT_CLASS_STARVATION_MS. Every call that takes the HAL lock
+ * exclusive, a mode switch, a socket batch, the launch timeout or a PSI
+ * escalation, applies the queue first, so a background hint never
+ * lands after a call it came before. With the virtual
+ * clock, or with persist.vendor.power.hint_class set to 0, there is no
+ * worker and background hints are applied at once too.
+ */
+int hint_class_of(power_hint_t hint);
+int hint_class_start(struct sprd_power_module *pm);
+bool hint_class_defer(power_hint_t hint, const int *data);
+int hint_class_take(struct hint_queued *ops);
+void hint_class_enter(int cls);
+void hint_class_exit(int cls);
+void hint_class_locked(int cls, int64_t enter_ns, int64_t locked_ns);
+const struct hint_class_stats *hint_class_stats_get(int cls);
+const char *hint_class_name(int cls);
+int hint_class_dump(int fd);
+
+/*
+ * Takes the queued hints and applies them under one acquisition of the
+ * HAL lock, like power_hint_batch(). Defined by sprd_power.c.
+ */
+void power_hint_apply_queued(struct sprd_power_module *pm);
+#endif
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "sprd_power.h"
+#include "hint_ring.h"
+#include "thread_sched.h"
+
+#define HINT_RING_SLOT_MASK               (NUM_HINT_RING_SLOT - 1)
+
+// The ring of the HAL, valid while the worker runs
+static struct hint_ring_client ring = { NULL, -1 };
+static int ring_shm_fd = -1;
+static pthread_t ring_thread;
+static atomic_bool ring_stopping = false;
+static _Atomic uint64_t ring_drained = 0;
+static _Atomic uint64_t ring_wakeups = 0;
+
+int hint_ring_attach(struct hint_ring_client *client, int shm_fd, int event_fd)
+{
+    struct hint_ring_shm *shm = NULL;
+
+    shm = mmap(NULL, sizeof(struct hint_ring_shm), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (shm == MAP_FAILED) {
+        ALOGE("%s: mmap failed: %s", __func__, strerror(errno));
+        return -errno;
+    }
+
+    if (shm->magic != HINT_RING_MAGIC || shm->version != HINT_RING_VERSION
+        || shm->slots != NUM_HINT_RING_SLOT) {
+        ALOGE("%s: bad ring %08x v%u with %u slots", __func__, shm->magic, shm->version, shm->slots);
+        munmap(shm, sizeof(struct hint_ring_shm));
+        return -EINVAL;
+    }
+
+    client->shm = shm;
+    client->event_fd = event_fd;
+
+    return 0;
+}
+
+void hint_ring_detach(struct hint_ring_client *client)
+{
+    if (client->shm != NULL)
+        munmap(client->shm, sizeof(struct hint_ring_shm));
+    client->shm = NULL;
+    client->event_fd = -1;
+}
+
+/*
+ * Bounded MPSC queue: a producer claims a position by moving head, fills
+ * the slot and publishes it by storing its sequence. The store of the
+ * sequence and the load of sleeping pair with the HAL storing sleeping
+ * and re-checking the slot, so either the HAL sees the hint or the
+ * producer sees it sleeping and rings the doorbell.
+ */
+int hint_ring_post(struct hint_ring_client *client, int hint, const int *data)
+{
+    struct hint_ring_shm *shm = client->shm;
+    struct hint_ring_slot *slot = NULL;
+    uint32_t pos = atomic_load_explicit(&shm->head, memory_order_relaxed);
+    int32_t diff = 0;
+
+    for (;;) {
+        slot = &(shm->slot[pos & HINT_RING_SLOT_MASK]);
+        diff = (int32_t)(atomic_load_explicit(&slot->seq, memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&shm->head, &pos, pos + 1
+                , memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&shm->dropped, 1, memory_order_relaxed);
+            return -EAGAIN;
+        } else {
+            pos = atomic_load_explicit(&shm->head, memory_order_relaxed);
+        }
+    }
+
+    slot->hint = hint;
+    slot->data = (data != NULL)? *data: 0;
+    slot->flags = (data != NULL)? HINT_RING_F_DATA: 0;
+    atomic_store(&slot->seq, pos + 1);
+
+    if (atomic_load(&shm->sleeping) && atomic_exchange(&shm->sleeping, 0)) {
+        uint64_t one = 1;
+
+        if (write(client->event_fd, &one, sizeof(one)) != sizeof(one))
+            ALOGE("%s: ring doorbell failed: %s", __func__, strerror(errno));
+    }
+
+    return 0;
+}
+
+/**
+ * hint_ring_pending - the number of hints posted but not yet drained
+ */
+uint32_t hint_ring_pending(const struct hint_ring_client *client)
+{
+    return atomic_load(&client->shm->head) - atomic_load(&client->shm->tail);
+}
+
+// Whether the slot at @tail holds a published hint
+static bool slot_ready(struct hint_ring_shm *shm, uint32_t tail)
+{
+    struct hint_ring_slot *slot = &(shm->slot[tail & HINT_RING_SLOT_MASK]);
+
+    return atomic_load(&slot->seq) == tail + 1;
+}
+
+// Apply every published hint, return how many
+static int drain(struct sprd_power_module *pm, uint32_t *tail)
+{
+    struct hint_ring_shm *shm = ring.shm;
+    struct hint_ring_slot *slot = NULL;
+    int hint = 0;
+    int data = 0;
+    uint32_t flags = 0;
+    int count = 0;
+
+    while (slot_ready(shm, *tail)) {
+        slot = &(shm->slot[*tail & HINT_RING_SLOT_MASK]);
+        hint = slot->hint;
+        data = slot->data;
+        flags = slot->flags;
+
+        // Hand the slot back to producers before the slow part
+        atomic_store_explicit(&slot->seq, *tail + NUM_HINT_RING_SLOT, memory_order_release);
+        (*tail)++;
+        atomic_store_explicit(&shm->tail, *tail, memory_order_release);
+
+        pm->powerHint(pm, (power_hint_t)hint, (flags & HINT_RING_F_DATA)? &data: NULL);
+        count++;
+    }
+
+    return count;
+}
+
+static void *hint_ring_worker(void *args)
+{
+    struct sprd_power_module *pm = (struct sprd_power_module *)args;
+    struct hint_ring_shm *shm = ring.shm;
+    uint32_t tail = atomic_load(&shm->tail);
+    uint64_t value = 0;
+    int count = 0;
+
+    prctl(PR_SET_NAME, "power_hint_ring");
+    thread_sched_apply(THREAD_RING);
+    while (!atomic_load(&ring_stopping)) {
+        count = drain(pm, &tail);
+        if (count > 0) {
+            atomic_fetch_add_explicit(&ring_drained, count, memory_order_relaxed);
+            continue;
+        }
+
+        atomic_store(&shm->sleeping, 1);
+        if (!slot_ready(shm, tail) && !atomic_load(&ring_stopping)) {
+            if (read(ring.event_fd, &value, sizeof(value)) < 0 && errno != EINTR)
+                ALOGE("%s: read doorbell failed: %s", __func__, strerror(errno));
+            atomic_fetch_add_explicit(&ring_wakeups, 1, memory_order_relaxed);
+        }
+        atomic_store(&shm->sleeping, 0);
+    }
+
+    return NULL;
+}
+
+int hint_ring_init(struct sprd_power_module *pm)
+{
+    if (property_get_int32(POWER_HINT_RING_PROP, 0) == 0)
+        return 0;
+
+    return hint_ring_start(pm);
+}
+
+int hint_ring_start(struct sprd_power_module *pm)
+{
+    struct hint_ring_shm *shm = NULL;
+    int shm_fd = -1;
+    int event_fd = -1;
+    int ret = 0;
+
+    if (ring.shm != NULL)
+        return 0;
+
+    shm_fd = syscall(__NR_memfd_create, "power_hint_ring", MFD_CLOEXEC);
+    if (shm_fd < 0 || ftruncate(shm_fd, sizeof(struct hint_ring_shm)) != 0) {
+        ret = -errno;
+        ALOGE("%s: create ring failed: %s", __func__, strerror(errno));
+        goto out;
+    }
+
+    event_fd = eventfd(0, EFD_CLOEXEC);
+    if (event_fd < 0) {
+        ret = -errno;
+        ALOGE("%s: create doorbell failed: %s", __func__, strerror(errno));
+        goto out;
+    }
+
+    shm = mmap(NULL, sizeof(struct hint_ring_shm), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (shm == MAP_FAILED) {
+        ret = -errno;
+        ALOGE("%s: mmap failed: %s", __func__, strerror(errno));
+        goto out;
+    }
+
+    memset(shm, 0, sizeof(*shm));
+    shm->magic = HINT_RING_MAGIC;
+    shm->version = HINT_RING_VERSION;
+    shm->slots = NUM_HINT_RING_SLOT;
+    for (uint32_t i = 0; i < NUM_HINT_RING_SLOT; i++)
+        atomic_init(&(shm->slot[i].seq), i);
+
+    ring.shm = shm;
+    ring.event_fd = event_fd;
+    ring_shm_fd = shm_fd;
+    atomic_store(&ring_stopping, false);
+    if (pthread_create(&ring_thread, NULL, &hint_ring_worker, pm) != 0) {
+        ret = -EAGAIN;
+        ALOGE("%s: Thread create fail", __func__);
+        ring.shm = NULL;
+        ring.event_fd = -1;
+        ring_shm_fd = -1;
+        munmap(shm, sizeof(*shm));
+        goto out;
+    }
+
+    ALOGD("Hint ring of %d slots started", NUM_HINT_RING_SLOT);
+    return 0;
+
+out:
+    if (event_fd >= 0) close(event_fd);
+    if (shm_fd >= 0) close(shm_fd);
+    return ret;
+}
+
+/**
+ * hint_ring_stop - stop the worker once the posted hints are drained
+ */
+void hint_ring_stop(void)
+{
+    uint64_t one = 1;
+
+    if (ring.shm == NULL)
+        return;
+
+    while (hint_ring_pending(&ring) > 0)
+        usleep(1000);
+
+    atomic_store(&ring_stopping, true);
+    if (write(ring.event_fd, &one, sizeof(one)) != sizeof(one))
+        ALOGE("%s: ring doorbell failed: %s", __func__, strerror(errno));
+    pthread_join(ring_thread, NULL);
+
+    munmap(ring.shm, sizeof(struct hint_ring_shm));
+    close(ring.event_fd);
+    close(ring_shm_fd);
+    ring.shm = NULL;
+    ring.event_fd = -1;
+    ring_shm_fd = -1;
+}
+
+/**
+ * hint_ring_get_fds - the descriptors a client passes to hint_ring_attach()
+ *
+ * Returns 0, or -ENODEV if the ring is not enabled.
+ */
+int hint_ring_get_fds(int *shm_fd, int *event_fd)
+{
+    if (ring.shm == NULL)
+        return -ENODEV;
+
+    *shm_fd = ring_shm_fd;
+    *event_fd = ring.event_fd;
+    return 0;
+}
+
+int hint_ring_dump(int fd)
+{
+    if (ring.shm == NULL)
+        return 0;
+
+    dprintf(fd, "Hint ring: slots=%d pending=%u drained=%llu wakeups=%llu dropped=%llu\n"
+        , NUM_HINT_RING_SLOT, hint_ring_pending(&ring)
+        , (unsigned long long)atomic_load(&ring_drained)
+        , (unsigned long long)atomic_load(&ring_wakeups)
+        , (unsigned long long)atomic_load(&ring.shm->dropped));
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_HINT_RING_H
+#define INCLUDE_POWER_HINT_RING_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+struct sprd_power_module;
+
+#define POWER_HINT_RING_PROP              "persist.vendor.power.hint_ring"
+
+#define HINT_RING_MAGIC                   0x47524850 // "PHRG"
+#define HINT_RING_VERSION                 1
+// Must be a power of two
+#define NUM_HINT_RING_SLOT                256
+#define HINT_RING_CACHE_LINE              64
+
+// The slot carries a data value, else the hint is posted with data NULL
+#define HINT_RING_F_DATA                  0x1
+
+/**
+ * struct hint_ring_slot - one posted hint
+ * @seq: the slot is free to claim for position seq, and holds the hint
+ *       of position seq - 1 once published
+ * @hint: the power_hint_t
+ * @data: the int the hint data points to
+ * @flags: HINT_RING_F_*
+ */
+struct hint_ring_slot {
+    _Atomic uint32_t seq;
+    int32_t hint;
+    int32_t data;
+    uint32_t flags;
+};
+
+/**
+ * struct hint_ring_shm - the ring shared by the HAL and its clients
+ * @magic: HINT_RING_MAGIC
+ * @version: HINT_RING_VERSION
+ * @slots: NUM_HINT_RING_SLOT
+ * @head: the next position producers claim
+ * @tail: the next position the HAL drains
+ * @sleeping: the HAL waits on the doorbell, the next post rings it
+ * @dropped: posts refused because the ring was full
+ * @slot: the posted hints
+ *
+ * The fields written by producers and by the HAL live on separate cache
+ * lines so a post doesn't bounce the line the drain loop is using.
+ */
+struct hint_ring_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    alignas(HINT_RING_CACHE_LINE) _Atomic uint32_t head;
+    alignas(HINT_RING_CACHE_LINE) _Atomic uint32_t tail;
+    alignas(HINT_RING_CACHE_LINE) _Atomic uint32_t sleeping;
+    alignas(HINT_RING_CACHE_LINE) _Atomic uint64_t dropped;
+    alignas(HINT_RING_CACHE_LINE) struct hint_ring_slot slot[NUM_HINT_RING_SLOT];
+};
+
+/**
+ * struct hint_ring_client - a mapping of the ring in a client
+ * @shm: the mapped ring
+ * @event_fd: the doorbell, an eventfd
+ */
+struct hint_ring_client {
+    struct hint_ring_shm *shm;
+    int event_fd;
+};
+
+/*
+ * The client side, usable from any process given the two descriptors of
+ * hint_ring_get_fds(). hint_ring_post() is lock free and safe from any
+ * number of threads, it only enters the kernel to wake the HAL when the
+ * HAL is idle. It returns 0, or -EAGAIN if the ring is full.
+ */
+int hint_ring_attach(struct hint_ring_client *client, int shm_fd, int event_fd);
+void hint_ring_detach(struct hint_ring_client *client);
+int hint_ring_post(struct hint_ring_client *client, int hint, const int *data);
+uint32_t hint_ring_pending(const struct hint_ring_client *client);
+
+/*
+ * The HAL side. With persist.vendor.power.hint_ring set, hint_ring_init()
+ * creates the ring in a memfd and starts the power_hint_ring thread that
+ * drains it through pm->powerHint(). The descriptors are handed only to
+ * trusted clients. hint_ring_start() skips the property, for host tools.
+ */
+int hint_ring_init(struct sprd_power_module *pm);
+int hint_ring_start(struct sprd_power_module *pm);
+void hint_ring_stop(void);
+int hint_ring_get_fds(int *shm_fd, int *event_fd);
+int hint_ring_dump(int fd);
+#endif
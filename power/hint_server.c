@@ -0,0 +1,507 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <linux/memfd.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "sprd_power.h"
+#include "hint_ring.h"
+#include "hint_server.h"
+#include "thread_sched.h"
+#include "vfs.h"
+
+#define AID_ROOT                          0
+#define AID_SYSTEM                        1000
+
+// A hint_msg_boost is the larger entry
+#define LEN_HINT_MSG_MAX                  (sizeof(struct hint_msg_header) \
+                                                + NUM_HINT_MSG_BOOST_MAX * sizeof(struct hint_msg_boost))
+
+static struct sprd_power_module *server_pm = NULL;
+static pthread_t server_thread;
+static int listen_fd = -1;
+static int stop_fd = -1;
+static char socket_path[LEN_VFS_PATH_MAX];
+
+static uid_t allowed_uids[NUM_HINT_SERVER_UID_MAX];
+static int allowed_uid_count = 0;
+
+static void load_allowed_uids(void)
+{
+    char value[PROPERTY_VALUE_MAX] = {'\0'};
+    char *ptr = NULL;
+    char *save = NULL;
+
+    allowed_uid_count = 0;
+    allowed_uids[allowed_uid_count++] = AID_ROOT;
+    allowed_uids[allowed_uid_count++] = AID_SYSTEM;
+    allowed_uids[allowed_uid_count++] = getuid();
+
+    property_get(POWER_HINT_SERVER_UIDS_PROP, value, "");
+    for (ptr = strtok_r(value, ",", &save); ptr != NULL && allowed_uid_count < NUM_HINT_SERVER_UID_MAX
+        ; ptr = strtok_r(NULL, ",", &save))
+        allowed_uids[allowed_uid_count++] = (uid_t)atoi(ptr);
+}
+
+// Whether the peer of @fd may send hints
+static bool peer_allowed(int fd)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) {
+        ALOGE("%s: SO_PEERCRED failed: %s", __func__, strerror(errno));
+        return false;
+    }
+
+    for (int i = 0; i < allowed_uid_count; i++) {
+        if (cred.uid == allowed_uids[i])
+            return true;
+    }
+
+    ALOGE("Refuse hint client pid %d uid %d", cred.pid, cred.uid);
+    return false;
+}
+
+static int send_reply(int fd, const struct hint_msg_reply *reply, const int *fds, int fd_count)
+{
+    struct iovec iov = { (void *)reply, sizeof(*reply) };
+    struct msghdr msg;
+    char control[CMSG_SPACE(2 * sizeof(int))];
+    struct cmsghdr *cmsg = NULL;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fd_count > 0) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(fd_count * sizeof(int));
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(fd_count * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, fd_count * sizeof(int));
+    }
+
+    // A client that doesn't read its replies is dropped, not waited for
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) != sizeof(*reply)) {
+        if (errno == EAGAIN)
+            ALOGE("Drop hint client fd %d, its replies are not read", fd);
+        return -errno;
+    }
+
+    return 0;
+}
+
+// Write power_dump() to a new memfd at @fd, rewound for the client to read
+static int dump_to_memfd(int *fd)
+{
+    int ret = 0;
+
+    *fd = syscall(__NR_memfd_create, "power_dump", MFD_CLOEXEC);
+    if (*fd < 0)
+        return -errno;
+
+    ret = power_dump(server_pm, *fd);
+    if (ret == 0 && lseek(*fd, 0, SEEK_SET) != 0)
+        ret = -errno;
+    if (ret != 0) {
+        close(*fd);
+        *fd = -1;
+    }
+
+    return ret;
+}
+
+// The hints of a HINT_MSG_HINT request, as power_hint_batch() takes them
+static int apply_hints(const struct hint_msg_hint *hints, int count)
+{
+    struct power_hint_op ops[NUM_HINT_MSG_BOOST_MAX];
+
+    for (int i = 0; i < count; i++) {
+        ops[i].hint = (power_hint_t)hints[i].hint;
+        ops[i].enable = hints[i].enable;
+        ops[i].data = hints[i].data;
+    }
+
+    return power_hint_batch(server_pm, ops, count);
+}
+
+// Handle one request of the client @fd, return -1 if the client is gone
+static int handle_request(int fd)
+{
+    char buf[LEN_HINT_MSG_MAX];
+    const struct hint_msg_header *header = (const struct hint_msg_header *)buf;
+    struct hint_msg_reply reply;
+    int fds[2] = { -1, -1 };
+    int fd_count = 0;
+    ssize_t len = 0;
+    int ret = 0;
+
+    len = recv(fd, buf, sizeof(buf), MSG_TRUNC);
+    if (len <= 0)
+        return -1;
+
+    memset(&reply, 0, sizeof(reply));
+    reply.magic = HINT_MSG_MAGIC;
+    if ((size_t)len < sizeof(*header) || (size_t)len > sizeof(buf)
+        || header->magic != HINT_MSG_MAGIC || header->version != HINT_MSG_VERSION) {
+        reply.status = -EINVAL;
+        return send_reply(fd, &reply, NULL, 0);
+    }
+
+    reply.seq = header->seq;
+    switch (header->type) {
+        case HINT_MSG_BOOST:
+            if (header->count > NUM_HINT_MSG_BOOST_MAX
+                || (size_t)len != sizeof(*header) + header->count * sizeof(struct hint_msg_boost)) {
+                reply.status = -EINVAL;
+                break;
+            }
+
+            ret = power_boost_batch(server_pm, (const struct hint_msg_boost *)(header + 1), header->count);
+            if (ret < 0)
+                reply.status = ret;
+            else
+                reply.applied = ret;
+            break;
+        case HINT_MSG_HINT:
+            if (header->count > NUM_HINT_MSG_BOOST_MAX
+                || (size_t)len != sizeof(*header) + header->count * sizeof(struct hint_msg_hint)) {
+                reply.status = -EINVAL;
+                break;
+            }
+
+            ret = apply_hints((const struct hint_msg_hint *)(header + 1), header->count);
+            if (ret < 0)
+                reply.status = ret;
+            else
+                reply.applied = ret;
+            break;
+        case HINT_MSG_GET_RING:
+            reply.status = hint_ring_get_fds(&fds[0], &fds[1]);
+            if (reply.status == 0)
+                fd_count = 2;
+            break;
+        case HINT_MSG_DUMP:
+            reply.status = dump_to_memfd(&fds[0]);
+            if (reply.status == 0)
+                fd_count = 1;
+            break;
+        default:
+            reply.status = -EINVAL;
+            break;
+    }
+
+    ret = send_reply(fd, &reply, fds, fd_count);
+    // The ring descriptors stay with the ring, the dump is the client's now
+    if (header->type == HINT_MSG_DUMP && fds[0] >= 0)
+        close(fds[0]);
+
+    return ret;
+}
+
+static void *hint_server_loop(void __unused *args)
+{
+    struct pollfd fds[NUM_HINT_SERVER_CLIENT_MAX + 2];
+    int count = 2;
+    int fd = -1;
+
+    prctl(PR_SET_NAME, "power_hint_sock");
+    thread_sched_apply(THREAD_SOCKET);
+    fds[0].fd = stop_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = listen_fd;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            ALOGE("%s: poll failed: %s", __func__, strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents != 0)
+            break;
+
+        // Drop the clients that hung up or sent a bad packet
+        for (int i = 2; i < count; i++) {
+            if (fds[i].revents == 0)
+                continue;
+
+            if ((fds[i].revents & POLLIN) == 0 || handle_request(fds[i].fd) != 0) {
+                close(fds[i].fd);
+                fds[i--] = fds[--count];
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd < 0)
+                continue;
+
+            if (count >= NUM_HINT_SERVER_CLIENT_MAX + 2) {
+                ALOGE("Too many hint clients");
+                close(fd);
+            } else if (!peer_allowed(fd)) {
+                close(fd);
+            } else {
+                fds[count].fd = fd;
+                fds[count].events = POLLIN;
+                fds[count++].revents = 0;
+            }
+        }
+    }
+
+    for (int i = 2; i < count; i++)
+        close(fds[i].fd);
+
+    return NULL;
+}
+
+int hint_server_init(struct sprd_power_module *pm)
+{
+    if (property_get_int32(POWER_HINT_SERVER_PROP, 0) == 0)
+        return 0;
+
+    return hint_server_start(pm);
+}
+
+int hint_server_start(struct sprd_power_module *pm)
+{
+    struct sockaddr_un addr;
+    int ret = 0;
+
+    if (listen_fd >= 0)
+        return 0;
+
+    load_allowed_uids();
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    vfs_path(PATH_HINT_SOCKET, socket_path, sizeof(socket_path));
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        ALOGE("%s: %s is too long", __func__, socket_path);
+        return -ENAMETOOLONG;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (listen_fd < 0 || stop_fd < 0) {
+        ret = -errno;
+        ALOGE("%s: create socket failed: %s", __func__, strerror(errno));
+        goto fail;
+    }
+
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+        || chmod(socket_path, 0666) != 0 || listen(listen_fd, NUM_HINT_SERVER_CLIENT_MAX) != 0) {
+        ret = -errno;
+        ALOGE("%s: listen on %s failed: %s", __func__, socket_path, strerror(errno));
+        goto fail;
+    }
+
+    server_pm = pm;
+    if (pthread_create(&server_thread, NULL, &hint_server_loop, NULL) != 0) {
+        ret = -EAGAIN;
+        ALOGE("%s: Thread create fail", __func__);
+        goto fail;
+    }
+
+    ALOGD("Hint server listens on %s", socket_path);
+    return 0;
+
+fail:
+    if (listen_fd >= 0) close(listen_fd);
+    if (stop_fd >= 0) close(stop_fd);
+    listen_fd = -1;
+    stop_fd = -1;
+    return ret;
+}
+
+void hint_server_stop(void)
+{
+    uint64_t one = 1;
+
+    if (listen_fd < 0)
+        return;
+
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one))
+        ALOGE("%s: stop failed: %s", __func__, strerror(errno));
+    pthread_join(server_thread, NULL);
+
+    close(listen_fd);
+    close(stop_fd);
+    unlink(socket_path);
+    listen_fd = -1;
+    stop_fd = -1;
+}
+
+int hint_client_connect(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd = -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path == NULL)
+        vfs_path(PATH_HINT_SOCKET, addr.sun_path, sizeof(addr.sun_path));
+    else
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -errno;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int ret = -errno;
+
+        close(fd);
+        return ret;
+    }
+
+    return fd;
+}
+
+// Send @len bytes of request at @msg and wait for the reply, with @fds if it carries any
+static int transact(int fd, const void *msg, size_t len, struct hint_msg_reply *reply, int *fds, int fd_count)
+{
+    struct iovec iov = { reply, sizeof(*reply) };
+    struct msghdr hdr;
+    char control[CMSG_SPACE(2 * sizeof(int))];
+    struct cmsghdr *cmsg = NULL;
+
+    if (send(fd, msg, len, MSG_NOSIGNAL) != (ssize_t)len)
+        return -errno;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+    if (recvmsg(fd, &hdr, MSG_CMSG_CLOEXEC) != sizeof(*reply))
+        return -EPROTO;
+
+    cmsg = CMSG_FIRSTHDR(&hdr);
+    if (fd_count > 0 && reply->status == 0) {
+        if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS
+            || cmsg->cmsg_len != CMSG_LEN(fd_count * sizeof(int)))
+            return -EPROTO;
+        memcpy(fds, CMSG_DATA(cmsg), fd_count * sizeof(int));
+    }
+
+    return (reply->magic == HINT_MSG_MAGIC)? reply->status: -EPROTO;
+}
+
+int hint_client_boost(int fd, const struct hint_msg_boost *boosts, int count)
+{
+    char buf[LEN_HINT_MSG_MAX];
+    struct hint_msg_header *header = (struct hint_msg_header *)buf;
+    struct hint_msg_reply reply;
+    int ret = 0;
+
+    if (count < 0 || count > NUM_HINT_MSG_BOOST_MAX)
+        return -EINVAL;
+
+    header->magic = HINT_MSG_MAGIC;
+    header->version = HINT_MSG_VERSION;
+    header->type = HINT_MSG_BOOST;
+    header->count = count;
+    header->seq = 0;
+    memcpy(header + 1, boosts, count * sizeof(struct hint_msg_boost));
+
+    ret = transact(fd, buf, sizeof(*header) + count * sizeof(struct hint_msg_boost), &reply, NULL, 0);
+
+    return (ret < 0)? ret: (int)reply.applied;
+}
+
+int hint_client_hint(int fd, const struct hint_msg_hint *hints, int count)
+{
+    char buf[LEN_HINT_MSG_MAX];
+    struct hint_msg_header *header = (struct hint_msg_header *)buf;
+    struct hint_msg_reply reply;
+    int ret = 0;
+
+    if (count < 0 || count > NUM_HINT_MSG_BOOST_MAX)
+        return -EINVAL;
+
+    header->magic = HINT_MSG_MAGIC;
+    header->version = HINT_MSG_VERSION;
+    header->type = HINT_MSG_HINT;
+    header->count = count;
+    header->seq = 0;
+    memcpy(header + 1, hints, count * sizeof(struct hint_msg_hint));
+
+    ret = transact(fd, buf, sizeof(*header) + count * sizeof(struct hint_msg_hint), &reply, NULL, 0);
+
+    return (ret < 0)? ret: (int)reply.applied;
+}
+
+int hint_client_get_ring(int fd, int *shm_fd, int *event_fd)
+{
+    struct hint_msg_header header;
+    struct hint_msg_reply reply;
+    int fds[2] = { -1, -1 };
+    int ret = 0;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = HINT_MSG_MAGIC;
+    header.version = HINT_MSG_VERSION;
+    header.type = HINT_MSG_GET_RING;
+
+    ret = transact(fd, &header, sizeof(header), &reply, fds, 2);
+    if (ret == 0) {
+        *shm_fd = fds[0];
+        *event_fd = fds[1];
+    }
+
+    return ret;
+}
+
+int hint_client_dump(int fd, int *dump_fd)
+{
+    struct hint_msg_header header;
+    struct hint_msg_reply reply;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = HINT_MSG_MAGIC;
+    header.version = HINT_MSG_VERSION;
+    header.type = HINT_MSG_DUMP;
+
+    return transact(fd, &header, sizeof(header), &reply, dump_fd, 1);
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_HINT_SERVER_H
+#define INCLUDE_POWER_HINT_SERVER_H
+
+#include <stdint.h>
+
+struct sprd_power_module;
+
+#define POWER_HINT_SERVER_PROP            "persist.vendor.power.hint_server"
+// Comma separated uids allowed besides root, system and the HAL's own uid
+#define POWER_HINT_SERVER_UIDS_PROP       "persist.vendor.power.hint_uids"
+#define PATH_HINT_SOCKET                  "/data/vendor/power/hint.sock"
+
+#define HINT_MSG_MAGIC                    0x4d485750 // "PWHM"
+#define HINT_MSG_VERSION                  1
+// Entries of one HINT_MSG_BOOST or HINT_MSG_HINT request
+#define NUM_HINT_MSG_BOOST_MAX            64
+#define NUM_HINT_SERVER_CLIENT_MAX        8
+#define NUM_HINT_SERVER_UID_MAX           8
+
+enum {
+    // count struct hint_msg_boost follow the header
+    HINT_MSG_BOOST = 1,
+    // The reply carries the hint ring descriptors as SCM_RIGHTS
+    HINT_MSG_GET_RING,
+    // The reply carries a memfd holding the text of power_dump()
+    HINT_MSG_DUMP,
+    // count struct hint_msg_hint follow the header
+    HINT_MSG_HINT,
+};
+
+/**
+ * struct hint_msg_header - the head of every request, one per packet
+ * @magic: HINT_MSG_MAGIC
+ * @version: HINT_MSG_VERSION
+ * @type: HINT_MSG_*
+ * @count: the number of entries following the header
+ * @seq: echoed in the reply
+ */
+struct hint_msg_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    uint32_t count;
+    uint32_t seq;
+};
+
+/**
+ * struct hint_msg_boost - enter or exit a scene, as boost() does
+ * @scene_id: the id of power_scene_id_define.txt
+ * @subtype: the subtype of the scene
+ * @enable: 1 to enter the scene, 0 to exit
+ * @duration: ms the request lasts, 0 until it is exited
+ */
+struct hint_msg_boost {
+    int32_t scene_id;
+    int32_t subtype;
+    int32_t enable;
+    int32_t duration;
+};
+
+/**
+ * struct hint_msg_hint - a hint, as powerHint() takes it
+ * @hint: the hint id, a power_hint_t or vendor hint of hint_id.h
+ * @enable: if 0 powerHint() would be passed NULL data
+ * @data: the int the data of powerHint() would point to if @enable
+ */
+struct hint_msg_hint {
+    int32_t hint;
+    int32_t enable;
+    int32_t data;
+};
+
+/**
+ * struct hint_msg_reply - the answer to every request
+ * @magic: HINT_MSG_MAGIC
+ * @seq: the seq of the request
+ * @status: 0 or -errno
+ * @applied: the number of scenes or hints applied
+ */
+struct hint_msg_reply {
+    uint32_t magic;
+    uint32_t seq;
+    int32_t status;
+    uint32_t applied;
+};
+
+/*
+ * A SOCK_SEQPACKET server at PATH_HINT_SOCKET, one request per packet.
+ * Anyone may open the socket, peers are checked by SO_PEERCRED when
+ * they connect; SELinux lets the power_hint_client domains in. A peer
+ * whose replies would block the server is dropped. All scenes of a
+ * HINT_MSG_BOOST request, or hints of a HINT_MSG_HINT one, are applied
+ * under one acquisition of the HAL lock, by power_boost_batch() of
+ * sprd_power.c or power_hint_batch(). hint_server_init() starts it if
+ * persist.vendor.power.hint_server is set, hint_server_start()
+ * unconditionally, for host tools.
+ */
+int hint_server_init(struct sprd_power_module *pm);
+int power_boost_batch(struct sprd_power_module *pm, const struct hint_msg_boost *boosts, int count);
+int hint_server_start(struct sprd_power_module *pm);
+void hint_server_stop(void);
+
+/*
+ * The client side, @path NULL for PATH_HINT_SOCKET. hint_client_boost()
+ * and hint_client_hint() return the number of scenes or hints applied,
+ * the calls return -errno if the request failed or was refused.
+ */
+int hint_client_connect(const char *path);
+int hint_client_boost(int fd, const struct hint_msg_boost *boosts, int count);
+int hint_client_hint(int fd, const struct hint_msg_hint *hints, int count);
+int hint_client_get_ring(int fd, int *shm_fd, int *event_fd);
+int hint_client_dump(int fd, int *dump_fd);
+#endif
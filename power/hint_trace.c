@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "hint_trace.h"
+#include "stats.h"
+#include "vfs.h"
+
+int hint_trace_fd = -1;
+
+static int64_t start_ns = 0;
+static uint32_t record_count = 0;
+
+/**
+ * hint_trace_init - start recording the calls into the HAL if enabled
+ *
+ * Every record is one O_APPEND write, so concurrent callers never
+ * interleave and a record is on disk as soon as the call returns.
+ */
+void hint_trace_init(void)
+{
+    struct hint_trace_header header;
+
+    if (hint_trace_fd >= 0 || property_get_int32(POWER_HINT_TRACE_CALLS_PROP, 0) == 0)
+        return;
+
+    hint_trace_fd = vfs_open(PATH_HINT_TRACE, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640);
+    if (hint_trace_fd < 0) {
+        ALOGE("open %s failed: %s", PATH_HINT_TRACE, strerror(errno));
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = HINT_TRACE_MAGIC;
+    header.version = HINT_TRACE_VERSION;
+    header.record_size = sizeof(struct hint_trace_record);
+    header.start_ns = start_ns = stats_now_ns();
+    if (write(hint_trace_fd, &header, sizeof(header)) != sizeof(header)) {
+        ALOGE("write %s failed: %s", PATH_HINT_TRACE, strerror(errno));
+        vfs_close(hint_trace_fd);
+        hint_trace_fd = -1;
+        return;
+    }
+
+    ALOGD("Power HAL hint trace enabled");
+}
+
+void hint_trace_record(int type, int hint, const int *data)
+{
+    struct hint_trace_record record;
+
+    if (__atomic_fetch_add(&record_count, 1, __ATOMIC_RELAXED) >= NUM_HINT_TRACE_RECORD_MAX)
+        return;
+
+    memset(&record, 0, sizeof(record));
+    record.ts_ns = stats_now_ns() - start_ns;
+    record.type = type;
+    record.hint = hint;
+    if (data != NULL) {
+        record.flags |= HINT_TRACE_FLAG_DATA;
+        record.data = *data;
+    }
+
+    write(hint_trace_fd, &record, sizeof(record));
+}
+
+/**
+ * hint_trace_read - load a whole trace file pulled from a device
+ * @records: returns the records, to be freed by the caller
+ *
+ * Returns the number of records, or -1 if @path is not a trace of this
+ * version. Used by the host tools that replay a trace.
+ */
+int hint_trace_read(const char *path, struct hint_trace_record **records)
+{
+    struct hint_trace_header header;
+    struct hint_trace_record *buf = NULL;
+    FILE *fp = NULL;
+    int count = 0;
+    int size = 0;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        ALOGE("open %s failed: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != HINT_TRACE_MAGIC
+        || header.version != HINT_TRACE_VERSION
+        || header.record_size != sizeof(struct hint_trace_record)) {
+        ALOGE("%s is not a version %d hint trace", path, HINT_TRACE_VERSION);
+        fclose(fp);
+        return -1;
+    }
+
+    *records = NULL;
+    while (1) {
+        if (count == size) {
+            size = (size > 0)? size * 2: 1024;
+            buf = realloc(*records, size * sizeof(struct hint_trace_record));
+            if (buf == NULL)
+                break;
+            *records = buf;
+        }
+        if (fread(*records + count, sizeof(struct hint_trace_record), 1, fp) != 1)
+            break;
+        count++;
+    }
+    fclose(fp);
+
+    return count;
+}
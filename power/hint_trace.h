@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INCLUDE_POWER_HINT_TRACE_H
+#define INCLUDE_POWER_HINT_TRACE_H
+
+#include <stdint.h>
+#include <cutils/compiler.h>
+
+#define POWER_HINT_TRACE_CALLS_PROP       "persist.vendor.power.hint_trace"
+#define PATH_HINT_TRACE                   "/data/vendor/power/hint_trace.bin"
+
+#define HINT_TRACE_MAGIC                  0x52544850 // "PHTR"
+#define HINT_TRACE_VERSION                1
+// Recording stops when the file is full, about 1.5MB
+#define NUM_HINT_TRACE_RECORD_MAX         65536
+
+enum {
+    HINT_TRACE_HINT = 1,
+    HINT_TRACE_INTERACTIVE,
+    HINT_TRACE_CTRL,
+    HINT_TRACE_MAX,
+};
+
+// The hint was called with a data pointer
+#define HINT_TRACE_FLAG_DATA              (1 << 0)
+
+/**
+ * struct hint_trace_header - the head of a hint trace file, 16 bytes
+ * @magic: HINT_TRACE_MAGIC
+ * @version: HINT_TRACE_VERSION
+ * @record_size: sizeof(struct hint_trace_record)
+ * @start_ns: monotonic time the trace was started, records are relative to it
+ */
+struct hint_trace_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    int64_t start_ns;
+};
+
+/**
+ * struct hint_trace_record - one call into the HAL, 24 bytes, little endian
+ * @ts_ns: time of the call since start_ns
+ * @type: HINT_TRACE_*
+ * @flags: HINT_TRACE_FLAG_*
+ * @hint: the hint id, 0 for the other calls
+ * @data: *data of a hint, the argument of setInteractive and ctrl_power_hint
+ */
+struct hint_trace_record {
+    int64_t ts_ns;
+    uint16_t type;
+    uint16_t flags;
+    int32_t hint;
+    int32_t data;
+    int32_t reserved;
+};
+
+// The trace file fd, -1 if recording is disabled
+extern int hint_trace_fd;
+
+void hint_trace_init(void);
+void hint_trace_record(int type, int hint, const int *data);
+int hint_trace_read(const char *path, struct hint_trace_record **records);
+
+#define HINT_TRACE(type, hint, data) \
+    do { if (CC_UNLIKELY(hint_trace_fd >= 0)) hint_trace_record(type, hint, data); } while (0)
+#endif
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "../config.h"
+#include "../devfreq.h"
+#include "../thread_sched.h"
+#include "../vfs.h"
+#include "fakefs.h"
+
+static const char *config_files[] = {
+    "power_scene_config.xml",
+    "power_resource_file_info.xml",
+    "power_scene_id_define.txt",
+};
+
+// mkdir -p @path
+static int make_dirs(const char *path)
+{
+    char buf[LEN_VFS_PATH_MAX] = {'\0'};
+
+    snprintf(buf, sizeof(buf), "%s", path);
+    for (char *p = buf + 1; *p != '\0'; p++) {
+        if (*p != '/')
+            continue;
+
+        *p = '\0';
+        if (mkdir(buf, 0755) != 0 && errno != EEXIST)
+            return -1;
+        *p = '/';
+    }
+    if (mkdir(buf, 0755) != 0 && errno != EEXIST)
+        return -1;
+
+    return 0;
+}
+
+static int write_file(const char *path, const char *buf, int len)
+{
+    int fd = -1;
+    int ret = 0;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ALOGE("Open %s fail: %s", path, strerror(errno));
+        return -1;
+    }
+    if (write(fd, buf, len) != len)
+        ret = -1;
+    close(fd);
+
+    return ret;
+}
+
+static int copy_file(const char *from, const char *to)
+{
+    char *buf = NULL;
+    long len = 0;
+    FILE *fp = NULL;
+    int ret = -1;
+
+    fp = fopen(from, "r");
+    if (fp == NULL) {
+        ALOGE("Open %s fail: %s", from, strerror(errno));
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = malloc(len + 1);
+    if (buf != NULL && fread(buf, 1, len, fp) == (size_t)len)
+        ret = write_file(to, buf, len);
+
+    free(buf);
+    fclose(fp);
+
+    return ret;
+}
+
+// Create the node <root>@dir/@file holding @value
+static int create_node(const char *root, const char *dir, const char *file, const char *value)
+{
+    char buf[LEN_VFS_PATH_MAX] = {'\0'};
+
+    snprintf(buf, sizeof(buf), "%s%s", root, dir);
+    if (make_dirs(buf) != 0) {
+        ALOGE("Create %s fail: %s", buf, strerror(errno));
+        return -1;
+    }
+
+    snprintf(buf, sizeof(buf), "%s%s/%s", root, dir, file);
+
+    return write_file(buf, value, strlen(value));
+}
+
+static char *get_def_value(xmlNodePtr node)
+{
+    for (xmlNodePtr attr = node->children; attr != NULL; attr = attr->next) {
+        char *name = NULL;
+
+        if (attr->type != XML_ELEMENT_NODE || xmlStrcmp(attr->name, BAD_CAST"attr"))
+            continue;
+
+        name = (char *)xmlGetProp(attr, BAD_CAST"name");
+        if (name != NULL && strcmp(name, "def_value") == 0) {
+            xmlFree(name);
+            return (char *)xmlGetProp(attr, BAD_CAST"value");
+        }
+        xmlFree(name);
+    }
+
+    return NULL;
+}
+
+// Create every <file> and subsys <inode> named by the resource file
+static int create_nodes(const char *root, const char *resource)
+{
+    xmlDocPtr doc = NULL;
+    xmlNodePtr node = NULL;
+    int ret = 0;
+
+    doc = xmlParseFile(resource);
+    if (doc == NULL) {
+        ALOGE("Parse %s fail", resource);
+        return -1;
+    }
+
+    node = xmlDocGetRootElement(doc);
+    for (node = (node != NULL)? node->children: NULL; node != NULL; node = node->next) {
+        char *path = NULL;
+        char *file = NULL;
+        char *value = NULL;
+
+        if (node->type != XML_ELEMENT_NODE)
+            continue;
+
+        if (xmlStrcmp(node->name, BAD_CAST"file") == 0) {
+            path = (char *)xmlGetProp(node, BAD_CAST"path");
+            file = (char *)xmlGetProp(node, BAD_CAST"file");
+            value = get_def_value(node);
+            // A subsys is a group of inodes, not a node by itself
+            if (path != NULL && file != NULL && strcmp(path, "subsys") != 0)
+                ret |= create_node(root, path, file, (value != NULL)? value: "0");
+            xmlFree(path);
+            xmlFree(file);
+            xmlFree(value);
+        } else if (xmlStrcmp(node->name, BAD_CAST"subsys") == 0) {
+            for (xmlNodePtr inode = node->children; inode != NULL; inode = inode->next) {
+                if (inode->type != XML_ELEMENT_NODE || xmlStrcmp(inode->name, BAD_CAST"inode"))
+                    continue;
+
+                path = (char *)xmlGetProp(inode, BAD_CAST"path");
+                file = (char *)xmlGetProp(inode, BAD_CAST"file");
+                value = (char *)xmlGetProp(inode, BAD_CAST"def_value");
+                if (path != NULL && file != NULL)
+                    ret |= create_node(root, path, file, (value != NULL)? value: "0");
+                xmlFree(path);
+                xmlFree(file);
+                xmlFree(value);
+            }
+        }
+    }
+    xmlFreeDoc(doc);
+
+    return ret;
+}
+
+/**
+ * fakefs_create - build a fake node tree from the config files in @config_dir
+ * @root: returns the root of the tree
+ *
+ * Returns 0 on success, the vfs root is then set to @root.
+ */
+int fakefs_create(const char *config_dir, char *root, int size)
+{
+    char from[LEN_VFS_PATH_MAX] = {'\0'};
+    char to[LEN_VFS_PATH_MAX] = {'\0'};
+    const char *base = PATH_FAKEFS_SHM;
+    char *dir = NULL;
+
+    if (access(base, W_OK) != 0)
+        base = PATH_FAKEFS_TMP;
+
+    snprintf(root, size, "%s/powerhint.XXXXXX", base);
+    dir = mkdtemp(root);
+    if (dir == NULL) {
+        ALOGE("Create %s fail: %s", root, strerror(errno));
+        return -1;
+    }
+
+    snprintf(to, sizeof(to), "%s/vendor/etc", root);
+    if (make_dirs(to) != 0)
+        goto fail;
+    for (unsigned int i = 0; i < sizeof(config_files)/sizeof(config_files[0]); i++) {
+        // The scene id file is shared by all products, one level up
+        snprintf(from, sizeof(from), "%s/%s", config_dir, config_files[i]);
+        if (access(from, R_OK) != 0)
+            snprintf(from, sizeof(from), "%s/../%s", config_dir, config_files[i]);
+        snprintf(to, sizeof(to), "%s/vendor/etc/%s", root, config_files[i]);
+        if (copy_file(from, to) != 0)
+            goto fail;
+    }
+
+    snprintf(to, sizeof(to), "%s/data/vendor/power", root);
+    if (make_dirs(to) != 0)
+        goto fail;
+
+    vfs_set_root(root);
+    if (create_nodes(root, vfs_path(PATH_RESOURCE_FILE_INFO, to, sizeof(to))) != 0)
+        goto fail;
+    if (fakefs_write(PATH_DEVFREQ_DDR_FREQ_TABLE, FAKEFS_DDR_FREQ_TABLE) != 0)
+        goto fail;
+    if (fakefs_write(PATH_LITTLE_CLUSTER_CPUS, FAKEFS_LITTLE_CLUSTER_CPUS) != 0)
+        goto fail;
+
+    return 0;
+
+fail:
+    fakefs_destroy(root);
+    return -1;
+}
+
+static int remove_entry(const char *path, const struct stat *sb, int type, struct FTW *ftw)
+{
+    (void)sb;
+    (void)type;
+    (void)ftw;
+
+    return remove(path);
+}
+
+void fakefs_destroy(const char *root)
+{
+    if (root == NULL || strlen(root) == 0)
+        return;
+
+    vfs_set_root(NULL);
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/**
+ * fakefs_read - read back the node at the device path @path
+ *
+ * Returns the length of @value, -1 if the node does not exist.
+ */
+int fakefs_read(const char *path, char *value, int size)
+{
+    char buf[LEN_VFS_PATH_MAX] = {'\0'};
+    int fd = -1;
+    int n = 0;
+
+    fd = open(vfs_path(path, buf, sizeof(buf)), O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    n = read(fd, value, size - 1);
+    close(fd);
+    if (n < 0)
+        return -1;
+
+    value[n] = '\0';
+    while (n > 0 && (value[n - 1] == '\n' || value[n - 1] == ' '))
+        value[--n] = '\0';
+
+    return n;
+}
+
+/**
+ * fakefs_write - create or overwrite the node at the device path @path
+ */
+int fakefs_write(const char *path, const char *value)
+{
+    char buf[LEN_VFS_PATH_MAX] = {'\0'};
+    char dir[LEN_VFS_PATH_MAX] = {'\0'};
+    char *slash = NULL;
+
+    snprintf(dir, sizeof(dir), "%s", vfs_path(path, buf, sizeof(buf)));
+    slash = strrchr(dir, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+        if (make_dirs(dir) != 0)
+            return -1;
+    }
+
+    return write_file(vfs_path(path, buf, sizeof(buf)), value, strlen(value));
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INCLUDE_POWER_HOST_FAKEFS_H
+#define INCLUDE_POWER_HOST_FAKEFS_H
+
+#define PATH_FAKEFS_SHM                   "/dev/shm"
+#define PATH_FAKEFS_TMP                   "/tmp"
+#define FAKEFS_DDR_FREQ_TABLE             "256 384 512 768 933"
+#define FAKEFS_LITTLE_CLUSTER_CPUS        "0"
+
+/*
+ * A fake node tree for running the HAL core on a host: the three config
+ * files of @config_dir (or its parent) are copied to <root>/vendor/etc and every node
+ * named by the resource file is created with its default value. The
+ * tree lives on tmpfs when available and the vfs root points at it
+ * until fakefs_destroy(). Nodes are plain files: a node released by
+ * closing its fd keeps the last value written.
+ */
+int fakefs_create(const char *config_dir, char *root, int size);
+void fakefs_destroy(const char *root);
+
+int fakefs_read(const char *path, char *value, int size);
+int fakefs_write(const char *path, const char *value);
+#endif
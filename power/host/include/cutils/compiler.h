@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for <cutils/compiler.h>, also supplies the few bionic
+ * extensions the HAL core relies on.
+ */
+#ifndef INCLUDE_POWER_HOST_CUTILS_COMPILER_H
+#define INCLUDE_POWER_HOST_CUTILS_COMPILER_H
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define CC_LIKELY(exp)                    (__builtin_expect(!!(exp), 1))
+#define CC_UNLIKELY(exp)                  (__builtin_expect(!!(exp), 0))
+
+#ifndef __unused
+#define __unused                          __attribute__((__unused__))
+#endif
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id            _sigev_un._tid
+#endif
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 30)
+#define gettid()                          ((pid_t)syscall(SYS_gettid))
+#endif
+#endif
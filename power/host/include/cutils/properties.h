@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for libcutils properties: an in-process table that
+ * host tools fill with property_set() before calling the HAL.
+ */
+#ifndef INCLUDE_POWER_HOST_CUTILS_PROPERTIES_H
+#define INCLUDE_POWER_HOST_CUTILS_PROPERTIES_H
+
+#include <stdint.h>
+
+#define PROPERTY_KEY_MAX                  32
+#define PROPERTY_VALUE_MAX                92
+
+int property_get(const char *key, char *value, const char *default_value);
+int property_set(const char *key, const char *value);
+int32_t property_get_int32(const char *key, int32_t default_value);
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for <hardware/power.h>, must stay in sync with the
+ * libhardware definitions used by the Power HAL.
+ */
+#ifndef INCLUDE_POWER_HOST_HARDWARE_POWER_H
+#define INCLUDE_POWER_HOST_HARDWARE_POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define POWER_STATE_NAME_MAX_LENGTH       100
+#define POWER_STATE_VOTER_NAME_MAX_LENGTH 100
+
+typedef enum {
+    POWER_HINT_VSYNC = 0x00000001,
+    POWER_HINT_INTERACTION = 0x00000002,
+    POWER_HINT_VIDEO_ENCODE = 0x00000003,
+    POWER_HINT_VIDEO_DECODE = 0x00000004,
+    POWER_HINT_LOW_POWER = 0x00000005,
+    POWER_HINT_SUSTAINED_PERFORMANCE = 0x00000006,
+    POWER_HINT_VR_MODE = 0x00000007,
+    POWER_HINT_LAUNCH = 0x00000008,
+    POWER_HINT_DISABLE_TOUCH = 0x00000009,
+} power_hint_t;
+
+typedef enum {
+    POWER_FEATURE_DOUBLE_TAP_TO_WAKE = 0x00000001,
+} feature_t;
+
+typedef struct {
+    char name[POWER_STATE_VOTER_NAME_MAX_LENGTH];
+    uint64_t total_time_in_msec_voted_for_since_boot;
+    uint64_t total_number_of_times_voted_since_boot;
+} power_state_voter_t;
+
+typedef struct {
+    char name[POWER_STATE_NAME_MAX_LENGTH];
+    uint64_t residency_in_msec_since_boot;
+    uint64_t total_transitions;
+    bool supported_only_in_suspend;
+    uint32_t number_of_voters;
+    power_state_voter_t *voters;
+} power_state_platform_sleep_state_t;
+#endif
@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Bionic lets <linux/time.h> and <time.h> coexist, glibc does not; on
+ * the host the libc definitions are enough.
+ */
+#ifndef INCLUDE_POWER_HOST_LINUX_TIME_H
+#define INCLUDE_POWER_HOST_LINUX_TIME_H
+
+#include <time.h>
+#include <sys/time.h>
+#endif
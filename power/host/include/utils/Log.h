@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Host stand-in for liblog, messages at or above host_log_priority go
+ * to stderr. LOG_TAG is expanded where a message is logged.
+ */
+#ifndef INCLUDE_POWER_HOST_UTILS_LOG_H
+#define INCLUDE_POWER_HOST_UTILS_LOG_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <cutils/compiler.h>
+
+enum {
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_SILENT = 8,
+};
+
+extern int host_log_priority;
+
+void host_log_print(int prio, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define HOST_LOG(prio, ...) \
+    ((void)(CC_UNLIKELY((prio) >= host_log_priority) ? host_log_print(prio, LOG_TAG, __VA_ARGS__), 0 : 0))
+
+#define ALOGV(...)                        HOST_LOG(ANDROID_LOG_VERBOSE, __VA_ARGS__)
+#define ALOGD(...)                        HOST_LOG(ANDROID_LOG_DEBUG, __VA_ARGS__)
+#define ALOGI(...)                        HOST_LOG(ANDROID_LOG_INFO, __VA_ARGS__)
+#define ALOGW(...)                        HOST_LOG(ANDROID_LOG_WARN, __VA_ARGS__)
+#define ALOGE(...)                        HOST_LOG(ANDROID_LOG_ERROR, __VA_ARGS__)
+#define ALOGD_IF(cond, ...)               ((void)((cond) ? (ALOGD(__VA_ARGS__), 0) : 0))
+#define ALOGW_IF(cond, ...)               ((void)((cond) ? (ALOGW(__VA_ARGS__), 0) : 0))
+#define ALOGE_IF(cond, ...)               ((void)((cond) ? (ALOGE(__VA_ARGS__), 0) : 0))
+#endif
@@ -0,0 +1,770 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * powerhint_bench - benchmark the hint engine on a host
+ *
+ *   powerhint_bench [-n iterations] [-o result.json] config_dir...
+ *
+ * Every config_dir (e.g. config_files/sharkl3) is loaded against a fake
+ * node tree and the cost of boost()/deboost per scene, update_mode(),
+ * timer expiry, an hour of timed boosts and sort_request_for_file() at
+ * every request depth is measured, and the cost of posting a hint to the
+ * shared memory hint ring against calling powerHint() directly, and the
+ * round trip of scene batches through the hint socket server, and scene
+ * switches hinted one by one against power_hint_batch(), and the time
+ * from a touch written to a fake touchscreen to interaction_touch being
+ * entered with the cost of the framework hint dropped after it. Request
+ * timing runs on the virtual clock. The result is a JSON document,
+ * latencies in nanoseconds.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sched.h>
+#include <linux/input.h>
+
+#include "../clock.h"
+#include "../common.h"
+#include "../config.h"
+#include "../hint_ring.h"
+#include "../hint_id.h"
+#include "../hint_server.h"
+#include "../input_boost.h"
+#include "../lockstat.h"
+#include "../sprd_power.h"
+#include "../stats.h"
+#include "../vfs.h"
+#include "fakefs.h"
+
+#define BENCH_ITERATIONS_DEFAULT          1000
+#define BENCH_TIMER_DURATION_MS           1000
+#define BENCH_SORT_VALUE_BASE             100
+#define BENCH_TRAFFIC_MS                  3600000LL
+#define BENCH_TRAFFIC_STEP_MS             250
+#define BENCH_RING_BURST                  64
+#define BENCH_RING_PRODUCERS              4
+#define BENCH_BATCH_SCENES                8
+#define BENCH_BATCH_NODES_MAX             256
+
+extern struct sprd_power_module power_impl;
+
+/**
+ * struct bench_result - latencies of one measured operation
+ * @hist: the latency histogram, holding nanoseconds here
+ * @total_ns: wall time of all iterations
+ * @writes: node writes issued by all iterations
+ */
+struct bench_result {
+    struct hist hist;
+    int64_t total_ns;
+    uint64_t writes;
+};
+
+static int iterations = BENCH_ITERATIONS_DEFAULT;
+
+static uint64_t vfs_writes(void)
+{
+    struct vfs_stats stats;
+
+    vfs_get_stats(&stats);
+    return stats.writes;
+}
+
+// Account one operation started at @start, when @writes writes were issued
+static void bench_add(struct bench_result *result, int64_t start, uint64_t writes)
+{
+    int64_t ns = stats_now_ns() - start;
+
+    hist_add(&result->hist, ns);
+    result->total_ns += ns;
+    result->writes += vfs_writes() - writes;
+}
+
+static void print_result(FILE *out, const char *name, const struct bench_result *result)
+{
+    const struct hist *hist = &result->hist;
+
+    fprintf(out, "\"%s\": {\"count\": %llu, \"mean_ns\": %llu, \"p50_ns\": %llu, \"p90_ns\": %llu"
+        ", \"p99_ns\": %llu, \"max_ns\": %llu, \"ops_per_sec\": %.0f, \"writes_per_op\": %.2f}"
+        , name, (unsigned long long)hist->count
+        , (unsigned long long)((hist->count > 0)? hist->sum_us/hist->count: 0)
+        , (unsigned long long)hist_percentile(hist, 50)
+        , (unsigned long long)hist_percentile(hist, 90)
+        , (unsigned long long)hist_percentile(hist, 99)
+        , (unsigned long long)hist->max_us
+        , (result->total_ns > 0)? hist->count*1e9/result->total_ns: 0.0
+        , (hist->count > 0)? (double)result->writes/hist->count: 0.0);
+}
+
+static void bench_scenes(FILE *out)
+{
+    struct bench_result enable;
+    struct bench_result disable;
+    struct scene *scene = NULL;
+    int scene_id = 0;
+    int subtype = 0;
+    uint64_t writes = 0;
+    int64_t start = 0;
+    bool first = true;
+
+    fprintf(out, "      \"boost\": [");
+    for (int m = 0; m < power.count; m++) {
+        current_mode = &(power.modes[m]);
+        for (int s = 0; s < current_mode->count; s++) {
+            scene = &(current_mode->scenes[s]);
+            if (scene_name_to_id_subtype(scene->name, &scene_id, &subtype) == 0)
+                continue;
+
+            memset(&enable, 0, sizeof(enable));
+            memset(&disable, 0, sizeof(disable));
+            for (int i = 0; i < iterations; i++) {
+                writes = vfs_writes();
+                start = stats_now_ns();
+                boost(scene_id, subtype, 1, 0);
+                bench_add(&enable, start, writes);
+
+                writes = vfs_writes();
+                start = stats_now_ns();
+                boost(scene_id, subtype, 0, 0);
+                bench_add(&disable, start, writes);
+            }
+
+            fprintf(out, "%s\n        {\"mode\": \"%s\", \"scene\": \"%s\", \"sets\": %d, "
+                , first? "": ",", current_mode->name, scene->name, scene->count);
+            print_result(out, "enable", &enable);
+            fprintf(out, ", ");
+            print_result(out, "disable", &disable);
+            fprintf(out, "}");
+            first = false;
+        }
+    }
+    current_mode = default_mode;
+    fprintf(out, "\n      ],\n");
+}
+
+static void bench_modes(FILE *out)
+{
+    struct bench_result idle;
+    struct bench_result loaded;
+    struct scene *scene = NULL;
+    int scene_id = 0;
+    int subtype = 0;
+    uint64_t writes = 0;
+    int64_t start = 0;
+    bool first = true;
+
+    fprintf(out, "      \"update_mode\": [");
+    for (int m = 0; m < power.count; m++) {
+        int mode_id = 0;
+
+        if (scene_name_to_id_subtype(power.modes[m].name, &mode_id, &subtype) == 0)
+            continue;
+
+        memset(&idle, 0, sizeof(idle));
+        for (int i = 0; i < iterations; i++) {
+            writes = vfs_writes();
+            start = stats_now_ns();
+            update_mode(mode_id, 1);
+            update_mode(mode_id, 0);
+            bench_add(&idle, start, writes);
+        }
+
+        // Switch with every scene of the default mode holding a request
+        memset(&loaded, 0, sizeof(loaded));
+        for (int i = 0; i < iterations; i++) {
+            for (int s = 0; s < default_mode->count; s++) {
+                scene = &(default_mode->scenes[s]);
+                if (scene_name_to_id_subtype(scene->name, &scene_id, &subtype) != 0)
+                    boost(scene_id, subtype, 1, 0);
+            }
+            writes = vfs_writes();
+            start = stats_now_ns();
+            update_mode(mode_id, 1);
+            update_mode(mode_id, 0);
+            bench_add(&loaded, start, writes);
+        }
+
+        fprintf(out, "%s\n        {\"mode\": \"%s\", ", first? "": ",", power.modes[m].name);
+        print_result(out, "idle", &idle);
+        fprintf(out, ", ");
+        print_result(out, "loaded", &loaded);
+        fprintf(out, "}");
+        first = false;
+    }
+    fprintf(out, "\n      ],\n");
+}
+
+// The requests of every scene expire on the virtual clock, one scene per op
+static void bench_timer_expiry(FILE *out)
+{
+    struct bench_result expiry;
+    struct scene *scene = NULL;
+    int scene_id = 0;
+    int subtype = 0;
+    uint64_t writes = 0;
+    int64_t start = 0;
+
+    memset(&expiry, 0, sizeof(expiry));
+    for (int i = 0; i < iterations; i++) {
+        for (int s = 0; s < default_mode->count; s++) {
+            scene = &(default_mode->scenes[s]);
+            if (scene_name_to_id_subtype(scene->name, &scene_id, &subtype) == 0)
+                continue;
+
+            boost(scene_id, subtype, 1, BENCH_TIMER_DURATION_MS);
+            writes = vfs_writes();
+            start = stats_now_ns();
+            clock_advance(BENCH_TIMER_DURATION_MS * 1000000LL);
+            bench_add(&expiry, start, writes);
+        }
+        clear_requests_for_all_file();
+    }
+
+    fprintf(out, "      ");
+    print_result(out, "timer_expiry", &expiry);
+    fprintf(out, ",\n");
+}
+
+// An hour of timed boosts of random scenes, one every BENCH_TRAFFIC_STEP_MS
+static void bench_traffic(FILE *out)
+{
+    struct scene *scene = NULL;
+    unsigned int seed = 1;
+    uint64_t writes = vfs_writes();
+    uint64_t boosts = 0;
+    int64_t start = stats_now_ns();
+    int scene_id = 0;
+    int subtype = 0;
+
+    for (int64_t t = 0; t < BENCH_TRAFFIC_MS; t += BENCH_TRAFFIC_STEP_MS) {
+        scene = &(default_mode->scenes[rand_r(&seed) % default_mode->count]);
+        if (scene_name_to_id_subtype(scene->name, &scene_id, &subtype) != 0) {
+            boost(scene_id, subtype, 1, BOOST_DURATION_DEFAULT + rand_r(&seed) % BOOST_DURATION_MAX);
+            boosts++;
+        }
+        clock_advance(BENCH_TRAFFIC_STEP_MS * 1000000LL);
+    }
+    clock_advance(BOOST_DURATION_MAX * 2 * 1000000LL);
+
+    fprintf(out, "      \"traffic\": {\"virtual_ms\": %lld, \"wall_ns\": %lld, \"boosts\": %llu"
+        ", \"writes\": %llu},\n", (long long)BENCH_TRAFFIC_MS, (long long)(stats_now_ns() - start)
+        , (unsigned long long)boosts, (unsigned long long)(vfs_writes() - writes));
+}
+
+/**
+ * struct ring_producer - one thread posting to the hint ring
+ * @client: the mapping of the ring
+ * @post: the latency of every post
+ * @full: posts retried because the ring was full
+ * @hold_hal: hold the HAL lock during every burst, the HAL is busy then and
+ *            its worker can't preempt the producer on a single cpu
+ */
+struct ring_producer {
+    struct hint_ring_client client;
+    struct bench_result *post;
+    uint64_t full;
+    bool hold_hal;
+};
+
+static void wait_ring_drained(const struct hint_ring_client *client)
+{
+    while (hint_ring_pending(client) > 0)
+        sched_yield();
+}
+
+// Post iterations hints in bursts, waiting for the HAL to drain each burst
+static void *ring_produce(void *args)
+{
+    struct ring_producer *producer = (struct ring_producer *)args;
+    int data = BOOST_DURATION_DEFAULT;
+    int64_t start = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        if (producer->hold_hal && i % BENCH_RING_BURST == 0)
+            power_lock(__func__);
+
+        start = stats_now_ns();
+        while (hint_ring_post(&(producer->client), POWER_HINT_INTERACTION, &data) != 0) {
+            producer->full++;
+            sched_yield();
+            start = stats_now_ns();
+        }
+        bench_add(producer->post, start, vfs_writes());
+
+        if ((i + 1) % BENCH_RING_BURST == 0 || i == iterations - 1) {
+            if (producer->hold_hal)
+                power_unlock();
+            wait_ring_drained(&(producer->client));
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_hint_ring(FILE *out)
+{
+    struct bench_result direct;
+    struct bench_result post;
+    struct bench_result contended;
+    struct ring_producer producers[BENCH_RING_PRODUCERS];
+    pthread_t threads[BENCH_RING_PRODUCERS];
+    int data = BOOST_DURATION_DEFAULT;
+    int shm_fd = -1;
+    int event_fd = -1;
+    int64_t start = 0;
+    int64_t drain_ns = 0;
+    uint64_t full = 0;
+
+    power_impl.init_done = true;
+    memset(&direct, 0, sizeof(direct));
+    for (int i = 0; i < iterations; i++) {
+        start = stats_now_ns();
+        power_impl.powerHint(&power_impl, POWER_HINT_INTERACTION, &data);
+        bench_add(&direct, start, vfs_writes());
+    }
+
+    if (hint_ring_start(&power_impl) != 0 || hint_ring_get_fds(&shm_fd, &event_fd) != 0) {
+        power_impl.init_done = false;
+        return;
+    }
+
+    memset(&post, 0, sizeof(post));
+    memset(&contended, 0, sizeof(contended));
+    memset(producers, 0, sizeof(producers));
+    for (int i = 0; i < BENCH_RING_PRODUCERS; i++) {
+        hint_ring_attach(&(producers[i].client), shm_fd, event_fd);
+        producers[i].post = (i == 0)? &post: &contended;
+    }
+
+    // One producer posting while the HAL is busy, the cost a client pays
+    producers[0].hold_hal = true;
+    ring_produce(&producers[0]);
+
+    // Then the time the HAL takes to apply a posted burst
+    start = stats_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        hint_ring_post(&(producers[0].client), POWER_HINT_INTERACTION, &data);
+        if ((i + 1) % BENCH_RING_BURST == 0)
+            wait_ring_drained(&(producers[0].client));
+    }
+    wait_ring_drained(&(producers[0].client));
+    drain_ns = stats_now_ns() - start;
+
+    // Then all producers at once, racing with the HAL draining
+    producers[0].hold_hal = false;
+    producers[0].post = &contended;
+    for (int i = 0; i < BENCH_RING_PRODUCERS; i++)
+        pthread_create(&threads[i], NULL, ring_produce, &producers[i]);
+    for (int i = 0; i < BENCH_RING_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+        full += producers[i].full;
+        hint_ring_detach(&(producers[i].client));
+    }
+
+    hint_ring_stop();
+    power_impl.init_done = false;
+
+    fprintf(out, "      \"hint_ring\": {");
+    print_result(out, "direct", &direct);
+    fprintf(out, ", ");
+    print_result(out, "post", &post);
+    fprintf(out, ", ");
+    print_result(out, "post_contended", &contended);
+    fprintf(out, ", \"producers\": %d, \"full\": %llu, \"drain_ns_per_hint\": %lld},\n"
+        , BENCH_RING_PRODUCERS, (unsigned long long)full, (long long)(drain_ns / iterations));
+}
+
+// Batches of 1, 8 and 64 scenes through the socket server, entering and exiting a scene
+static void bench_hint_server(FILE *out)
+{
+    static const int sizes[] = { 1, 8, NUM_HINT_MSG_BOOST_MAX };
+    struct hint_msg_boost boosts[NUM_HINT_MSG_BOOST_MAX];
+    struct bench_result batch;
+    struct hint_ring_client client;
+    struct scene *scene = NULL;
+    int scene_id = 0;
+    int subtype = 0;
+    int shm_fd = -1;
+    int event_fd = -1;
+    int ring = 0;
+    int fd = -1;
+    uint64_t writes = 0;
+    int64_t start = 0;
+    char name[16] = {'\0'};
+
+    for (int s = 0; s < default_mode->count && scene == NULL; s++) {
+        if (scene_name_to_id_subtype(default_mode->scenes[s].name, &scene_id, &subtype) != 0)
+            scene = &(default_mode->scenes[s]);
+    }
+    if (scene == NULL)
+        return;
+
+    power_impl.init_done = true;
+    hint_ring_start(&power_impl);
+    if (hint_server_start(&power_impl) != 0 || (fd = hint_client_connect(NULL)) < 0) {
+        hint_server_stop();
+        hint_ring_stop();
+        power_impl.init_done = false;
+        return;
+    }
+
+    // The ring descriptors are handed out over the socket
+    if (hint_client_get_ring(fd, &shm_fd, &event_fd) == 0
+        && hint_ring_attach(&client, shm_fd, event_fd) == 0) {
+        ring = 1;
+        hint_ring_detach(&client);
+        close(shm_fd);
+        close(event_fd);
+    }
+
+    fprintf(out, "      \"hint_server\": {\"scene\": \"%s\", \"ring_fds\": %d", scene->name, ring);
+    for (size_t n = 0; n < sizeof(sizes)/sizeof(sizes[0]); n++) {
+        memset(&batch, 0, sizeof(batch));
+        for (int i = 0; i < iterations; i++) {
+            for (int j = 0; j < sizes[n]; j++)
+                boosts[j] = (struct hint_msg_boost){ scene_id, subtype, (i + j + 1) % 2, 0 };
+
+            writes = vfs_writes();
+            start = stats_now_ns();
+            hint_client_boost(fd, boosts, sizes[n]);
+            bench_add(&batch, start, writes);
+        }
+        snprintf(name, sizeof(name), "batch_%d", sizes[n]);
+        fprintf(out, ", ");
+        print_result(out, name, &batch);
+    }
+    fprintf(out, "},\n");
+
+    close(fd);
+    hint_server_stop();
+    hint_ring_stop();
+    clear_requests_for_all_file();
+    power_impl.init_done = false;
+}
+
+// Touches on a pipe watched as a touchscreen, each followed by the framework hint
+static void bench_input_boost(FILE *out)
+{
+    const struct input_boost_stats *stats = input_boost_stats_get(INPUT_DEVICE_TOUCH);
+    struct input_event touch[3];
+    struct bench_result input;
+    struct bench_result hint;
+    bool supported = false;
+    int data = BOOST_DURATION_DEFAULT;
+    int fds[2] = { -1, -1 };
+    uint64_t boosts = 0;
+    uint64_t deduped = 0;
+    uint64_t writes = 0;
+    int64_t start = 0;
+
+    for (int s = 0; s < default_mode->count; s++) {
+        if (strcmp(default_mode->scenes[s].name, "interaction_touch") == 0)
+            supported = true;
+    }
+    if (!supported || pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0)
+        return;
+
+    power_impl.init_done = true;
+    if (input_boost_add_fd(fds[0], INPUT_DEVICE_TOUCH) != 0 || input_boost_start(&power_impl) != 0) {
+        close(fds[0]);
+        close(fds[1]);
+        power_impl.init_done = false;
+        return;
+    }
+
+    memset(touch, 0, sizeof(touch));
+    touch[0].type = EV_ABS;
+    touch[0].code = ABS_MT_TRACKING_ID;
+    touch[1].type = EV_KEY;
+    touch[1].code = BTN_TOUCH;
+    touch[1].value = 1;
+    touch[2].type = EV_SYN;
+    touch[2].code = SYN_REPORT;
+
+    memset(&input, 0, sizeof(input));
+    memset(&hint, 0, sizeof(hint));
+    deduped = __atomic_load_n(&stats->deduped, __ATOMIC_RELAXED);
+    for (int i = 0; i < iterations; i++) {
+        boosts = __atomic_load_n(&stats->boosts, __ATOMIC_ACQUIRE);
+        writes = vfs_writes();
+        start = stats_now_ns();
+        if (write(fds[1], touch, sizeof(touch)) != sizeof(touch))
+            break;
+        while (__atomic_load_n(&stats->boosts, __ATOMIC_ACQUIRE) == boosts)
+            sched_yield();
+        bench_add(&input, start, writes);
+
+        writes = vfs_writes();
+        start = stats_now_ns();
+        power_impl.powerHint(&power_impl, (power_hint_t)POWER_HINT_VENDOR_INTERACTION_TOUCH, &data);
+        bench_add(&hint, start, writes);
+
+        // Let the boost run out, the next touch starts a new gesture
+        clock_advance((int64_t)BOOST_DURATION_DEFAULT * 1000000);
+    }
+    deduped = __atomic_load_n(&stats->deduped, __ATOMIC_RELAXED) - deduped;
+
+    input_boost_stop();
+    close(fds[1]);
+    clear_requests_for_all_file();
+    power_impl.init_done = false;
+
+    fprintf(out, "      \"input_boost\": {");
+    print_result(out, "touch_to_boost", &input);
+    fprintf(out, ", ");
+    print_result(out, "framework_hint", &hint);
+    fprintf(out, ", \"deduped\": %llu},\n", (unsigned long long)deduped);
+}
+
+// Read every resource node into @state, returns the node count
+static int read_node_state(char state[][LEN_VALUE_MAX])
+{
+    char buf[LEN_PATH_MAX + LEN_FILE_MAX + 2] = {'\0'};
+    int count = 0;
+
+    for (int i = 0; i < resources.count; i++) {
+        for (int j = 0; j < resources.path_files[i].count && count < BENCH_BATCH_NODES_MAX; j++) {
+            snprintf(buf, sizeof(buf), "%s/%s", resources.path_files[i].path
+                , resources.path_files[i].files[j].name);
+            state[count][0] = '\0';
+            fakefs_read(buf, state[count], LEN_VALUE_MAX);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Switch from one vendor scene of the default mode to the next, an exit
+ * and an enter, hinted one by one and then as one power_hint_batch(). Both
+ * runs must leave the nodes in the same state.
+ */
+static void bench_hint_batch(FILE *out)
+{
+    static char state[2][BENCH_BATCH_NODES_MAX][LEN_VALUE_MAX];
+    struct power_hint_op ops[2];
+    struct bench_result single;
+    struct bench_result batch;
+    int scene_ids[BENCH_BATCH_SCENES];
+    int scene_id = 0;
+    int subtype = 0;
+    int count = 0;
+    int nodes = 0;
+    int data = 0;
+    uint64_t writes = 0;
+    int64_t start = 0;
+
+    // powerHint() passes the vendor scene ids straight to boost()
+    for (int s = 0; s < default_mode->count && count < BENCH_BATCH_SCENES; s++) {
+        if (scene_name_to_id_subtype(default_mode->scenes[s].name, &scene_id, &subtype) != 0
+            && subtype == 0 && scene_id >= POWER_HINT_VENDOR_BENCHMARK
+            && scene_id <= POWER_HINT_VENDOR_CAMERA_LOW_POWER_1)
+            scene_ids[count++] = scene_id;
+    }
+    if (count < 2)
+        return;
+
+    power_impl.init_done = true;
+    memset(&single, 0, sizeof(single));
+    for (int i = 0; i < iterations; i++) {
+        writes = vfs_writes();
+        start = stats_now_ns();
+        if (i > 0)
+            power_impl.powerHint(&power_impl, scene_ids[(i - 1) % count], NULL);
+        power_impl.powerHint(&power_impl, scene_ids[i % count], &data);
+        bench_add(&single, start, writes);
+    }
+    nodes = read_node_state(state[0]);
+    clear_requests_for_all_file();
+
+    memset(&batch, 0, sizeof(batch));
+    for (int i = 0; i < iterations; i++) {
+        ops[0] = (struct power_hint_op){ scene_ids[(i + count - 1) % count], 0, 0 };
+        ops[1] = (struct power_hint_op){ scene_ids[i % count], 1, data };
+        writes = vfs_writes();
+        start = stats_now_ns();
+        power_hint_batch(&power_impl, (i > 0)? ops: ops + 1, (i > 0)? 2: 1);
+        bench_add(&batch, start, writes);
+    }
+    read_node_state(state[1]);
+    clear_requests_for_all_file();
+    power_impl.init_done = false;
+
+    fprintf(out, "      \"hint_batch\": {\"scenes\": %d, ", count);
+    print_result(out, "single", &single);
+    fprintf(out, ", ");
+    print_result(out, "batch", &batch);
+    fprintf(out, ", \"same_state\": %s},\n"
+        , (memcmp(state[0], state[1], sizeof(state[0][0]) * nodes) == 0)? "true": "false");
+}
+
+// The first node compared in ascending decimal order, NULL if none
+static struct file *find_sortable_file(const char **path)
+{
+    struct file *file = NULL;
+
+    for (int i = 0; i < resources.count; i++) {
+        for (int j = 0; j < resources.path_files[i].count; j++) {
+            file = &(resources.path_files[i].files[j]);
+            if (file->comp == common_comp_ascend_order) {
+                *path = resources.path_files[i].path;
+                return file;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_sort(FILE *out)
+{
+    struct bench_result insert;
+    struct file *file = NULL;
+    const char *path = NULL;
+    uint64_t writes = 0;
+    int64_t start = 0;
+
+    fprintf(out, "      \"sort_request\": [");
+    file = find_sortable_file(&path);
+    if (file == NULL) {
+        fprintf(out, "],\n");
+        return;
+    }
+
+    for (int depth = 0; depth < NUM_REQUST_FOR_FILE_MAX; depth++) {
+        memset(&insert, 0, sizeof(insert));
+        for (int i = 0; i < iterations; i++) {
+            memset(&(file->stat), 0, sizeof(file->stat));
+            for (int d = 0; d < depth; d++) {
+                snprintf(file->value.target_value, LEN_VALUE_MAX, "%d", BENCH_SORT_VALUE_BASE + d);
+                sort_request_for_file(1, 0, file);
+            }
+
+            // Insert below all other values and remove it, the worst case
+            snprintf(file->value.target_value, LEN_VALUE_MAX, "%d", BENCH_SORT_VALUE_BASE - 1);
+            writes = vfs_writes();
+            start = stats_now_ns();
+            sort_request_for_file(1, 0, file);
+            sort_request_for_file(0, 0, file);
+            bench_add(&insert, start, writes);
+        }
+        fprintf(out, "%s\n        {\"file\": \"%s/%s\", \"depth\": %d, "
+            , (depth == 0)? "": ",", path, file->name, depth);
+        print_result(out, "insert_remove", &insert);
+        fprintf(out, "}");
+    }
+    memset(&(file->stat), 0, sizeof(file->stat));
+    memset(file->value.target_value, 0, LEN_VALUE_MAX);
+    fprintf(out, "\n      ]\n");
+}
+
+static int bench_config(FILE *out, const char *config_dir, bool first)
+{
+    char root[LEN_VFS_PATH_MAX] = {'\0'};
+    char name[LEN_VFS_PATH_MAX] = {'\0'};
+
+    if (fakefs_create(config_dir, root, sizeof(root)) != 0) {
+        fprintf(stderr, "Create fake node tree for %s fail\n", config_dir);
+        return -1;
+    }
+
+    clock_use_virtual(0);
+    if (config_read() == 0) {
+        fprintf(stderr, "Read config %s fail\n", config_dir);
+        fakefs_destroy(root);
+        return -1;
+    }
+
+    // Timers run on the virtual clock, expiries happen in clock_advance()
+    start_thread_for_timing_request(&power_impl);
+
+    snprintf(name, sizeof(name), "%s", config_dir);
+    fprintf(out, "%s\n    {\n      \"config\": \"%s\",\n", first? "": ",", basename(name));
+    bench_scenes(out);
+    bench_modes(out);
+    bench_timer_expiry(out);
+    bench_traffic(out);
+    bench_hint_ring(out);
+    bench_hint_server(out);
+    bench_input_boost(out);
+    bench_hint_batch(out);
+    bench_sort(out);
+    fprintf(out, "    }");
+
+    clear_requests_for_all_file();
+    fakefs_destroy(root);
+
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-n iterations] [-o result.json] config_dir...\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *out = stdout;
+    int ret = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "n:o:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'o':
+            out = fopen(optarg, "w");
+            if (out == NULL) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc || iterations <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"iterations\": %d,\n  \"results\": [", iterations);
+    for (int i = optind; i < argc; i++) {
+        if (bench_config(out, argv[i], i == optind) != 0)
+            ret = 1;
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+
+    return ret;
+}
@@ -0,0 +1,513 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * powerhint_energy - estimate the energy cost of scene configs over a trace
+ *
+ *   powerhint_energy [-p key=value]... [-o result.json] opp_table trace config_dir...
+ *
+ * The trace is replayed on the virtual clock against every config_dir,
+ * so two configs of a product can be compared on the same traffic. -p
+ * sets a property before the HAL is initialized, e.g. to compare a
+ * policy the property enables against the default one. The
+ * frequency of every domain (a cluster, the ddr) follows the nodes the
+ * opp table maps to it: the highest floor in force, at least the base
+ * frequency, at most the lowest cap, rounded up to the next operating
+ * point. The estimate is the power of that operating point over time,
+ * a lower bound of what a boost costs since load is not modelled.
+ *
+ * The opp table is a text file, one entry per line, '#' starts a comment:
+ *
+ *   min  <domain> <node> [hex]      the node holds a frequency floor
+ *   max  <domain> <node> [hex]      the node holds a frequency cap
+ *   opp  <domain> <freq> <power_mw> an operating point, in any order
+ *   base <domain> <freq>            the frequency without a floor, default
+ *                                   the lowest operating point
+ *
+ * e.g. for sharkl3:
+ *
+ *   min  little /dev/cluster0_freq_min hex
+ *   max  little /dev/cluster0_freq_max hex
+ *   opp  little 768000 38
+ *   opp  little 1200000 96
+ *   min  ddr /sys/class/devfreq/scene-frequency/sprd_governor/scene_boost_dfs
+ *   opp  ddr 256 110
+ *   opp  ddr 933 310
+ *
+ * A node value of "<enable> <freq>" like the ddr governor takes is a
+ * request only while enabled, a node released by closing its fd holds
+ * none. The result is a JSON document per config with the energy, the
+ * boosted time and the operating point residency of every domain and
+ * the node writes of the replay.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+
+#include "../boost_adapt.h"
+#include "../clock.h"
+#include "../common.h"
+#include "../config.h"
+#include "../hint_trace.h"
+#include "../sprd_power.h"
+#include "../vfs.h"
+#include "fakefs.h"
+
+#define NUM_ENERGY_DOMAIN_MAX             8
+#define NUM_ENERGY_OPP_MAX                32
+#define NUM_ENERGY_NODE_MAX               32
+#define LEN_ENERGY_NAME_MAX               16
+
+extern struct sprd_power_module power_impl;
+
+enum {
+    ENERGY_NODE_MIN = 0,
+    ENERGY_NODE_MAX,
+};
+
+/**
+ * struct energy_node - a node that limits the frequency of a domain
+ * @path: the node
+ * @kind: ENERGY_NODE_*
+ * @base: the number base of the node value, 16 or 10
+ * @file: the resource file of the node in the config being estimated
+ */
+struct energy_node {
+    char path[LEN_VFS_PATH_MAX];
+    int kind;
+    int base;
+    struct file *file;
+};
+
+/**
+ * struct energy_opp - an operating point and the time spent at it
+ * @freq: the frequency, in the unit of the node values
+ * @power_mw: the power at @freq
+ * @time_ns: time at the operating point in the current estimate
+ */
+struct energy_opp {
+    long long freq;
+    double power_mw;
+    uint64_t time_ns;
+};
+
+/**
+ * struct energy_domain - a frequency domain
+ * @name: the domain name
+ * @base_freq: the frequency without a floor, 0 for the lowest opp
+ * @opps: operating points in ascending frequency
+ * @opp_count: the number of element in opps array
+ * @nodes: the nodes of the domain
+ * @node_count: the number of element in nodes array
+ * @current: index of the operating point in force
+ * @boosted: whether a floor above the base frequency is in force
+ * @boosted_ns: time with a floor above the base frequency
+ * @energy_uj: the estimated energy
+ */
+struct energy_domain {
+    char name[LEN_ENERGY_NAME_MAX];
+    long long base_freq;
+    struct energy_opp opps[NUM_ENERGY_OPP_MAX];
+    int opp_count;
+    struct energy_node nodes[NUM_ENERGY_NODE_MAX];
+    int node_count;
+    int current;
+    bool boosted;
+    uint64_t boosted_ns;
+    double energy_uj;
+};
+
+static struct energy_domain domains[NUM_ENERGY_DOMAIN_MAX];
+static int domain_count = 0;
+
+static struct energy_domain *find_domain(const char *name)
+{
+    for (int i = 0; i < domain_count; i++) {
+        if (strcmp(domains[i].name, name) == 0)
+            return &domains[i];
+    }
+
+    if (domain_count >= NUM_ENERGY_DOMAIN_MAX)
+        return NULL;
+
+    snprintf(domains[domain_count].name, LEN_ENERGY_NAME_MAX, "%s", name);
+    return &domains[domain_count++];
+}
+
+static int compare_opp(const void *a, const void *b)
+{
+    const struct energy_opp *x = a;
+    const struct energy_opp *y = b;
+
+    return (x->freq > y->freq) - (x->freq < y->freq);
+}
+
+// Parse the opp table, returns 0 on success
+static int read_opp_table(const char *path)
+{
+    struct energy_domain *domain = NULL;
+    char line[LEN_VFS_PATH_MAX * 2] = {'\0'};
+    char kind[LEN_ENERGY_NAME_MAX] = {'\0'};
+    char name[LEN_ENERGY_NAME_MAX] = {'\0'};
+    char arg[LEN_VFS_PATH_MAX] = {'\0'};
+    char extra[LEN_VFS_PATH_MAX] = {'\0'};
+    FILE *fp = NULL;
+    int line_no = 0;
+    int n = 0;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_no++;
+        if (strchr(line, '#') != NULL)
+            *strchr(line, '#') = '\0';
+
+        extra[0] = '\0';
+        n = sscanf(line, "%15s %15s %255s %255s", kind, name, arg, extra);
+        if (n <= 0)
+            continue;
+
+        domain = (n >= 3)? find_domain(name): NULL;
+        if (domain == NULL)
+            goto bad_line;
+
+        if ((strcmp(kind, "min") == 0 || strcmp(kind, "max") == 0)
+            && domain->node_count < NUM_ENERGY_NODE_MAX) {
+            struct energy_node *node = &(domain->nodes[domain->node_count++]);
+
+            snprintf(node->path, LEN_VFS_PATH_MAX, "%s", arg);
+            node->kind = (kind[1] == 'i')? ENERGY_NODE_MIN: ENERGY_NODE_MAX;
+            node->base = (strcmp(extra, "hex") == 0)? 16: 10;
+        } else if (strcmp(kind, "opp") == 0 && n == 4 && domain->opp_count < NUM_ENERGY_OPP_MAX) {
+            domain->opps[domain->opp_count].freq = atoll(arg);
+            domain->opps[domain->opp_count].power_mw = atof(extra);
+            domain->opp_count++;
+        } else if (strcmp(kind, "base") == 0) {
+            domain->base_freq = atoll(arg);
+        } else {
+            goto bad_line;
+        }
+    }
+    fclose(fp);
+
+    for (int i = 0; i < domain_count; i++) {
+        if (domains[i].opp_count == 0) {
+            fprintf(stderr, "%s: domain %s has no opp\n", path, domains[i].name);
+            return -1;
+        }
+        qsort(domains[i].opps, domains[i].opp_count, sizeof(struct energy_opp), compare_opp);
+    }
+
+    return (domain_count > 0)? 0: -1;
+
+bad_line:
+    fprintf(stderr, "%s:%d: bad entry\n", path, line_no);
+    fclose(fp);
+    return -1;
+}
+
+// The resource file of @path in the config loaded, NULL if it is not one
+static struct file *find_file_by_path(const char *path)
+{
+    struct path_file *path_file = NULL;
+    int len = 0;
+
+    for (int i = 0; i < resources.count; i++) {
+        path_file = &(resources.path_files[i]);
+        len = strlen(path_file->path);
+        if (strncmp(path, path_file->path, len) != 0 || path[len] != '/')
+            continue;
+
+        for (int j = 0; j < path_file->count; j++) {
+            if (strcmp(path + len + 1, path_file->files[j].name) == 0)
+                return &(path_file->files[j]);
+        }
+    }
+
+    return NULL;
+}
+
+// The frequency a node requests now, 0 if none
+static long long read_request(const struct energy_node *node)
+{
+    char value[LEN_VALUE_MAX] = {'\0'};
+    char *end = NULL;
+    long long freq = 0;
+
+    if (node->file != NULL && node->file->set == common_set_for_release_when_close
+        && node->file->fd <= 0)
+        return 0;
+
+    if (fakefs_read(node->path, value, sizeof(value)) < 0)
+        return 0;
+
+    freq = strtoll(value, &end, node->base);
+    // "<enable> <freq>"
+    if (*end == ' ')
+        freq = (freq != 0)? strtoll(end, NULL, node->base): 0;
+
+    return freq;
+}
+
+// Resolve the operating point every domain runs at from its nodes
+static void sample_domains(void)
+{
+    struct energy_domain *domain = NULL;
+    long long floor = 0;
+    long long cap = 0;
+    long long freq = 0;
+    long long request = 0;
+
+    for (int i = 0; i < domain_count; i++) {
+        domain = &domains[i];
+        floor = 0;
+        cap = 0;
+        for (int j = 0; j < domain->node_count; j++) {
+            request = read_request(&(domain->nodes[j]));
+            if (request <= 0)
+                continue;
+            if (domain->nodes[j].kind == ENERGY_NODE_MIN && request > floor)
+                floor = request;
+            else if (domain->nodes[j].kind == ENERGY_NODE_MAX && (cap == 0 || request < cap))
+                cap = request;
+        }
+
+        freq = (domain->base_freq > 0)? domain->base_freq: domain->opps[0].freq;
+        domain->boosted = floor > freq;
+        if (floor > freq)
+            freq = floor;
+        if (cap > 0 && cap < freq)
+            freq = cap;
+
+        domain->current = domain->opp_count - 1;
+        for (int j = 0; j < domain->opp_count; j++) {
+            if (domain->opps[j].freq >= freq) {
+                domain->current = j;
+                break;
+            }
+        }
+    }
+}
+
+static void account(int64_t ns)
+{
+    struct energy_domain *domain = NULL;
+    struct energy_opp *opp = NULL;
+
+    if (ns <= 0)
+        return;
+
+    for (int i = 0; i < domain_count; i++) {
+        domain = &domains[i];
+        opp = &(domain->opps[domain->current]);
+        opp->time_ns += ns;
+        domain->energy_uj += opp->power_mw * ns / 1e6;
+        if (domain->boosted)
+            domain->boosted_ns += ns;
+    }
+}
+
+// Move the virtual clock to @target, accounting the state between every expiry
+static void run_until(int64_t target)
+{
+    int64_t now = clock_monotonic_ns();
+    int64_t next = 0;
+
+    while ((next = clock_next_expiry_ns()) > 0 && next <= target) {
+        account(next - now);
+        clock_advance(next - now);
+        sample_domains();
+        now = next;
+    }
+    account(target - now);
+    clock_advance(target - now);
+}
+
+static void replay_record(const struct hint_trace_record *record)
+{
+    int data = record->data;
+
+    switch (record->type) {
+    case HINT_TRACE_HINT:
+        power_impl.powerHint(&power_impl, record->hint
+            , (record->flags & HINT_TRACE_FLAG_DATA)? &data: NULL);
+        break;
+    case HINT_TRACE_INTERACTIVE:
+        power_impl.setInteractive(&power_impl, data);
+        break;
+    case HINT_TRACE_CTRL:
+        power_impl.ctrl_power_hint(&power_impl, data);
+        break;
+    default:
+        break;
+    }
+}
+
+static void print_domains(FILE *out, int64_t duration_ns)
+{
+    struct energy_domain *domain = NULL;
+
+    for (int i = 0; i < domain_count; i++) {
+        domain = &domains[i];
+        fprintf(out, "%s\n        {\"domain\": \"%s\", \"energy_mj\": %.3f, \"avg_power_mw\": %.3f"
+            ", \"boosted_ms\": %llu, \"residency_ms\": {", (i == 0)? "": ",", domain->name
+            , domain->energy_uj / 1000, (duration_ns > 0)? domain->energy_uj * 1e6 / duration_ns: 0.0
+            , (unsigned long long)(domain->boosted_ns / 1000000));
+        for (int j = 0; j < domain->opp_count; j++)
+            fprintf(out, "%s\"%lld\": %llu", (j == 0)? "": ", ", domain->opps[j].freq
+                , (unsigned long long)(domain->opps[j].time_ns / 1000000));
+        fprintf(out, "}}");
+    }
+}
+
+static int estimate_config(FILE *out, const char *config_dir, const struct hint_trace_record *records
+    , int count, bool first)
+{
+    char root[LEN_VFS_PATH_MAX] = {'\0'};
+    char name[LEN_VFS_PATH_MAX] = {'\0'};
+    struct vfs_stats stats;
+    double energy_uj = 0;
+    int64_t start = 0;
+    int64_t end = 0;
+
+    if (fakefs_create(config_dir, root, sizeof(root)) != 0) {
+        fprintf(stderr, "Create fake node tree for %s fail\n", config_dir);
+        return -1;
+    }
+
+    clock_use_virtual(0);
+    if (config_read() == 0) {
+        fprintf(stderr, "Read config %s fail\n", config_dir);
+        fakefs_destroy(root);
+        return -1;
+    }
+    power_boost_adapt_init();
+    start_thread_for_timing_request(&power_impl);
+    power_impl.init_done = true;
+
+    for (int i = 0; i < domain_count; i++) {
+        domains[i].boosted_ns = 0;
+        domains[i].energy_uj = 0;
+        for (int j = 0; j < domains[i].opp_count; j++)
+            domains[i].opps[j].time_ns = 0;
+        for (int j = 0; j < domains[i].node_count; j++)
+            domains[i].nodes[j].file = find_file_by_path(domains[i].nodes[j].path);
+    }
+
+    vfs_reset_stats();
+    start = clock_monotonic_ns();
+    sample_domains();
+    for (int i = 0; i < count; i++) {
+        run_until(start + records[i].ts_ns);
+        replay_record(&records[i]);
+        sample_domains();
+    }
+    end = clock_monotonic_ns();
+    vfs_get_stats(&stats);
+
+    for (int i = 0; i < domain_count; i++)
+        energy_uj += domains[i].energy_uj;
+
+    snprintf(name, sizeof(name), "%s", config_dir);
+    fprintf(out, "%s\n    {\"config\": \"%s\", \"energy_mj\": %.3f, \"writes\": %llu"
+        ", \"writes_per_min\": %.1f,\n      \"domains\": [", first? "": ",", basename(name)
+        , energy_uj / 1000, (unsigned long long)stats.writes
+        , (end > start)? stats.writes * 60e9 / (end - start): 0.0);
+    print_domains(out, end - start);
+    fprintf(out, "\n      ]}");
+
+    power_impl.init_done = false;
+    clear_requests_for_all_file();
+    fakefs_destroy(root);
+
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-p key=value]... [-o result.json] opp_table trace config_dir...\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    struct hint_trace_record *records = NULL;
+    FILE *out = stdout;
+    char *value = NULL;
+    int count = 0;
+    int ret = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "p:o:h")) != -1) {
+        switch (opt) {
+        case 'p':
+            value = strchr(optarg, '=');
+            if (value == NULL) {
+                usage(argv[0]);
+                return 1;
+            }
+            *value++ = '\0';
+            property_set(optarg, value);
+            break;
+        case 'o':
+            out = fopen(optarg, "w");
+            if (out == NULL) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc - optind < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (read_opp_table(argv[optind]) != 0)
+        return 1;
+
+    count = hint_trace_read(argv[optind + 1], &records);
+    if (count < 0) {
+        fprintf(stderr, "Read hint trace %s fail\n", argv[optind + 1]);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"trace\": \"%s\",\n  \"records\": %d,\n  \"duration_ms\": %lld,\n"
+        "  \"results\": [", argv[optind + 1], count
+        , (count > 0)? (long long)(records[count - 1].ts_ns / 1000000): 0LL);
+    for (int i = optind + 2; i < argc; i++) {
+        if (estimate_config(out, argv[i], records, count, i == optind + 2) != 0)
+            ret = 1;
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+    free(records);
+
+    return ret;
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * powerhint_replay - replay a hint trace against the HAL core on a host
+ *
+ *   powerhint_replay [-s speed | -v] [-p key=value]... [-o report.json] config_dir trace
+ *
+ * The trace is recorded on a device with persist.vendor.power.hint_trace=1
+ * and pulled from /data/vendor/power/hint_trace.bin. Calls are replayed
+ * in order at @speed times the original pace, 0 replays without waiting.
+ * With -v request timing runs on the virtual clock instead: the calls
+ * replay without waiting and every timer expires exactly where it would
+ * have between them, so the result only depends on the trace.
+ * The report holds the latency and node writes of every hint and the
+ * effective value of every node after the last call.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <cutils/properties.h>
+
+#include "../clock.h"
+#include "../common.h"
+#include "../config.h"
+#include "../hint_trace.h"
+#include "../lockstat.h"
+#include "../sprd_power.h"
+#include "../stats.h"
+#include "../vfs.h"
+#include "fakefs.h"
+
+#define NUM_REPLAY_CALL_MAX               64
+
+extern struct sprd_power_module power_impl;
+
+/**
+ * struct replay_call - the replay result of one kind of call
+ * @type: HINT_TRACE_*
+ * @hint: the hint id of HINT_TRACE_HINT calls
+ * @hist: latency of the calls, holding nanoseconds here
+ * @writes: node writes issued by the calls
+ */
+struct replay_call {
+    int type;
+    int hint;
+    struct hist hist;
+    uint64_t writes;
+};
+
+static struct replay_call calls[NUM_REPLAY_CALL_MAX];
+static int call_count = 0;
+
+static struct replay_call *find_call(int type, int hint)
+{
+    for (int i = 0; i < call_count; i++) {
+        if (calls[i].type == type && calls[i].hint == hint)
+            return &calls[i];
+    }
+
+    if (call_count >= NUM_REPLAY_CALL_MAX)
+        return NULL;
+
+    calls[call_count].type = type;
+    calls[call_count].hint = hint;
+    return &calls[call_count++];
+}
+
+static uint64_t vfs_writes(void)
+{
+    struct vfs_stats stats;
+
+    vfs_get_stats(&stats);
+    return stats.writes;
+}
+
+// Sleep until @ts_ns of the trace, scaled by @speed, has elapsed since @start
+static void wait_for(int64_t start, int64_t ts_ns, double speed)
+{
+    int64_t delay = 0;
+    struct timespec ts;
+
+    if (speed <= 0)
+        return;
+
+    delay = start + (int64_t)(ts_ns / speed) - stats_now_ns();
+    if (delay <= 0)
+        return;
+
+    ts.tv_sec = delay / 1000000000L;
+    ts.tv_nsec = delay % 1000000000L;
+    nanosleep(&ts, NULL);
+}
+
+static void replay_record(const struct hint_trace_record *record)
+{
+    struct replay_call *call = NULL;
+    int data = record->data;
+    uint64_t writes = vfs_writes();
+    int64_t start = stats_now_ns();
+
+    switch (record->type) {
+    case HINT_TRACE_HINT:
+        power_impl.powerHint(&power_impl, record->hint
+            , (record->flags & HINT_TRACE_FLAG_DATA)? &data: NULL);
+        break;
+    case HINT_TRACE_INTERACTIVE:
+        power_impl.setInteractive(&power_impl, data);
+        break;
+    case HINT_TRACE_CTRL:
+        power_impl.ctrl_power_hint(&power_impl, data);
+        break;
+    default:
+        return;
+    }
+
+    call = find_call(record->type, (record->type == HINT_TRACE_HINT)? record->hint: 0);
+    if (call == NULL)
+        return;
+
+    hist_add(&call->hist, stats_now_ns() - start);
+    call->writes += vfs_writes() - writes;
+}
+
+static const char *call_name(const struct replay_call *call)
+{
+    const char *name = NULL;
+
+    switch (call->type) {
+    case HINT_TRACE_INTERACTIVE:
+        return "setInteractive";
+    case HINT_TRACE_CTRL:
+        return "ctrl_power_hint";
+    default:
+        name = scene_id_to_string(call->hint, 0);
+        return (name != NULL)? name: "unknown";
+    }
+}
+
+static void print_node(FILE *out, const char *path, const char *name, const struct file *file, bool *first)
+{
+    char buf[LEN_VFS_PATH_MAX] = {'\0'};
+    char value[LEN_VALUE_MAX] = {'\0'};
+
+    snprintf(buf, sizeof(buf), "%s/%s", path, name);
+    // A node that holds its request by an open fd has none once it is closed
+    if (file != NULL && file->set == common_set_for_release_when_close && file->fd <= 0)
+        snprintf(value, sizeof(value), "released");
+    else if (fakefs_read(buf, value, sizeof(value)) < 0)
+        return;
+
+    fprintf(out, "%s\n    {\"node\": \"%s\", \"value\": \"%s\"}", *first? "": ",", buf, value);
+    *first = false;
+}
+
+static void print_report(FILE *out, const char *trace, int count, double speed, int64_t elapsed_ns)
+{
+    struct replay_call *call = NULL;
+    uint64_t writes = 0;
+    bool first = true;
+
+    for (int i = 0; i < call_count; i++)
+        writes += calls[i].writes;
+
+    fprintf(out, "{\n  \"trace\": \"%s\",\n  \"records\": %d,\n  \"speed\": %g,\n"
+        "  \"elapsed_ms\": %lld,\n  \"writes\": %llu,\n  \"calls\": ["
+        , trace, count, speed, (long long)(elapsed_ns/1000000), (unsigned long long)writes);
+    for (int i = 0; i < call_count; i++) {
+        call = &calls[i];
+        fprintf(out, "%s\n    {\"call\": \"%s\", \"hint\": \"0x%08x\", \"count\": %llu"
+            ", \"mean_ns\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu, \"writes\": %llu}"
+            , (i == 0)? "": ",", call_name(call), call->hint
+            , (unsigned long long)call->hist.count
+            , (unsigned long long)(call->hist.sum_us/call->hist.count)
+            , (unsigned long long)hist_percentile(&call->hist, 50)
+            , (unsigned long long)hist_percentile(&call->hist, 99)
+            , (unsigned long long)call->hist.max_us
+            , (unsigned long long)call->writes);
+    }
+
+    fprintf(out, "\n  ],\n  \"nodes\": [");
+    for (int i = 0; i < resources.count; i++) {
+        struct path_file *path_file = &(resources.path_files[i]);
+
+        // Subsys files are not nodes, their inodes are listed below
+        if (strcmp(path_file->path, "subsys") == 0)
+            continue;
+
+        for (int j = 0; j < path_file->count; j++)
+            print_node(out, path_file->path, path_file->files[j].name, &(path_file->files[j]), &first);
+    }
+    for (int i = 0; i < resources.subsys_count; i++) {
+        struct subsys *subsys = &(resources.subsystems[i]);
+
+        for (int j = 0; j < subsys->inode_count; j++)
+            print_node(out, subsys->inodes[j].path, subsys->inodes[j].file, NULL, &first);
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-s speed | -v] [-p key=value]... [-o report.json] config_dir trace\n"
+        , name);
+}
+
+int main(int argc, char *argv[])
+{
+    struct hint_trace_record *records = NULL;
+    char root[LEN_VFS_PATH_MAX] = {'\0'};
+    FILE *out = stdout;
+    double speed = 1.0;
+    bool virtual_clock = false;
+    int64_t wall_start = 0;
+    int64_t start = 0;
+    char *value = NULL;
+    int count = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "s:vp:o:h")) != -1) {
+        switch (opt) {
+        case 's':
+            speed = atof(optarg);
+            break;
+        case 'v':
+            virtual_clock = true;
+            speed = 0;
+            break;
+        case 'p':
+            value = strchr(optarg, '=');
+            if (value == NULL) {
+                usage(argv[0]);
+                return 1;
+            }
+            *value++ = '\0';
+            property_set(optarg, value);
+            break;
+        case 'o':
+            out = fopen(optarg, "w");
+            if (out == NULL) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    count = hint_trace_read(argv[optind + 1], &records);
+    if (count < 0) {
+        fprintf(stderr, "Read hint trace %s fail\n", argv[optind + 1]);
+        return 1;
+    }
+
+    if (fakefs_create(argv[optind], root, sizeof(root)) != 0) {
+        fprintf(stderr, "Create fake node tree for %s fail\n", argv[optind]);
+        return 1;
+    }
+
+    if (virtual_clock)
+        clock_use_virtual(0);
+    power_impl.init(&power_impl);
+    if (!power_impl.init_done) {
+        fprintf(stderr, "Init the HAL with %s fail\n", argv[optind]);
+        fakefs_destroy(root);
+        return 1;
+    }
+
+    vfs_reset_stats();
+    wall_start = stats_now_ns();
+    start = virtual_clock? clock_monotonic_ns(): wall_start;
+    for (int i = 0; i < count; i++) {
+        if (virtual_clock)
+            clock_advance(start + records[i].ts_ns - clock_monotonic_ns());
+        else
+            wait_for(start, records[i].ts_ns, speed);
+        replay_record(&records[i]);
+    }
+
+    power_lock(__func__);
+    print_report(out, argv[optind + 1], count, speed, stats_now_ns() - wall_start);
+    power_unlock();
+
+    if (out != stdout)
+        fclose(out);
+    fakefs_destroy(root);
+    free(records);
+
+    return 0;
+}
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * powerhint_stress - hammer the HAL entry points from many threads
+ *
+ *   powerhint_stress [-t threads] [-d duration_ms] [-r seed] [-w write_us] [-c] [-f] [-o report.json] config_dir
+ *
+ * Every thread issues a mix of interaction, launch, scene on/off, timed
+ * scene and screen on/off calls as fast as it can. With -c every thread
+ * turns its own scene on and off instead, the scenes of the threads
+ * sharing no node where the config allows. With -w every node
+ * write takes write_us more, as a slow sysfs node does, so the threads
+ * contend on the nodes rather than on the CPU. With -f background hints
+ * aren't deferred, all hints are handled first come first served. The
+ * report holds the latency of every kind of call, the queueing delay
+ * of every hint class, the wait/hold profile of the HAL lock including its
+ * longest holders, the wait for the locks of the resource files, and
+ * how late the timer thread applied request timeouts past their
+ * deadlines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../common.h"
+#include "../config.h"
+#include "../hint_class.h"
+#include "../hint_id.h"
+#include "../lockstat.h"
+#include "../sprd_power.h"
+#include "../stats.h"
+#include "../thread_sched.h"
+#include "../vfs.h"
+#include "fakefs.h"
+
+#define STRESS_THREADS_DEFAULT            8
+#define STRESS_DURATION_MS_DEFAULT        2000
+#define STRESS_TIMED_DURATION_MIN         BOOST_DURATION_DEFAULT
+#define STRESS_TIMED_DURATION_RANGE       1000
+
+extern struct sprd_power_module power_impl;
+
+enum {
+    CALL_INTERACTION = 0,
+    CALL_LAUNCH,
+    CALL_SCENE,
+    CALL_SCENE_TIMED,
+    CALL_INTERACTIVE,
+    CALL_MAX,
+};
+
+/**
+ * struct call_mix - how often one kind of call is issued
+ * @name: the name in the report
+ * @weight: the share of the calls, out of 100
+ */
+struct call_mix {
+    const char *name;
+    int weight;
+};
+
+// Roughly what the framework sends while an app is being used
+static const struct call_mix mix[CALL_MAX] = {
+    [CALL_INTERACTION] = { "interaction", 45 },
+    [CALL_LAUNCH] = { "launch", 15 },
+    [CALL_SCENE] = { "scene", 25 },
+    [CALL_SCENE_TIMED] = { "scene_timed", 13 },
+    [CALL_INTERACTIVE] = { "interactive", 2 },
+};
+
+static struct hist call_hists[CALL_MAX];
+static int scene_ids[NUM_SCENE_MAX];
+static int scene_count = 0;
+// The scenes owned by the threads with -c, see find_disjoint_scenes()
+static int owned_ids[NUM_SCENE_MAX];
+static int owned_count = 0;
+static int next_owner = 0;
+static int64_t deadline = 0;
+static uint64_t total_calls = 0;
+
+static void call_hint(int kind, int hint, int *data)
+{
+    int64_t start = stats_now_ns();
+
+    power_impl.powerHint(&power_impl, hint, data);
+    hist_add(&call_hists[kind], (stats_now_ns() - start) / 1000);
+}
+
+static void call_interactive(int on)
+{
+    int64_t start = stats_now_ns();
+
+    power_impl.setInteractive(&power_impl, on);
+    hist_add(&call_hists[CALL_INTERACTIVE], (stats_now_ns() - start) / 1000);
+}
+
+static int pick_call(unsigned int *seed)
+{
+    int r = rand_r(seed) % 100;
+
+    for (int i = 0; i < CALL_MAX; i++) {
+        if (r < mix[i].weight)
+            return i;
+        r -= mix[i].weight;
+    }
+
+    return CALL_INTERACTION;
+}
+
+// Turn the scene owned by this thread on and off
+static void *contend_thread(void *args)
+{
+    int owner = __atomic_fetch_add(&next_owner, 1, __ATOMIC_RELAXED);
+    int hint = owned_ids[owner % owned_count];
+    uint64_t calls = 0;
+    int one = 1;
+
+    while (stats_now_ns() < deadline) {
+        call_hint(CALL_SCENE, hint, &one);
+        call_hint(CALL_SCENE, hint, NULL);
+        calls += 2;
+    }
+
+    __atomic_fetch_add(&total_calls, calls, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void *stress_thread(void *args)
+{
+    unsigned int seed = (unsigned int)(uintptr_t)args;
+    uint64_t calls = 0;
+    int one = 1;
+    int data = 0;
+    int hint = 0;
+
+    while (stats_now_ns() < deadline) {
+        switch (pick_call(&seed)) {
+        case CALL_INTERACTION:
+            data = BOOST_DURATION_DEFAULT + rand_r(&seed) % BOOST_DURATION_DEFAULT;
+            call_hint(CALL_INTERACTION, POWER_HINT_INTERACTION, &data);
+            calls++;
+            break;
+        case CALL_LAUNCH:
+            call_hint(CALL_LAUNCH, POWER_HINT_LAUNCH, &one);
+            call_hint(CALL_LAUNCH, POWER_HINT_LAUNCH, NULL);
+            calls += 2;
+            break;
+        case CALL_SCENE:
+            if (scene_count == 0) break;
+            hint = scene_ids[rand_r(&seed) % scene_count];
+            call_hint(CALL_SCENE, hint, &one);
+            call_hint(CALL_SCENE, hint, NULL);
+            calls += 2;
+            break;
+        case CALL_SCENE_TIMED:
+            if (scene_count == 0) break;
+            hint = scene_ids[rand_r(&seed) % scene_count];
+            data = STRESS_TIMED_DURATION_MIN + rand_r(&seed) % STRESS_TIMED_DURATION_RANGE;
+            call_hint(CALL_SCENE_TIMED, hint, &data);
+            calls++;
+            break;
+        case CALL_INTERACTIVE:
+            call_interactive(0);
+            call_interactive(1);
+            calls += 2;
+            break;
+        }
+    }
+
+    __atomic_fetch_add(&total_calls, calls, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// The vendor scenes of the default mode, driven through their hint ids
+static void find_scenes(void)
+{
+    int scene_id = 0;
+    int subtype = 0;
+
+    for (int i = 0; i < default_mode->count; i++) {
+        if (scene_name_to_id_subtype(default_mode->scenes[i].name, &scene_id, &subtype) == 0
+            || scene_id < POWER_HINT_VENDOR_BENCHMARK
+            || scene_id >= POWER_HINT_VENDOR_INTERACTION_OTHER)
+            continue;
+
+        scene_ids[scene_count++] = scene_id;
+    }
+}
+
+static bool scene_has_file(const struct scene *scene, const struct file *file)
+{
+    for (int i = 0; i < scene->count; i++) {
+        if (scene_set_entry(scene, i)->file == file)
+            return true;
+    }
+
+    return false;
+}
+
+// The vendor scenes sharing no node with the ones picked before them
+static void find_disjoint_scenes(void)
+{
+    const struct scene *picked[NUM_SCENE_MAX];
+    const struct scene *scene = NULL;
+    int scene_id = 0;
+    int subtype = 0;
+    bool shared = false;
+
+    for (int i = 0; i < default_mode->count; i++) {
+        scene = &(default_mode->scenes[i]);
+        if (scene->count == 0
+            || scene_name_to_id_subtype(scene->name, &scene_id, &subtype) == 0
+            || scene_id < POWER_HINT_VENDOR_BENCHMARK
+            || scene_id >= POWER_HINT_VENDOR_INTERACTION_OTHER)
+            continue;
+
+        shared = false;
+        for (int j = 0; j < owned_count && !shared; j++) {
+            for (int k = 0; k < scene->count && !shared; k++)
+                shared = scene_has_file(picked[j], scene_set_entry(scene, k)->file);
+        }
+        if (shared)
+            continue;
+
+        picked[owned_count] = scene;
+        owned_ids[owned_count++] = scene_id;
+    }
+}
+
+static void print_hist(FILE *out, const char *name, const struct hist *hist)
+{
+    fprintf(out, "\"%s\": {\"count\": %llu, \"mean_us\": %llu, \"p50_us\": %llu, \"p90_us\": %llu"
+        ", \"p99_us\": %llu, \"max_us\": %llu}"
+        , name, (unsigned long long)hist->count
+        , (unsigned long long)((hist->count > 0)? hist->sum_us/hist->count: 0)
+        , (unsigned long long)hist_percentile(hist, 50)
+        , (unsigned long long)hist_percentile(hist, 90)
+        , (unsigned long long)hist_percentile(hist, 99)
+        , (unsigned long long)hist->max_us);
+}
+
+static void print_report(FILE *out, int threads, int write_us, int64_t elapsed_ns)
+{
+    const struct lock_profile *profile = lock_profile_get();
+    const struct lock_holder *holder = NULL;
+    const struct timer_latency *timer = thread_sched_timer_latency_get();
+    const struct hint_class_stats *background = hint_class_stats_get(HINT_CLASS_BACKGROUND);
+
+    fprintf(out, "{\n  \"threads\": %d,\n  \"write_us\": %d,\n  \"owned_scenes\": %d,\n"
+        "  \"elapsed_ms\": %lld,\n  \"calls\": %llu,\n  \"calls_per_sec\": %.0f,\n  \"latency\": {"
+        , threads, write_us, owned_count, (long long)(elapsed_ns/1000000)
+        , (unsigned long long)total_calls, total_calls * 1e9 / elapsed_ns);
+    for (int i = 0; i < CALL_MAX; i++) {
+        fprintf(out, "%s\n    ", (i == 0)? "": ",");
+        print_hist(out, mix[i].name, &call_hists[i]);
+    }
+
+    fprintf(out, "\n  },\n  \"classes\": {\n    \"deferred\": %llu,\n    \"starved\": %llu,\n    \"forced\": %llu"
+        , (unsigned long long)background->deferred, (unsigned long long)background->starved
+        , (unsigned long long)background->forced);
+    for (int i = 0; i < HINT_CLASS_MAX; i++) {
+        fprintf(out, ",\n    ");
+        print_hist(out, hint_class_name(i), &hint_class_stats_get(i)->queue);
+    }
+    fprintf(out, "\n  },\n  \"lock\": {\n    ");
+    print_hist(out, "wait", &profile->wait);
+    fprintf(out, ",\n    ");
+    print_hist(out, "hold", &profile->hold);
+    fprintf(out, ",\n    ");
+    print_hist(out, "file_wait", &profile->file_wait);
+    fprintf(out, ",\n    \"sites\": [");
+    for (int i = 0; i < profile->site_count; i++) {
+        fprintf(out, "%s\n      {\"site\": \"%s\", ", (i == 0)? "": ",", profile->sites[i].site);
+        print_hist(out, "wait", &profile->sites[i].wait);
+        fprintf(out, ", ");
+        print_hist(out, "hold", &profile->sites[i].hold);
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n    ],\n    \"longest\": [");
+    for (int i = 0; i < NUM_LOCK_HOLDER_MAX; i++) {
+        holder = &profile->longest[i];
+        if (holder->hold_us == 0)
+            break;
+
+        fprintf(out, "%s\n      {\"site\": \"%s\", \"scene\": \"%s\", \"hold_us\": %llu}"
+            , (i == 0)? "": ",", holder->site, (holder->scene != NULL)? holder->scene: ""
+            , (unsigned long long)holder->hold_us);
+    }
+    fprintf(out, "\n    ]\n  },\n  \"timer\": {\n    ");
+    print_hist(out, "wake", &timer->wake);
+    fprintf(out, ",\n    ");
+    print_hist(out, "apply", &timer->apply);
+    fprintf(out, "\n  }\n}\n");
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-t threads] [-d duration_ms] [-r seed] [-w write_us] [-c]"
+        " [-f] [-o report.json] config_dir\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    char root[LEN_VFS_PATH_MAX] = {'\0'};
+    pthread_t *tids = NULL;
+    int threads = STRESS_THREADS_DEFAULT;
+    int duration = STRESS_DURATION_MS_DEFAULT;
+    unsigned int seed = 1;
+    int write_us = 0;
+    bool contend = false;
+    FILE *out = stdout;
+    int64_t start = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "t:d:r:w:cfo:h")) != -1) {
+        switch (opt) {
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'd':
+            duration = atoi(optarg);
+            break;
+        case 'r':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            write_us = atoi(optarg);
+            break;
+        case 'c':
+            contend = true;
+            break;
+        case 'f':
+            property_set(POWER_HINT_CLASS_PROP, "0");
+            break;
+        case 'o':
+            out = fopen(optarg, "w");
+            if (out == NULL) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc - optind != 1 || threads <= 0 || duration <= 0 || write_us < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (fakefs_create(argv[optind], root, sizeof(root)) != 0) {
+        fprintf(stderr, "Create fake node tree for %s fail\n", argv[optind]);
+        return 1;
+    }
+
+    power_impl.init(&power_impl);
+    if (!power_impl.init_done) {
+        fprintf(stderr, "Init the HAL with %s fail\n", argv[optind]);
+        fakefs_destroy(root);
+        return 1;
+    }
+    power_impl.setInteractive(&power_impl, 1);
+    find_scenes();
+    if (contend) {
+        find_disjoint_scenes();
+        if (owned_count == 0) {
+            fprintf(stderr, "No vendor scene in %s\n", argv[optind]);
+            fakefs_destroy(root);
+            return 1;
+        }
+    }
+    if (write_us > 0)
+        vfs_add_fault("/", VFS_OP_WRITE, 0, write_us, 0);
+
+    lock_profile_reset();
+    tids = calloc(threads, sizeof(pthread_t));
+    start = stats_now_ns();
+    deadline = start + duration * 1000000LL;
+    for (int i = 0; i < threads; i++)
+        pthread_create(&tids[i], NULL, contend? contend_thread: stress_thread
+            , (void *)(uintptr_t)(seed + i));
+    for (int i = 0; i < threads; i++)
+        pthread_join(tids[i], NULL);
+
+    power_lock(__func__);
+    print_report(out, threads, write_us, stats_now_ns() - start);
+    power_unlock();
+
+    if (out != stdout)
+        fclose(out);
+    fakefs_destroy(root);
+    free(tids);
+
+    return 0;
+}
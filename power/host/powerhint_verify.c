@@ -0,0 +1,1407 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * powerhint_verify - verify every scene of a config on a host
+ *
+ *   powerhint_verify [-q] [-a] [-o report.json] config_dir...
+ *
+ * The native counterpart of test/powerhint_test.py: every scene of every
+ * mode is entered and left against a fake node tree. After entering,
+ * every node the scene sets must hold the configured value, a subsys set
+ * is expanded to the inodes of its conf. After leaving, every node must
+ * hold its default again. Values compare like the script does, without
+ * case and surrounding blanks. Request timing runs on the virtual clock,
+ * so nothing waits. Exits with 1 if any check failed.
+ *
+ * A config with an escalating scene or the memory scenes also gets a
+ * psi case, the PSI monitor run on fake pressure files: the CPU trigger
+ * must enter the stronger scene and a stall rate under PSI_RELAX_PCT of
+ * the trigger's must leave it; the memory level must rise on its
+ * triggers and on direct reclaim and drop one step per PSI_MEM_HOLD_MS
+ * of low pressure. A mode switch in between must keep the monitor off
+ * the requests made since. The kernel refuses the first trigger window,
+ * as Linux 6.5 does an unprivileged one, so the fallback is taken. No
+ * shipped config has the memory scenes, host/config_files/psi is a fake
+ * product that does.
+ *
+ * With -a the configs are analyzed as well, reporting per scene the
+ * node writes and syscalls of entering and leaving it from idle (every
+ * node it sets is written then, the worst case but for the ddr governor
+ * dropping a held request first) and warning about:
+ *
+ *   capacity   a mode or scene over NUM_SCENE_MAX/NUM_FILE_MAX, or more
+ *              than NUM_SET_MAX distinct sets, the config then fails to load
+ *   no_id      a scene missing from the id file, it can't be requested
+ *   noop       a set writing the default value of its node
+ *   min_max    a scene setting a min node above its max sibling
+ *   conflict   a min of a scene above the max another scene sets
+ *   duplicate  two scenes of a mode with the same effect
+ *   unused     a resource, subsys conf or inode no scene uses
+ *
+ * Warnings don't change the exit code.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <libxml/parser.h>
+
+#include "../clock.h"
+#include "../common.h"
+#include "../config.h"
+#include "../devfreq.h"
+#include "../psi_monitor.h"
+#include "../sprd_power.h"
+#include "../stats.h"
+#include "../utils.h"
+#include "../vfs.h"
+#include "fakefs.h"
+
+#define NUM_VERIFY_NODE_MAX               (NUM_RESOURCE_MAX * NUM_FILE_MAX)
+#define NUM_VERIFY_CHECK_MAX              (NUM_FILE_MAX * NUM_FILE_MAX)
+#define VALUE_RELEASED                    "released"
+
+enum {
+    PSI_STATE_IDLE = 0,
+    // The escalating scene entered
+    PSI_STATE_SOURCE,
+    // The scene it escalates to entered on top
+    PSI_STATE_ESCALATED,
+    // The scene it escalates to requested by hand after a mode switch
+    PSI_STATE_CLEARED,
+    // The scenes of each memory level entered
+    PSI_STATE_MEM_SOME,
+    PSI_STATE_MEM_FULL,
+    NUM_PSI_STATE_MAX,
+};
+
+extern struct sprd_power_module power_impl;
+
+/**
+ * struct verify_node - a node of the fake tree and its default
+ * @path: the node
+ * @def_value: the value after init, what every scene must restore
+ * @file: the resource file of the node, NULL for a subsys inode
+ * @table_value: the default as a scaling table holds it once rewritten
+ * @restore: false if the node has no default to restore
+ * @def_given: the default is set by the resource file, not read from the fake node
+ */
+struct verify_node {
+    char path[LEN_VFS_PATH_MAX];
+    char def_value[LEN_VALUE_MAX];
+    char table_value[LEN_VALUE_MAX];
+    struct file *file;
+    bool restore;
+    bool def_given;
+};
+
+/**
+ * struct verify_check - a value a node must hold inside a scene
+ * @path: the node
+ * @value: the expected value
+ * @file: the resource file, only to tell a released node
+ */
+struct verify_check {
+    char path[LEN_VFS_PATH_MAX];
+    char value[LEN_VALUE_MAX];
+    struct file *file;
+};
+
+/**
+ * struct scene_cost - the I/O of entering and leaving a scene from idle
+ * @mode: the mode of the scene
+ * @scene: the scene
+ * @enter: the I/O of entering the scene
+ * @exit: the I/O of leaving the scene
+ */
+struct scene_cost {
+    const struct mode *mode;
+    const struct scene *scene;
+    struct vfs_stats enter;
+    struct vfs_stats exit;
+};
+
+/**
+ * struct effective_set - a node value a scene sets, subsys sets expanded
+ * @path: the directory
+ * @file: the file name
+ * @value: the value set
+ * @base: the number base of the value, 0 if it is no number
+ * @subsys: the subsys the set comes from, NULL for a direct set
+ */
+struct effective_set {
+    const char *path;
+    const char *file;
+    const char *value;
+    int base;
+    const struct subsys *subsys;
+};
+
+static struct verify_node nodes[NUM_VERIFY_NODE_MAX];
+static int node_count = 0;
+static struct verify_check checks[NUM_VERIFY_CHECK_MAX];
+static int check_count = 0;
+
+static struct scene_cost costs[NUM_MODE_MAX * NUM_SCENE_MAX];
+static int cost_count = 0;
+
+static bool quiet = false;
+static bool analyze = false;
+// The analysis JSON is collected apart and appended after the failures
+static FILE *scene_out = NULL;
+static FILE *warning_out = NULL;
+static bool first_scene = true;
+static bool first_warning = true;
+static int warnings_total = 0;
+static char ddr_max_freq[LEN_VALUE_MAX] = {'\0'};
+static int checks_total = 0;
+static int failures_total = 0;
+static bool first_failure = true;
+// The node values of the PSI cases, PSI_STATE_*
+static char psi_states[NUM_PSI_STATE_MAX][NUM_VERIFY_NODE_MAX][LEN_VALUE_MAX];
+static uint64_t psi_cpu_stall_us = 0;
+static uint64_t psi_mem_stall_us[2] = {0};
+static uint64_t psi_allocstall = 0;
+
+// The scaling tables take one "<index> <value>" write per entry, the node keeps the last
+static bool is_table_node(const char *file)
+{
+    return strstr(file, "overflow") != NULL || strstr(file, "underflow") != NULL;
+}
+
+static void table_value(const char *value, char *out, int size)
+{
+    char buf[LEN_VALUE_MAX] = {'\0'};
+    char *saveptr = NULL;
+    char *last = NULL;
+    int index = -1;
+
+    snprintf(buf, sizeof(buf), "%s", value);
+    for (char *ptr = strtok_r(buf, " ", &saveptr); ptr != NULL; ptr = strtok_r(NULL, " ", &saveptr)) {
+        last = ptr;
+        index++;
+    }
+    snprintf(out, size, "%d %s", index, (last != NULL)? last: "");
+}
+
+static const char *trim(char *value)
+{
+    char *end = value + strlen(value);
+
+    while (isspace((unsigned char)*value))
+        value++;
+    while (end > value && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+
+    return value;
+}
+
+// Read the value a node holds now, "released" for a request released by closing its fd
+static void read_node(const char *path, const struct file *file, char *value, int size)
+{
+    if (file != NULL && file->set == common_set_for_release_when_close && file->fd <= 0) {
+        snprintf(value, size, VALUE_RELEASED);
+        return;
+    }
+
+    if (fakefs_read(path, value, size) < 0)
+        snprintf(value, size, "<missing>");
+}
+
+static void add_node(const char *path, const char *name, struct file *file, bool restore)
+{
+    struct verify_node *node = NULL;
+
+    if (node_count >= NUM_VERIFY_NODE_MAX)
+        return;
+
+    node = &nodes[node_count++];
+    snprintf(node->path, sizeof(node->path), "%s/%s", path, name);
+    node->file = file;
+    node->restore = restore;
+    // The HAL reads the other defaults from the nodes on the first boost
+    node->def_given = file != NULL && file->value.def_value[0] != '\0';
+    read_node(node->path, file, node->def_value, sizeof(node->def_value));
+    node->table_value[0] = '\0';
+    if (file == NULL && is_table_node(name))
+        table_value(node->def_value, node->table_value, sizeof(node->table_value));
+}
+
+// Record the default of every node, before any scene is entered
+static void snapshot_nodes(void)
+{
+    struct path_file *path_file = NULL;
+    struct subsys *subsys = NULL;
+    struct file *file = NULL;
+
+    node_count = 0;
+    for (int i = 0; i < resources.count; i++) {
+        path_file = &(resources.path_files[i]);
+        if (strcmp(path_file->path, "subsys") == 0)
+            continue;
+
+        for (int j = 0; j < path_file->count; j++) {
+            file = &(path_file->files[j]);
+            add_node(path_file->path, file->name, file
+                , file->no_has_def == 0 && file->set != devfreq_ddr_set);
+        }
+    }
+
+    for (int i = 0; i < resources.subsys_count; i++) {
+        subsys = &(resources.subsystems[i]);
+        for (int j = 0; j < subsys->inode_count; j++)
+            add_node(subsys->inodes[j].path, subsys->inodes[j].file, NULL
+                , subsys->inodes[j].no_has_def == 0);
+    }
+}
+
+static void add_check(const char *path, const char *name, const char *value, struct file *file)
+{
+    struct verify_check *check = NULL;
+
+    if (check_count >= NUM_VERIFY_CHECK_MAX)
+        return;
+
+    check = &checks[check_count++];
+    snprintf(check->path, sizeof(check->path), "%s/%s", path, name);
+    snprintf(check->value, sizeof(check->value), "%s", value);
+    check->file = file;
+}
+
+static struct file *find_resource(const struct set *set, const char **path)
+{
+    struct path_file *path_file = NULL;
+
+    for (int i = 0; i < resources.count; i++) {
+        path_file = &(resources.path_files[i]);
+        if (strcmp(set->path, path_file->path) != 0)
+            continue;
+
+        for (int j = 0; j < path_file->count; j++) {
+            if (strcmp(set->file, path_file->files[j].name) == 0) {
+                *path = path_file->path;
+                return &(path_file->files[j]);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Expand a subsys set to the inodes its conf sets
+static int add_subsys_checks(const struct set *set)
+{
+    struct subsys *subsys = NULL;
+    struct config *config = NULL;
+    char value[LEN_VALUE_MAX] = {'\0'};
+    int len = strcspn(set->value, ":");
+
+    subsys = find_subsys_by_name((char *)set->file);
+    if (subsys == NULL)
+        return -1;
+
+    for (int i = 0; i < subsys->config_count; i++) {
+        if (strncmp(subsys->configs[i].name, set->value, len) == 0
+            && subsys->configs[i].name[len] == '\0') {
+            config = &(subsys->configs[i]);
+            break;
+        }
+    }
+    if (config == NULL)
+        return -1;
+
+    for (int i = 0; i < config->count; i++) {
+        if (is_table_node(config->sets[i].file))
+            table_value(config->sets[i].value, value, sizeof(value));
+        else
+            snprintf(value, sizeof(value), "%s", config->sets[i].value);
+        add_check(config->sets[i].path, config->sets[i].file, value, NULL);
+    }
+
+    return 0;
+}
+
+// The values every node of @scene must hold once it is entered, -1 if a set names no resource
+static int build_checks(const struct scene *scene, char *error, int size)
+{
+    struct file *file = NULL;
+    const struct set *set = NULL;
+    const char *path = NULL;
+    char value[LEN_VALUE_MAX] = {'\0'};
+
+    check_count = 0;
+    for (int i = 0; i < scene->count; i++) {
+        set = scene_set(scene, i);
+        file = find_resource(set, &path);
+        if (file == NULL) {
+            snprintf(error, size, "undefined resource %s/%s", set->path, set->file);
+            return -1;
+        }
+
+        if (strcmp(path, "subsys") == 0) {
+            if (add_subsys_checks(set) != 0) {
+                snprintf(error, size, "undefined conf %s of subsys %s", set->value, set->file);
+                return -1;
+            }
+        } else if (file->set == devfreq_ddr_set) {
+            // The governor takes "<enable> <freq>", max being the top of the freq table
+            if (snprintf(value, sizeof(value), "1 %s"
+                    , (strncmp(set->value, "max", 3) == 0)? ddr_max_freq: set->value) >= (int)sizeof(value)) {
+                snprintf(error, size, "value of %s/%s is too long", set->path, set->file);
+                return -1;
+            }
+            add_check(path, set->file, value, file);
+        } else {
+            add_check(path, set->file, set->value, file);
+        }
+    }
+
+    return 0;
+}
+
+static void report_failure(FILE *out, const char *config, const char *mode, const char *scene
+    , const char *phase, const char *node, const char *expected, const char *actual)
+{
+    failures_total++;
+    if (!quiet && expected == NULL)
+        printf("FAIL %s/%s/%s %s: %s\n", config, mode, scene, phase, node);
+    else if (!quiet)
+        printf("FAIL %s/%s/%s %s: %s expected \"%s\" got \"%s\"\n"
+            , config, mode, scene, phase, node, expected, actual);
+    if (out == NULL)
+        return;
+
+    fprintf(out, "%s\n    {\"config\": \"%s\", \"mode\": \"%s\", \"scene\": \"%s\", \"phase\": \"%s\""
+        ", \"node\": \"%s\", \"expected\": \"%s\", \"actual\": \"%s\"}"
+        , first_failure? "": ",", config, mode, scene, phase, node
+        , (expected != NULL)? expected: "", (actual != NULL)? actual: "");
+    first_failure = false;
+}
+
+static bool value_matches(const char *expected, char *actual)
+{
+    char buf[LEN_VALUE_MAX] = {'\0'};
+
+    snprintf(buf, sizeof(buf), "%s", expected);
+    return strcasecmp(trim(buf), trim(actual)) == 0;
+}
+
+// Start accounting the I/O of a call into @stats
+static void cost_begin(struct vfs_stats *stats)
+{
+    if (stats != NULL)
+        vfs_get_stats(stats);
+}
+
+// Turn @stats into the I/O issued since cost_begin()
+static void cost_end(struct vfs_stats *stats)
+{
+    struct vfs_stats now;
+
+    if (stats == NULL)
+        return;
+
+    vfs_get_stats(&now);
+    stats->opens = now.opens - stats->opens;
+    stats->closes = now.closes - stats->closes;
+    stats->reads = now.reads - stats->reads;
+    stats->writes = now.writes - stats->writes;
+    stats->write_bytes = now.write_bytes - stats->write_bytes;
+}
+
+static uint64_t syscalls(const struct vfs_stats *stats)
+{
+    return stats->opens + stats->closes + stats->reads + stats->writes;
+}
+
+static void warn(const char *config, const char *mode, const char *scene, const char *kind
+    , const char *fmt, ...)
+{
+    char detail[LEN_VFS_PATH_MAX * 2] = {'\0'};
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(detail, sizeof(detail), fmt, ap);
+    va_end(ap);
+
+    warnings_total++;
+    printf("WARN %s/%s/%s %s: %s\n", config, mode, scene, kind, detail);
+    if (warning_out == NULL)
+        return;
+
+    fprintf(warning_out, "%s\n    {\"config\": \"%s\", \"mode\": \"%s\", \"scene\": \"%s\""
+        ", \"kind\": \"%s\", \"detail\": \"%s\"}", first_warning? "": ",", config, mode, scene
+        , kind, detail);
+    first_warning = false;
+}
+
+// Count the distinct sets the way intern_set() does, up to one over the limit
+static int count_distinct_set(xmlNodePtr set, int count)
+{
+    static char keys[NUM_SET_MAX + 1][LEN_PATH_MAX + LEN_FILE_MAX + LEN_VALUE_MAX];
+    xmlChar *path = xmlGetProp(set, BAD_CAST"path");
+    xmlChar *file = xmlGetProp(set, BAD_CAST"file");
+    xmlChar *value = xmlGetProp(set, BAD_CAST"value");
+    char key[sizeof(keys[0])] = {'\0'};
+
+    snprintf(key, sizeof(key), "%s|%s|%s", path, file, value);
+    xmlFree(path);
+    xmlFree(file);
+    xmlFree(value);
+    if (count > NUM_SET_MAX)
+        return count;
+
+    for (int i = 0; i < count; i++) {
+        if (strcmp(keys[i], key) == 0)
+            return count;
+    }
+    memcpy(keys[count], key, sizeof(key));
+
+    return count + 1;
+}
+
+// Count what the scene file holds against the limits, config_read() fails past them
+static void check_capacity(const char *config)
+{
+    char path[LEN_VFS_PATH_MAX] = {'\0'};
+    xmlDocPtr doc = NULL;
+    xmlNodePtr root = NULL;
+    int scenes = 0;
+    int sets = 0;
+    int distinct = 0;
+
+    doc = xmlParseFile(vfs_path(PATH_SCENE_CONFIG, path, sizeof(path)));
+    if (doc == NULL)
+        return;
+
+    root = xmlDocGetRootElement(doc);
+    for (xmlNodePtr mode = (root != NULL)? root->children: NULL; mode != NULL; mode = mode->next) {
+        xmlChar *mode_name = NULL;
+
+        if (mode->type != XML_ELEMENT_NODE || xmlStrcmp(mode->name, BAD_CAST"mode"))
+            continue;
+
+        mode_name = xmlGetProp(mode, BAD_CAST"name");
+        scenes = 0;
+        for (xmlNodePtr scene = mode->children; scene != NULL; scene = scene->next) {
+            xmlChar *scene_name = NULL;
+
+            if (scene->type != XML_ELEMENT_NODE || xmlStrcmp(scene->name, BAD_CAST"scene"))
+                continue;
+
+            scenes++;
+            sets = 0;
+            for (xmlNodePtr set = scene->children; set != NULL; set = set->next) {
+                if (set->type == XML_ELEMENT_NODE && xmlStrcmp(set->name, BAD_CAST"set") == 0) {
+                    sets++;
+                    distinct = count_distinct_set(set, distinct);
+                }
+            }
+
+            scene_name = xmlGetProp(scene, BAD_CAST"name");
+            if (sets > NUM_FILE_MAX)
+                warn(config, (char *)mode_name, (char *)scene_name, "capacity"
+                    , "%d sets, NUM_FILE_MAX is %d", sets, NUM_FILE_MAX);
+            xmlFree(scene_name);
+        }
+
+        if (scenes > NUM_SCENE_MAX)
+            warn(config, (char *)mode_name, "-", "capacity", "%d scenes, NUM_SCENE_MAX is %d"
+                , scenes, NUM_SCENE_MAX);
+        xmlFree(mode_name);
+    }
+
+    if (distinct > NUM_SET_MAX)
+        warn(config, "-", "-", "capacity", "more than NUM_SET_MAX %d distinct sets", NUM_SET_MAX);
+    xmlFreeDoc(doc);
+}
+
+static const struct verify_node *find_node(const char *path, const char *file)
+{
+    char buf[LEN_VFS_PATH_MAX] = {'\0'};
+
+    snprintf(buf, sizeof(buf), "%s/%s", path, file);
+    for (int i = 0; i < node_count; i++) {
+        if (strcmp(nodes[i].path, buf) == 0)
+            return &nodes[i];
+    }
+
+    return NULL;
+}
+
+static int value_base(const struct file *file)
+{
+    if (file == NULL)
+        return 10;
+    if (file->comp == common_comp_ascend_order_hex || file->comp == common_comp_descend_order_hex)
+        return 16;
+    if (file->comp == common_comp_ascend_order || file->comp == common_comp_descend_order)
+        return 10;
+
+    return 0;
+}
+
+static struct config *find_config(const struct subsys *subsys, const char *value)
+{
+    int len = strcspn(value, ":");
+
+    for (int i = 0; i < subsys->config_count; i++) {
+        if (strncmp(subsys->configs[i].name, value, len) == 0
+            && subsys->configs[i].name[len] == '\0')
+            return (struct config *)&(subsys->configs[i]);
+    }
+
+    return NULL;
+}
+
+// The node values @scene sets, returns the count
+static int expand_sets(const struct scene *scene, struct effective_set *sets, int size)
+{
+    const struct set *set = NULL;
+    const char *path = NULL;
+    struct file *file = NULL;
+    struct subsys *subsys = NULL;
+    struct config *config = NULL;
+    int count = 0;
+
+    for (int i = 0; i < scene->count; i++) {
+        set = scene_set(scene, i);
+        file = find_resource(set, &path);
+        if (file == NULL)
+            continue;
+
+        if (strcmp(path, "subsys") != 0) {
+            if (count < size)
+                sets[count++] = (struct effective_set){ set->path, set->file, set->value
+                    , value_base(file), NULL };
+            continue;
+        }
+
+        subsys = find_subsys_by_name((char *)set->file);
+        config = (subsys != NULL)? find_config(subsys, set->value): NULL;
+        for (int j = 0; config != NULL && j < config->count; j++) {
+            if (count < size)
+                sets[count++] = (struct effective_set){ config->sets[j].path, config->sets[j].file
+                    , config->sets[j].value, 10, subsys };
+        }
+    }
+
+    return count;
+}
+
+static bool parse_number(const char *value, int base, long long *number)
+{
+    char *end = NULL;
+
+    if (base == 0 || value[0] == '\0')
+        return false;
+
+    *number = strtoll(value, &end, base);
+    return *end == '\0';
+}
+
+// The max sibling of a min node, e.g. scaling_min_freq and scaling_max_freq
+static bool is_max_of(const struct effective_set *min, const struct effective_set *max)
+{
+    const char *pos = strstr(min->file, "min");
+    int len = pos - min->file;
+
+    if (pos == NULL || strcmp(min->path, max->path) != 0 || strlen(min->file) != strlen(max->file))
+        return false;
+
+    return strncmp(min->file, max->file, len) == 0 && strncmp(max->file + len, "max", 3) == 0
+        && strcmp(min->file + len + 3, max->file + len + 3) == 0;
+}
+
+// Whether the min @a sets is above the max @b sets
+static bool min_above_max(const struct effective_set *a, const struct effective_set *b)
+{
+    long long min = 0;
+    long long max = 0;
+
+    if (!is_max_of(a, b))
+        return false;
+
+    return parse_number(a->value, a->base, &min) && parse_number(b->value, b->base, &max) && min > max;
+}
+
+static bool same_sets(const struct effective_set *a, int a_count, const struct effective_set *b, int b_count)
+{
+    bool found = false;
+
+    if (a_count != b_count || a_count == 0)
+        return false;
+
+    for (int i = 0; i < a_count; i++) {
+        found = false;
+        for (int j = 0; j < b_count && !found; j++) {
+            found = strcmp(a[i].path, b[j].path) == 0 && strcmp(a[i].file, b[j].file) == 0
+                && strcasecmp(a[i].value, b[j].value) == 0;
+        }
+        if (!found)
+            return false;
+    }
+
+    return true;
+}
+
+static bool share_node(const struct effective_set *a, int a_count, const struct effective_set *b, int b_count)
+{
+    for (int i = 0; i < a_count; i++) {
+        for (int j = 0; j < b_count; j++) {
+            if (strcmp(a[i].path, b[j].path) == 0 && strcmp(a[i].file, b[j].file) == 0)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+// Warn about the sets of @scene that write a default or contradict each other
+static void analyze_scene(const char *config, const struct mode *mode, const struct scene *scene
+    , const struct effective_set *sets, int count)
+{
+    const struct verify_node *node = NULL;
+    const char *path = NULL;
+    struct file *file = NULL;
+    char def_value[LEN_VALUE_MAX] = {'\0'};
+    int scene_id = 0;
+    int subtype = 0;
+
+    if (scene_name_to_id_subtype(scene->name, &scene_id, &subtype) == 0)
+        warn(config, mode->name, scene->name, "no_id", "not in the scene id file, it can't be requested");
+
+    for (int i = 0; i < scene->count; i++) {
+        file = find_resource(scene_set(scene, i), &path);
+        if (file != NULL && strcmp(path, "subsys") == 0
+            && strcasecmp(scene_set(scene, i)->value, file->value.def_value) == 0)
+            warn(config, mode->name, scene->name, "noop", "subsys %s set to its default %s"
+                , scene_set(scene, i)->file, scene_set(scene, i)->value);
+    }
+
+    for (int i = 0; i < count; i++) {
+        node = find_node(sets[i].path, sets[i].file);
+        // A conf restates the defaults of its inodes on purpose, only direct sets count
+        if (node != NULL && node->restore && node->def_given && sets[i].subsys == NULL) {
+            snprintf(def_value, sizeof(def_value), "%s", node->def_value);
+            if (value_matches(sets[i].value, def_value))
+                warn(config, mode->name, scene->name, "noop", "%s set to its default %s"
+                    , node->path, sets[i].value);
+        }
+
+        for (int j = 0; j < count; j++) {
+            if (min_above_max(&sets[i], &sets[j]))
+                warn(config, mode->name, scene->name, "min_max", "%s/%s %s above %s %s"
+                    , sets[i].path, sets[i].file, sets[i].value, sets[j].file, sets[j].value);
+        }
+    }
+}
+
+// Warn about the scenes of @mode that contradict or duplicate each other
+static void analyze_scene_pairs(const char *config, const struct mode *mode)
+{
+    static struct effective_set a[NUM_FILE_MAX * NUM_FILE_MAX];
+    static struct effective_set b[NUM_FILE_MAX * NUM_FILE_MAX];
+    const struct scene *scene = NULL;
+    const struct scene *other = NULL;
+    char names[LEN_VFS_PATH_MAX] = {'\0'};
+    bool duplicated = false;
+    int a_count = 0;
+    int b_count = 0;
+    int len = 0;
+
+    for (int s = 0; s < mode->count; s++) {
+        scene = &(mode->scenes[s]);
+        a_count = expand_sets(scene, a, NUM_FILE_MAX * NUM_FILE_MAX);
+        duplicated = false;
+        names[0] = '\0';
+        len = 0;
+        for (int o = 0; o < mode->count; o++) {
+            if (o == s)
+                continue;
+
+            other = &(mode->scenes[o]);
+            b_count = expand_sets(other, b, NUM_FILE_MAX * NUM_FILE_MAX);
+            // A group of duplicates is reported once, at its first scene
+            if (same_sets(a, a_count, b, b_count)) {
+                if (o < s)
+                    duplicated = true;
+                else if (!duplicated)
+                    len += snprintf(names + len, sizeof(names) - len, "%s%s"
+                        , (len > 0)? ", ": "", other->name);
+                if (len >= (int)sizeof(names))
+                    len = sizeof(names) - 1;
+            }
+
+            for (int i = 0; i < a_count; i++) {
+                for (int j = 0; j < b_count; j++) {
+                    if (min_above_max(&a[i], &b[j]))
+                        warn(config, mode->name, scene->name, "conflict", "%s/%s %s above %s %s of %s"
+                            , a[i].path, a[i].file, a[i].value, b[j].file, b[j].value, other->name);
+                }
+            }
+        }
+        if (!duplicated && len > 0)
+            warn(config, mode->name, scene->name, "duplicate", "same sets as %s", names);
+    }
+}
+
+static void print_scene_cost(const char *config, const struct scene_cost *cost)
+{
+    static struct effective_set sets[NUM_FILE_MAX * NUM_FILE_MAX];
+    static struct effective_set others[NUM_FILE_MAX * NUM_FILE_MAX];
+    const struct mode *mode = cost->mode;
+    const struct scene *other = NULL;
+    int count = expand_sets(cost->scene, sets, NUM_FILE_MAX * NUM_FILE_MAX);
+    int other_count = 0;
+    bool first = true;
+
+    if (!quiet)
+        printf("COST %s/%s/%s: %d sets, %d nodes, enter %llu writes %llu syscalls"
+            ", exit %llu writes %llu syscalls\n", config, mode->name, cost->scene->name
+            , cost->scene->count, count
+            , (unsigned long long)cost->enter.writes, (unsigned long long)syscalls(&cost->enter)
+            , (unsigned long long)cost->exit.writes, (unsigned long long)syscalls(&cost->exit));
+    if (scene_out == NULL)
+        return;
+
+    fprintf(scene_out, "%s\n    {\"config\": \"%s\", \"mode\": \"%s\", \"scene\": \"%s\""
+        ", \"sets\": %d, \"nodes\": %d, \"enter\": {\"writes\": %llu, \"syscalls\": %llu}"
+        ", \"exit\": {\"writes\": %llu, \"syscalls\": %llu}, \"overlaps\": ["
+        , first_scene? "": ",", config, mode->name, cost->scene->name, cost->scene->count, count
+        , (unsigned long long)cost->enter.writes, (unsigned long long)syscalls(&cost->enter)
+        , (unsigned long long)cost->exit.writes, (unsigned long long)syscalls(&cost->exit));
+    for (int o = 0; o < mode->count; o++) {
+        other = &(mode->scenes[o]);
+        if (other == cost->scene)
+            continue;
+
+        other_count = expand_sets(other, others, NUM_FILE_MAX * NUM_FILE_MAX);
+        if (share_node(sets, count, others, other_count)) {
+            fprintf(scene_out, "%s\"%s\"", first? "": ", ", other->name);
+            first = false;
+        }
+    }
+    fprintf(scene_out, "]}");
+    first_scene = false;
+}
+
+// Warn about the resources, subsys confs and inodes no scene of any mode uses
+static void analyze_unused(const char *config)
+{
+    struct path_file *path_file = NULL;
+    struct subsys *subsys = NULL;
+    struct config *conf = NULL;
+    struct file *file = NULL;
+    const struct scene *scene = NULL;
+    const char *path = NULL;
+    bool used = false;
+
+    for (int i = 0; i < resources.count; i++) {
+        path_file = &(resources.path_files[i]);
+        for (int j = 0; j < path_file->count; j++) {
+            used = false;
+            for (int m = 0; m < power.count && !used; m++) {
+                for (int s = 0; s < power.modes[m].count && !used; s++) {
+                    scene = &(power.modes[m].scenes[s]);
+                    for (int k = 0; k < scene->count && !used; k++)
+                        used = find_resource(scene_set(scene, k), &path) == &(path_file->files[j]);
+                }
+            }
+            if (!used)
+                warn(config, "-", "-", "unused", "resource %s/%s", path_file->path
+                    , path_file->files[j].name);
+        }
+    }
+
+    for (int g = 0; g < resources.subsys_count; g++) {
+        subsys = &(resources.subsystems[g]);
+        for (int c = 0; c < subsys->config_count; c++) {
+            conf = &(subsys->configs[c]);
+            used = false;
+            for (int m = 0; m < power.count && !used; m++) {
+                for (int s = 0; s < power.modes[m].count && !used; s++) {
+                    scene = &(power.modes[m].scenes[s]);
+                    for (int k = 0; k < scene->count && !used; k++) {
+                        file = find_resource(scene_set(scene, k), &path);
+                        used = file != NULL && strcmp(path, "subsys") == 0
+                            && strcmp(file->name, subsys->name) == 0
+                            && find_config(subsys, scene_set(scene, k)->value) == conf;
+                    }
+                }
+            }
+            // The default conf is applied whenever the subsys is released
+            file = NULL;
+            for (int i = 0; i < resources.count && file == NULL; i++) {
+                if (strcmp(resources.path_files[i].path, "subsys") != 0)
+                    continue;
+                for (int j = 0; j < resources.path_files[i].count; j++) {
+                    if (strcmp(resources.path_files[i].files[j].name, subsys->name) == 0)
+                        file = &(resources.path_files[i].files[j]);
+                }
+            }
+            if (!used && (file == NULL || find_config(subsys, file->value.def_value) != conf))
+                warn(config, "-", "-", "unused", "conf %s of subsys %s", conf->name, subsys->name);
+        }
+
+        for (int n = 0; n < subsys->inode_count; n++) {
+            used = false;
+            for (int c = 0; c < subsys->config_count && !used; c++) {
+                conf = &(subsys->configs[c]);
+                for (int k = 0; k < conf->count && !used; k++)
+                    used = strcmp(conf->sets[k].path, subsys->inodes[n].path) == 0
+                        && strcmp(conf->sets[k].file, subsys->inodes[n].file) == 0;
+            }
+            if (!used)
+                warn(config, "-", "-", "unused", "inode %s/%s of subsys %s, no conf sets it"
+                    , subsys->inodes[n].path, subsys->inodes[n].file, subsys->name);
+        }
+    }
+}
+
+static void analyze_config(const char *config)
+{
+    static struct effective_set sets[NUM_FILE_MAX * NUM_FILE_MAX];
+    const struct mode *mode = NULL;
+    int count = 0;
+
+    for (int m = 0; m < power.count; m++) {
+        mode = &(power.modes[m]);
+        for (int s = 0; s < mode->count; s++) {
+            count = expand_sets(&(mode->scenes[s]), sets, NUM_FILE_MAX * NUM_FILE_MAX);
+            analyze_scene(config, mode, &(mode->scenes[s]), sets, count);
+        }
+        analyze_scene_pairs(config, mode);
+    }
+    analyze_unused(config);
+
+    for (int i = 0; i < cost_count; i++)
+        print_scene_cost(config, &costs[i]);
+}
+
+// Enter and leave @scene, returns the number of failed checks
+static int verify_scene(FILE *out, const char *config, const struct scene *scene
+    , int scene_id, int subtype)
+{
+    struct scene_cost *cost = NULL;
+    char value[LEN_VALUE_MAX] = {'\0'};
+    char error[LEN_VFS_PATH_MAX] = {'\0'};
+    int failures = failures_total;
+
+    if (build_checks(scene, error, sizeof(error)) != 0) {
+        report_failure(out, config, current_mode->name, scene->name, "config", error, NULL, NULL);
+        return 1;
+    }
+
+    if (cost_count < NUM_MODE_MAX * NUM_SCENE_MAX) {
+        cost = &costs[cost_count++];
+        cost->mode = current_mode;
+        cost->scene = scene;
+    }
+
+    cost_begin(cost != NULL? &cost->enter: NULL);
+    boost(scene_id, subtype, 1, 0);
+    cost_end(cost != NULL? &cost->enter: NULL);
+    for (int i = 0; i < check_count; i++) {
+        checks_total++;
+        read_node(checks[i].path, checks[i].file, value, sizeof(value));
+        if (!value_matches(checks[i].value, value))
+            report_failure(out, config, current_mode->name, scene->name, "enter"
+                , checks[i].path, checks[i].value, value);
+    }
+
+    cost_begin(cost != NULL? &cost->exit: NULL);
+    boost(scene_id, subtype, 0, 0);
+    cost_end(cost != NULL? &cost->exit: NULL);
+    for (int i = 0; i < check_count; i++) {
+        if (checks[i].file == NULL || checks[i].file->set != devfreq_ddr_set)
+            continue;
+
+        // The governor drops the request with "0 <freq>"
+        checks_total++;
+        checks[i].value[0] = '0';
+        read_node(checks[i].path, checks[i].file, value, sizeof(value));
+        if (!value_matches(checks[i].value, value))
+            report_failure(out, config, current_mode->name, scene->name, "exit"
+                , checks[i].path, checks[i].value, value);
+    }
+    for (int i = 0; i < node_count; i++) {
+        if (!nodes[i].restore)
+            continue;
+
+        checks_total++;
+        read_node(nodes[i].path, nodes[i].file, value, sizeof(value));
+        if (nodes[i].file != NULL && nodes[i].file->set == common_set_for_release_when_close) {
+            if (strcmp(value, VALUE_RELEASED) != 0)
+                report_failure(out, config, current_mode->name, scene->name, "exit"
+                    , nodes[i].path, VALUE_RELEASED, value);
+        } else if (!value_matches(nodes[i].def_value, value)
+            && (nodes[i].table_value[0] == '\0' || !value_matches(nodes[i].table_value, value))) {
+            report_failure(out, config, current_mode->name, scene->name, "exit"
+                , nodes[i].path, nodes[i].def_value, value);
+        }
+    }
+
+    return failures_total - failures;
+}
+
+// The values every node holds now, in the order of nodes[]
+static void save_state(char (*state)[LEN_VALUE_MAX])
+{
+    for (int i = 0; i < node_count; i++)
+        read_node(nodes[i].path, nodes[i].file, state[i], LEN_VALUE_MAX);
+}
+
+// Check every node holds its value of @state, returns the number of failed checks
+static int check_state(FILE *out, const char *config, const char *scene, const char *phase
+    , char (*state)[LEN_VALUE_MAX])
+{
+    char value[LEN_VALUE_MAX] = {'\0'};
+    int failures = failures_total;
+
+    for (int i = 0; i < node_count; i++) {
+        checks_total++;
+        read_node(nodes[i].path, nodes[i].file, value, sizeof(value));
+        if (!value_matches(state[i], value))
+            report_failure(out, config, current_mode->name, scene, phase, nodes[i].path, state[i], value);
+    }
+
+    return failures_total - failures;
+}
+
+static void write_pressure(const char *path, uint64_t some_us, uint64_t full_us)
+{
+    char buf[LEN_VFS_PATH_MAX] = {'\0'};
+
+    snprintf(buf, sizeof(buf), "some avg10=0.00 avg60=0.00 avg300=0.00 total=%llu\n"
+        "full avg10=0.00 avg60=0.00 avg300=0.00 total=%llu\n"
+        , (unsigned long long)some_us, (unsigned long long)full_us);
+    fakefs_write(path, buf);
+}
+
+// Let @ms pass with the stall totals and direct reclaims so far, then run a pass of the PSI monitor
+static void psi_pass(unsigned int fired, int ms)
+{
+    char buf[LEN_VFS_PATH_MAX] = {'\0'};
+
+    write_pressure(PATH_PSI_CPU, psi_cpu_stall_us, 0);
+    write_pressure(PATH_PSI_MEMORY, psi_mem_stall_us[0], psi_mem_stall_us[1]);
+    snprintf(buf, sizeof(buf), "allocstall_dma 0\nallocstall_normal %llu\nallocstall_movable 0\n"
+        , (unsigned long long)psi_allocstall);
+    fakefs_write(PATH_VMSTAT, buf);
+    clock_advance((int64_t)ms * MS_TO_NS);
+    psi_monitor_step(fired);
+}
+
+// The first scene of the default mode with an escalate attribute, NULL if there is none
+static const struct scene *find_escalating(void)
+{
+    int scene_id = 0;
+    int subtype = 0;
+
+    for (int s = 0; s < default_mode->count; s++) {
+        const struct scene *scene = &(default_mode->scenes[s]);
+
+        if (scene->enable == 1 && scene->escalate[0] != '\0'
+            && scene_name_to_id_subtype(scene->name, &scene_id, &subtype) != 0
+            && scene_name_to_id_subtype(scene->escalate, &scene_id, &subtype) != 0)
+            return scene;
+    }
+
+    return NULL;
+}
+
+/*
+ * Drive the PSI monitor through CPU stalls while @source is entered:
+ * the trigger enters the scene it escalates to, a stall rate at the
+ * PSI_RELAX_PCT threshold keeps it, one just under drops back, and so
+ * does exiting @source. An escalation cleared by a mode switch and then
+ * requested by hand is left alone. Returns the number of failed checks.
+ */
+static int verify_psi_cpu(FILE *out, const char *config, const struct scene *source)
+{
+    // The trigger of the unprivileged window the monitor falls back to
+    int64_t stall_us = (int64_t)PSI_CPU_STALL_US_DEFAULT * PSI_WINDOW_UNPRIV_US / PSI_CPU_WINDOW_US_DEFAULT;
+    uint64_t low_us = (uint64_t)PSI_CHECK_MS * 1000 * stall_us * PSI_RELAX_PCT / (100 * PSI_WINDOW_UNPRIV_US);
+    const char *name = source->name;
+    int source_id = 0;
+    int source_subtype = 0;
+    int target_id = 0;
+    int target_subtype = 0;
+    int failures = failures_total;
+
+    scene_name_to_id_subtype(source->name, &source_id, &source_subtype);
+    scene_name_to_id_subtype(source->escalate, &target_id, &target_subtype);
+
+    save_state(psi_states[PSI_STATE_IDLE]);
+    boost(source_id, source_subtype, 1, 0);
+    save_state(psi_states[PSI_STATE_SOURCE]);
+    boost(target_id, target_subtype, 1, 0);
+    save_state(psi_states[PSI_STATE_ESCALATED]);
+    boost(target_id, target_subtype, 0, 0);
+    boost(source_id, source_subtype, 0, 0);
+
+    boost(source_id, source_subtype, 1, 0);
+    psi_pass(1u << PSI_TRIGGER_CPU, 0);
+    check_state(out, config, name, "psi escalate", psi_states[PSI_STATE_ESCALATED]);
+    psi_cpu_stall_us += low_us;
+    psi_pass(0, PSI_CHECK_MS);
+    check_state(out, config, name, "psi hold", psi_states[PSI_STATE_ESCALATED]);
+    psi_cpu_stall_us += low_us - 1;
+    psi_pass(0, PSI_CHECK_MS);
+    check_state(out, config, name, "psi relax", psi_states[PSI_STATE_SOURCE]);
+
+    psi_pass(1u << PSI_TRIGGER_CPU, PSI_CHECK_MS);
+    boost(source_id, source_subtype, 0, 0);
+    psi_cpu_stall_us += low_us;
+    psi_pass(0, PSI_CHECK_MS);
+    check_state(out, config, name, "psi source exit", psi_states[PSI_STATE_IDLE]);
+
+    boost(source_id, source_subtype, 1, 0);
+    psi_pass(1u << PSI_TRIGGER_CPU, PSI_CHECK_MS);
+    clear_requests_for_all_file();
+    boost(target_id, target_subtype, 1, 0);
+    save_state(psi_states[PSI_STATE_CLEARED]);
+    psi_pass(0, PSI_CHECK_MS);
+    check_state(out, config, name, "psi cleared", psi_states[PSI_STATE_CLEARED]);
+    boost(target_id, target_subtype, 0, 0);
+    boost(source_id, source_subtype, 0, 0);
+    clear_requests_for_all_file();
+
+    return failures_total - failures;
+}
+
+// Whether the default mode has the scene @name and it can be requested
+static bool has_scene(const char *name)
+{
+    int scene_id = 0;
+    int subtype = 0;
+
+    if (scene_name_to_id_subtype(name, &scene_id, &subtype) == 0)
+        return false;
+
+    for (int s = 0; s < default_mode->count; s++) {
+        if (default_mode->scenes[s].enable == 1 && strcmp(default_mode->scenes[s].name, name) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+// Enter or exit the scenes psi_monitor.c enters at memory @level, on top of those below
+static void boost_mem_level(int level, int enable)
+{
+    int scene_id = 0;
+    int subtype = 0;
+
+    for (int i = 0; i < 2 && psi_mem_level_scenes[level][i] != NULL; i++) {
+        if (scene_name_to_id_subtype(psi_mem_level_scenes[level][i], &scene_id, &subtype) != 0)
+            boost(scene_id, subtype, enable, 0);
+    }
+}
+
+// Run @count passes a PSI_MEM_CHECK_MS apart without memory stall
+static void psi_calm(int count)
+{
+    for (int i = 0; i < count; i++)
+        psi_pass(0, PSI_MEM_CHECK_MS);
+}
+
+/*
+ * Drive the memory level of the PSI monitor: the some trigger enters
+ * vm_fault_around, a direct reclaim the gts_memory scenes as well. A
+ * level is held while its stall rate is at the PSI_RELAX_PCT threshold
+ * and drops one step after PSI_MEM_HOLD_MS under it. A mode switch
+ * keeps the monitor off the requests made since. Returns the number of
+ * failed checks.
+ */
+static int verify_psi_mem(FILE *out, const char *config)
+{
+    uint64_t full_us = (uint64_t)PSI_MEM_CHECK_MS * 1000 * PSI_MEM_FULL_US_DEFAULT * PSI_RELAX_PCT
+        / (100 * PSI_MEM_WINDOW_US);
+    // The calm passes dropping a level: the first one starts the hold
+    int hold = PSI_MEM_HOLD_MS / PSI_MEM_CHECK_MS + 1;
+    const char *name = psi_mem_level_scenes[PSI_MEM_LEVEL_SOME][0];
+    int failures = failures_total;
+
+    save_state(psi_states[PSI_STATE_IDLE]);
+    boost_mem_level(PSI_MEM_LEVEL_SOME, 1);
+    save_state(psi_states[PSI_STATE_MEM_SOME]);
+    boost_mem_level(PSI_MEM_LEVEL_FULL, 1);
+    save_state(psi_states[PSI_STATE_MEM_FULL]);
+    boost_mem_level(PSI_MEM_LEVEL_FULL, 0);
+    boost_mem_level(PSI_MEM_LEVEL_SOME, 0);
+
+    psi_pass(1u << PSI_TRIGGER_MEM_SOME, PSI_MEM_CHECK_MS);
+    check_state(out, config, name, "psi mem some", psi_states[PSI_STATE_MEM_SOME]);
+    psi_allocstall++;
+    psi_pass(0, PSI_MEM_CHECK_MS);
+    check_state(out, config, name, "psi mem reclaim", psi_states[PSI_STATE_MEM_FULL]);
+
+    psi_calm(hold - 2);
+    psi_mem_stall_us[1] += full_us;
+    psi_pass(0, PSI_MEM_CHECK_MS);
+    psi_calm(hold - 1);
+    check_state(out, config, name, "psi mem hold", psi_states[PSI_STATE_MEM_FULL]);
+    psi_calm(1);
+    check_state(out, config, name, "psi mem drop", psi_states[PSI_STATE_MEM_SOME]);
+    psi_calm(hold);
+    check_state(out, config, name, "psi mem idle", psi_states[PSI_STATE_IDLE]);
+
+    psi_pass(1u << PSI_TRIGGER_MEM_FULL, PSI_MEM_CHECK_MS);
+    check_state(out, config, name, "psi mem full", psi_states[PSI_STATE_MEM_FULL]);
+    clear_requests_for_all_file();
+    boost_mem_level(PSI_MEM_LEVEL_SOME, 1);
+    boost_mem_level(PSI_MEM_LEVEL_FULL, 1);
+    psi_calm(2 * hold);
+    check_state(out, config, name, "psi mem cleared", psi_states[PSI_STATE_MEM_FULL]);
+    boost_mem_level(PSI_MEM_LEVEL_FULL, 0);
+    boost_mem_level(PSI_MEM_LEVEL_SOME, 0);
+    clear_requests_for_all_file();
+
+    return failures_total - failures;
+}
+
+/*
+ * Start the PSI monitor on fake pressure files and run the PSI cases of
+ * the config, returns the number of failed checks or -1 if the config
+ * has none. The kernel is made to refuse the CPU trigger's window once,
+ * as Linux 6.5 does for an unprivileged one, and the trigger must then
+ * be registered in PSI_WINDOW_UNPRIV_US.
+ */
+static int verify_psi(FILE *out, const char *config)
+{
+    const struct scene *source = find_escalating();
+    char expected[LEN_VALUE_MAX] = {'\0'};
+    char value[LEN_VALUE_MAX] = {'\0'};
+    bool mem_scenes = has_scene(psi_mem_level_scenes[PSI_MEM_LEVEL_SOME][0]);
+    int failures = failures_total;
+
+    if (source == NULL && !mem_scenes)
+        return -1;
+
+    psi_cpu_stall_us = 0;
+    memset(psi_mem_stall_us, 0, sizeof(psi_mem_stall_us));
+    psi_allocstall = 0;
+    fakefs_write(PATH_PSI_CPU, "");
+    fakefs_write(PATH_PSI_MEMORY, "");
+    fakefs_write(PATH_VMSTAT, "");
+    vfs_add_fault(PATH_PSI_CPU, VFS_OP_WRITE, EINVAL, 0, 1);
+    power_impl.init_done = true;
+    if (psi_monitor_start(&power_impl) != 0) {
+        report_failure(out, config, current_mode->name, "psi", "start", PATH_PSI_CPU, NULL, NULL);
+        vfs_clear_faults();
+        power_impl.init_done = false;
+        return 1;
+    }
+
+    snprintf(expected, sizeof(expected), "some %lld %d"
+        , (long long)PSI_CPU_STALL_US_DEFAULT * PSI_WINDOW_UNPRIV_US / PSI_CPU_WINDOW_US_DEFAULT
+        , PSI_WINDOW_UNPRIV_US);
+    checks_total++;
+    read_node(PATH_PSI_CPU, NULL, value, sizeof(value));
+    if (!value_matches(expected, value))
+        report_failure(out, config, current_mode->name, "psi", "fallback", PATH_PSI_CPU, expected, value);
+
+    if (source != NULL)
+        verify_psi_cpu(out, config, source);
+    if (mem_scenes)
+        verify_psi_mem(out, config);
+
+    psi_monitor_stop();
+    vfs_clear_faults();
+    power_impl.init_done = false;
+    clear_requests_for_all_file();
+
+    return failures_total - failures;
+}
+
+static void read_ddr_max_freq(void)
+{
+    char table[LEN_VALUE_MAX] = {'\0'};
+    char *saveptr = NULL;
+    char *ptr = NULL;
+
+    snprintf(ddr_max_freq, sizeof(ddr_max_freq), "max");
+    if (fakefs_read(PATH_DEVFREQ_DDR_FREQ_TABLE, table, sizeof(table)) < 0)
+        return;
+
+    for (ptr = strtok_r(table, " ", &saveptr); ptr != NULL; ptr = strtok_r(NULL, " ", &saveptr))
+        snprintf(ddr_max_freq, sizeof(ddr_max_freq), "%s", ptr);
+}
+
+static int verify_config(FILE *out, FILE *summary, const char *config_dir)
+{
+    char root[LEN_VFS_PATH_MAX] = {'\0'};
+    char name[LEN_VFS_PATH_MAX] = {'\0'};
+    const char *config = NULL;
+    struct scene *scene = NULL;
+    int scene_id = 0;
+    int subtype = 0;
+    int scenes = 0;
+    int failed = 0;
+    int psi_failures = 0;
+    int checks_before = checks_total;
+    int64_t start = stats_now_ns();
+
+    snprintf(name, sizeof(name), "%s", config_dir);
+    config = basename(name);
+
+    if (fakefs_create(config_dir, root, sizeof(root)) != 0) {
+        fprintf(stderr, "Create fake node tree for %s fail\n", config_dir);
+        return -1;
+    }
+
+    if (analyze)
+        check_capacity(config);
+
+    clock_use_virtual(0);
+    if (config_read() == 0) {
+        fprintf(stderr, "Read config %s fail\n", config_dir);
+        fakefs_destroy(root);
+        return -1;
+    }
+    start_thread_for_timing_request(&power_impl);
+    cost_count = 0;
+    read_ddr_max_freq();
+    snapshot_nodes();
+
+    // The HAL reads the node defaults on the first boost, keep that out of the costs
+    for (int s = 0; analyze && s < default_mode->count; s++) {
+        if (scene_name_to_id_subtype(default_mode->scenes[s].name, &scene_id, &subtype) != 0) {
+            boost(scene_id, subtype, 1, 0);
+            boost(scene_id, subtype, 0, 0);
+            break;
+        }
+    }
+
+    for (int m = 0; m < power.count; m++) {
+        current_mode = &(power.modes[m]);
+        for (int s = 0; s < current_mode->count; s++) {
+            scene = &(current_mode->scenes[s]);
+            // Scenes without an id can't be requested, disabled ones are never applied
+            if (scene->enable != 1 || scene_name_to_id_subtype(scene->name, &scene_id, &subtype) == 0)
+                continue;
+
+            scenes++;
+            if (verify_scene(out, config, scene, scene_id, subtype) != 0)
+                failed++;
+            else if (!quiet)
+                printf("PASS %s/%s/%s\n", config, current_mode->name, scene->name);
+        }
+        clear_requests_for_all_file();
+    }
+    current_mode = default_mode;
+
+    psi_failures = verify_psi(out, config);
+    if (psi_failures > 0)
+        failed++;
+    else if (psi_failures == 0 && !quiet)
+        printf("PASS %s/%s/psi\n", config, current_mode->name);
+
+    if (analyze)
+        analyze_config(config);
+
+    fprintf(summary, "%s: %d scenes, %d failed, %d checks in %lld us\n", config, scenes, failed
+        , checks_total - checks_before, (long long)((stats_now_ns() - start)/1000));
+
+    clear_requests_for_all_file();
+    fakefs_destroy(root);
+
+    return (failed > 0)? 1: 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-q] [-a] [-o report.json] config_dir...\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *out = NULL;
+    char *scene_json = NULL;
+    char *warning_json = NULL;
+    size_t scene_len = 0;
+    size_t warning_len = 0;
+    int ret = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "qao:h")) != -1) {
+        switch (opt) {
+        case 'q':
+            quiet = true;
+            break;
+        case 'a':
+            analyze = true;
+            break;
+        case 'o':
+            out = fopen(optarg, "w");
+            if (out == NULL) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (out != NULL) {
+        fprintf(out, "{\n  \"failures\": [");
+        if (analyze) {
+            scene_out = open_memstream(&scene_json, &scene_len);
+            warning_out = open_memstream(&warning_json, &warning_len);
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        if (verify_config(out, stdout, argv[i]) != 0)
+            ret = 1;
+    }
+    printf("%d checks, %d failed", checks_total, failures_total);
+    if (analyze)
+        printf(", %d warnings", warnings_total);
+    printf("\n");
+
+    if (out != NULL) {
+        fprintf(out, "\n  ],\n  \"checks\": %d,\n  \"failed\": %d", checks_total, failures_total);
+        if (scene_out != NULL && warning_out != NULL) {
+            fclose(scene_out);
+            fclose(warning_out);
+            fprintf(out, ",\n  \"scenes\": [%s\n  ],\n  \"warnings\": [%s\n  ]"
+                , scene_json, warning_json);
+            free(scene_json);
+            free(warning_json);
+        }
+        fprintf(out, "\n}\n");
+        fclose(out);
+    }
+
+    return ret;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#define NUM_HOST_PROPERTY_MAX             64
+
+struct host_property {
+    char key[PROPERTY_KEY_MAX * 2];
+    char value[PROPERTY_VALUE_MAX];
+};
+
+static struct host_property properties[NUM_HOST_PROPERTY_MAX];
+static int property_count = 0;
+static pthread_mutex_t property_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int host_log_priority = ANDROID_LOG_ERROR;
+
+void host_log_print(int prio, const char *tag, const char *fmt, ...)
+{
+    static const char prio_chars[] = "??VDIWEF";
+    va_list ap;
+
+    fprintf(stderr, "%c/%s: ", prio_chars[prio & 7], (tag != NULL)? tag: "");
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+int property_get(const char *key, char *value, const char *default_value)
+{
+    int len = 0;
+
+    value[0] = '\0';
+    pthread_mutex_lock(&property_lock);
+    for (int i = 0; i < property_count; i++) {
+        if (strcmp(properties[i].key, key) == 0) {
+            strcpy(value, properties[i].value);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&property_lock);
+
+    if (value[0] == '\0' && default_value != NULL)
+        snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+
+    len = strlen(value);
+    return len;
+}
+
+int property_set(const char *key, const char *value)
+{
+    int i = 0;
+
+    pthread_mutex_lock(&property_lock);
+    for (; i < property_count; i++) {
+        if (strcmp(properties[i].key, key) == 0)
+            break;
+    }
+    if (i == property_count) {
+        if (property_count >= NUM_HOST_PROPERTY_MAX) {
+            pthread_mutex_unlock(&property_lock);
+            return -1;
+        }
+        property_count++;
+        snprintf(properties[i].key, sizeof(properties[i].key), "%s", key);
+    }
+    snprintf(properties[i].value, sizeof(properties[i].value), "%s", value);
+    pthread_mutex_unlock(&property_lock);
+
+    return 0;
+}
+
+int32_t property_get_int32(const char *key, int32_t default_value)
+{
+    char value[PROPERTY_VALUE_MAX];
+    char *end = NULL;
+    long result = 0;
+
+    if (property_get(key, value, NULL) == 0)
+        return default_value;
+
+    result = strtol(value, &end, 0);
+    if (end == value)
+        return default_value;
+
+    return (int32_t)result;
+}
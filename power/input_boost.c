@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <linux/input.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "clock.h"
+#include "hint_id.h"
+#include "input_boost.h"
+#include "thread_sched.h"
+#include "vfs.h"
+
+#define NUM_INPUT_EVENT_READ              64
+#define BITS_PER_LONG                     (8 * sizeof(unsigned long))
+#define BITS_LONGS(n)                     (((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define TEST_BIT(bits, n)                 (((bits)[(n) / BITS_PER_LONG] >> ((n) % BITS_PER_LONG)) & 1)
+
+static const char *type_names[INPUT_DEVICE_MAX] = {
+    [INPUT_DEVICE_TOUCH] = "touch",
+    [INPUT_DEVICE_KEYS] = "keys",
+};
+
+/**
+ * struct input_device - an evdev device the power_input thread reads
+ * @fd: the device, closed by input_boost_stop()
+ * @type: INPUT_DEVICE_*
+ */
+struct input_device {
+    int fd;
+    int type;
+};
+
+static struct input_device devices[NUM_INPUT_DEVICE_MAX];
+static int device_count = 0;
+static struct sprd_power_module *input_pm = NULL;
+static pthread_t input_thread;
+static int stop_fd = -1;
+static bool running = false;
+
+static struct input_boost_stats input_stats[INPUT_DEVICE_MAX];
+// When the scene of each type was last entered on input, in clock_monotonic_ns(), 0 if never
+static int64_t boost_ns[INPUT_DEVICE_MAX];
+
+// A touchscreen reports multi-touch positions and is a direct input device
+static bool is_touchscreen(int fd)
+{
+    unsigned long props[BITS_LONGS(INPUT_PROP_CNT)];
+    unsigned long abs[BITS_LONGS(ABS_CNT)];
+
+    memset(props, 0, sizeof(props));
+    memset(abs, 0, sizeof(abs));
+    if (ioctl(fd, EVIOCGPROP(sizeof(props)), props) < 0
+        || ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs)), abs) < 0)
+        return false;
+
+    return TEST_BIT(props, INPUT_PROP_DIRECT) && TEST_BIT(abs, ABS_MT_POSITION_X);
+}
+
+// Open the touchscreens and gpio-keys under PATH_INPUT_DEVICES
+static void scan_devices(void)
+{
+    char dir_path[LEN_VFS_PATH_MAX];
+    char path[LEN_VFS_PATH_MAX + 16];
+    char name[64];
+    struct dirent *entry = NULL;
+    DIR *dir = NULL;
+    int type = 0;
+    int fd = -1;
+
+    vfs_path(PATH_INPUT_DEVICES, dir_path, sizeof(dir_path));
+    dir = opendir(dir_path);
+    if (dir == NULL) {
+        ALOGE("%s: open %s failed: %s", __func__, dir_path, strerror(errno));
+        return;
+    }
+
+    while ((entry = readdir(dir)) != NULL && device_count < NUM_INPUT_DEVICE_MAX) {
+        if (strncmp(entry->d_name, "event", strlen("event")) != 0)
+            continue;
+
+        if (snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name) >= (int)sizeof(path))
+            continue;
+        fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        memset(name, 0, sizeof(name));
+        if (ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name) < 0)
+            name[0] = '\0';
+        if (strcmp(name, INPUT_GPIO_KEYS_NAME) == 0) {
+            type = INPUT_DEVICE_KEYS;
+        } else if (is_touchscreen(fd)) {
+            type = INPUT_DEVICE_TOUCH;
+        } else {
+            close(fd);
+            continue;
+        }
+
+        ALOGD("Input boost watches %s (%s) as %s", path, name, type_names[type]);
+        devices[device_count].fd = fd;
+        devices[device_count++].type = type;
+    }
+    closedir(dir);
+}
+
+// Enter the scene of @type unless its input boost is still fresh
+static void boost_on_input(int type, int hint, int64_t refresh_ns)
+{
+    int64_t now = clock_monotonic_ns();
+    int64_t last = __atomic_load_n(&boost_ns[type], __ATOMIC_RELAXED);
+
+    if (last != 0 && now - last < refresh_ns)
+        return;
+
+    if (power_input_boost(input_pm, (power_hint_t)hint, BOOST_DURATION_DEFAULT) > 0) {
+        __atomic_store_n(&boost_ns[type], now, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&input_stats[type].boosts, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Read the pending events of @device, return -1 if it is gone
+static int handle_events(const struct input_device *device)
+{
+    struct input_event events[NUM_INPUT_EVENT_READ];
+    bool touched = false;
+    bool woken = false;
+    ssize_t len = 0;
+    int count = 0;
+
+    for (;;) {
+        len = read(device->fd, events, sizeof(events));
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len < 0 && errno == EAGAIN)
+            break;
+        if (len <= 0)
+            return -1;
+
+        count = len / sizeof(events[0]);
+        __atomic_add_fetch(&input_stats[device->type].events, count, __ATOMIC_RELAXED);
+        for (int i = 0; i < count; i++) {
+            if (events[i].type == EV_SYN)
+                continue;
+            if (device->type == INPUT_DEVICE_TOUCH)
+                touched = true;
+            else if (events[i].type == EV_KEY && events[i].value == 1
+                && (events[i].code == KEY_POWER || events[i].code == KEY_WAKEUP
+                    || events[i].code == INPUT_KEY_AI))
+                woken = true;
+        }
+        if ((size_t)len < sizeof(events))
+            break;
+    }
+
+    // Boost once per read, a finger moving reports dozens of events
+    if (touched)
+        boost_on_input(INPUT_DEVICE_TOUCH, POWER_HINT_VENDOR_INTERACTION_TOUCH
+            , (int64_t)INPUT_BOOST_REFRESH_MS * 1000000);
+    if (woken)
+        boost_on_input(INPUT_DEVICE_KEYS, POWER_HINT_VENDOR_INTERACTION_WAKEUP, 0);
+
+    return 0;
+}
+
+static void *input_boost_loop(void __unused *args)
+{
+    struct pollfd fds[NUM_INPUT_DEVICE_MAX + 1];
+    int count = 0;
+
+    prctl(PR_SET_NAME, "power_input");
+    thread_sched_apply(THREAD_INPUT);
+    fds[count].fd = stop_fd;
+    fds[count++].events = POLLIN;
+    for (int i = 0; i < device_count; i++) {
+        fds[count].fd = devices[i].fd;
+        fds[count++].events = POLLIN;
+    }
+
+    for (;;) {
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            ALOGE("%s: poll failed: %s", __func__, strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents != 0)
+            break;
+
+        // A device that went away stays open, it is just no longer polled
+        for (int i = 1; i < count; i++) {
+            if (fds[i].revents == 0)
+                continue;
+
+            if (handle_events(&devices[i - 1]) != 0) {
+                ALOGD("Input device %d is gone", devices[i - 1].fd);
+                fds[i].fd = -1;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+int input_boost_init(struct sprd_power_module *pm)
+{
+    if (property_get_int32(POWER_INPUT_BOOST_PROP, 0) == 0)
+        return 0;
+
+    scan_devices();
+    if (device_count == 0) {
+        ALOGD("Input boost: no touchscreen or %s", INPUT_GPIO_KEYS_NAME);
+        return 0;
+    }
+
+    return input_boost_start(pm);
+}
+
+int input_boost_add_fd(int fd, int type)
+{
+    if (running || fd < 0 || type < 0 || type >= INPUT_DEVICE_MAX)
+        return -EINVAL;
+    if (device_count >= NUM_INPUT_DEVICE_MAX)
+        return -ENOSPC;
+
+    devices[device_count].fd = fd;
+    devices[device_count++].type = type;
+
+    return 0;
+}
+
+int input_boost_start(struct sprd_power_module *pm)
+{
+    if (running)
+        return 0;
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        ALOGE("%s: eventfd failed: %s", __func__, strerror(errno));
+        return -errno;
+    }
+
+    input_pm = pm;
+    memset(boost_ns, 0, sizeof(boost_ns));
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&input_thread, NULL, &input_boost_loop, NULL) != 0) {
+        ALOGE("%s: Thread create fail", __func__);
+        __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+        close(stop_fd);
+        stop_fd = -1;
+        return -EAGAIN;
+    }
+
+    ALOGD("Input boost watches %d devices", device_count);
+    return 0;
+}
+
+void input_boost_stop(void)
+{
+    uint64_t one = 1;
+
+    if (!running)
+        return;
+
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one))
+        ALOGE("%s: stop failed: %s", __func__, strerror(errno));
+    pthread_join(input_thread, NULL);
+    __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+
+    close(stop_fd);
+    stop_fd = -1;
+    for (int i = 0; i < device_count; i++)
+        close(devices[i].fd);
+    device_count = 0;
+}
+
+/**
+ * input_boost_dedup - whether the framework hint @hint is already covered
+ *
+ * A touch or wakeup hint that asks for no longer than the input boost
+ * and comes within INPUT_BOOST_DEDUP_MS of it is the same event seen
+ * again after the input pipeline, entering the scene again would only
+ * take the lock and rewrite the nodes. POWER_HINT_INTERACTION enters
+ * interaction_other, not the scene the input boost did, and is kept.
+ */
+bool input_boost_dedup(power_hint_t hint, const int *data)
+{
+    int type = 0;
+    int64_t last = 0;
+    int64_t now = 0;
+
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+        return false;
+
+    switch ((int)hint) {
+        case POWER_HINT_VENDOR_INTERACTION_TOUCH:
+            type = INPUT_DEVICE_TOUCH;
+            break;
+        case POWER_HINT_VENDOR_INTERACTION_WAKEUP:
+            type = INPUT_DEVICE_KEYS;
+            break;
+        default:
+            return false;
+    }
+
+    if (data != NULL && (*data & 0xffff) > BOOST_DURATION_DEFAULT)
+        return false;
+
+    last = __atomic_load_n(&boost_ns[type], __ATOMIC_RELAXED);
+    now = clock_monotonic_ns();
+    if (last == 0 || now - last > (int64_t)INPUT_BOOST_DEDUP_MS * 1000000)
+        return false;
+
+    __atomic_add_fetch(&input_stats[type].deduped, 1, __ATOMIC_RELAXED);
+    hist_add(&input_stats[type].lead, (uint64_t)(now - last) / 1000);
+
+    return true;
+}
+
+const struct input_boost_stats *input_boost_stats_get(int type)
+{
+    if (type < 0 || type >= INPUT_DEVICE_MAX)
+        return NULL;
+
+    return &input_stats[type];
+}
+
+int input_boost_dump(int fd)
+{
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+        return 0;
+
+    dprintf(fd, "Input boost: devices=%d\n", device_count);
+    for (int i = 0; i < INPUT_DEVICE_MAX; i++) {
+        dprintf(fd, "  %-12s events=%llu boosts=%llu deduped=%llu\n", type_names[i]
+            , (unsigned long long)__atomic_load_n(&input_stats[i].events, __ATOMIC_RELAXED)
+            , (unsigned long long)__atomic_load_n(&input_stats[i].boosts, __ATOMIC_RELAXED)
+            , (unsigned long long)__atomic_load_n(&input_stats[i].deduped, __ATOMIC_RELAXED));
+        hist_dump(fd, "lead", &input_stats[i].lead);
+    }
+
+    return 0;
+}
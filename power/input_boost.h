@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_INPUT_BOOST_H
+#define INCLUDE_POWER_INPUT_BOOST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sprd_power.h"
+#include "stats.h"
+
+#define POWER_INPUT_BOOST_PROP            "persist.vendor.power.input_boost"
+#define PATH_INPUT_DEVICES                "/dev/input"
+// The device the power key is on, see keylayout/gpio-keys.kl
+#define INPUT_GPIO_KEYS_NAME              "gpio-keys"
+// The AI button, gpio-keys.kl maps it to POWER too
+#define INPUT_KEY_AI                      213
+
+#define NUM_INPUT_DEVICE_MAX              8
+// A touch keeps its boost alive by re-entering the scene once this much is left
+#define INPUT_BOOST_REFRESH_MS            (BOOST_DURATION_DEFAULT / 2)
+// A framework hint this soon after the input boost for the same event is dropped
+#define INPUT_BOOST_DEDUP_MS              200
+
+enum {
+    INPUT_DEVICE_TOUCH = 0,
+    INPUT_DEVICE_KEYS,
+    INPUT_DEVICE_MAX,
+};
+
+/**
+ * struct input_boost_stats - what the input boost did for one kind of device
+ * @events: input events read
+ * @boosts: scenes entered on input
+ * @deduped: framework hints dropped because the input boost covered them
+ * @lead: how much earlier the input boost was than the dropped hint
+ */
+struct input_boost_stats {
+    uint64_t events;
+    uint64_t boosts;
+    uint64_t deduped;
+    struct hist lead;
+};
+
+/*
+ * With persist.vendor.power.input_boost set, input_boost_init() opens the
+ * touchscreens and the gpio-keys device under /dev/input and starts the
+ * power_input thread reading them. The first event of a touch enters
+ * interaction_touch for BOOST_DURATION_DEFAULT, kept alive while the
+ * touch goes on; a power key press with the screen off enters
+ * interaction_wakeup. Both happen before the framework has dispatched
+ * the event, the touch or wakeup hint it sends then is dropped by
+ * input_boost_dedup() if it comes within INPUT_BOOST_DEDUP_MS. A config
+ * without the scene, e.g. sharkl3 has no interaction_touch, gets no
+ * boost on touch.
+ *
+ * input_boost_add_fd() watches an already open fd as a device of @type
+ * instead, e.g. a uinput device or a pipe of struct input_event on the
+ * host. It must be called before input_boost_start(), which skips the
+ * property and the scan. Times are taken on the request clock, so with
+ * the virtual clock a host tool lets each input boost finish before it
+ * calls clock_advance().
+ */
+int input_boost_init(struct sprd_power_module *pm);
+int input_boost_add_fd(int fd, int type);
+int input_boost_start(struct sprd_power_module *pm);
+void input_boost_stop(void);
+bool input_boost_dedup(power_hint_t hint, const int *data);
+const struct input_boost_stats *input_boost_stats_get(int type);
+int input_boost_dump(int fd);
+
+/*
+ * Enters the scene of @hint for @duration ms on behalf of an input
+ * event, returns 1 if the scene was entered. Defined by sprd_power.c.
+ */
+int power_input_boost(struct sprd_power_module *pm, power_hint_t hint, int duration);
+#endif
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lockstat.h"
+
+static struct lock_profile profile;
+// Shared holders release concurrently, the profile takes this to update
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// The hold of the lock by this thread
+static __thread const char *holder_site = NULL;
+static __thread int64_t holder_since = 0;
+static __thread uint64_t holder_wait_us = 0;
+
+static struct lock_site *find_site(const char *site)
+{
+    for (int i = 0; i < profile.site_count; i++) {
+        if (profile.sites[i].site == site)
+            return &profile.sites[i];
+    }
+
+    if (profile.site_count >= NUM_LOCK_SITE_MAX)
+        return NULL;
+
+    profile.sites[profile.site_count].site = site;
+    return &profile.sites[profile.site_count++];
+}
+
+// Keep @hold_us if it is one of the longest holds
+static void add_holder(uint64_t hold_us)
+{
+    int i = NUM_LOCK_HOLDER_MAX - 1;
+
+    if (hold_us <= profile.longest[i].hold_us)
+        return;
+
+    for (; i > 0 && profile.longest[i - 1].hold_us < hold_us; i--)
+        profile.longest[i] = profile.longest[i - 1];
+
+    profile.longest[i].site = holder_site;
+    profile.longest[i].scene = stats_get_scene();
+    profile.longest[i].ts_ns = holder_since;
+    profile.longest[i].hold_us = hold_us;
+}
+
+/*
+ * The HAL lock. It prefers writers, a mode switch would otherwise wait
+ * for as long as the binder threads keep a boost in flight. No static
+ * initializer sets that, so the first taker initializes it once.
+ */
+static pthread_rwlock_t hal_lock;
+static pthread_once_t hal_lock_once = PTHREAD_ONCE_INIT;
+
+static void hal_lock_init(void)
+{
+    pthread_rwlockattr_t attr;
+
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&hal_lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+}
+
+static void locked(const char *site, int64_t start)
+{
+    holder_since = stats_now_ns();
+    holder_site = site;
+    holder_wait_us = (holder_since - start) / 1000;
+}
+
+void power_lock(const char *site)
+{
+    int64_t start = stats_now_ns();
+
+    pthread_once(&hal_lock_once, hal_lock_init);
+    pthread_rwlock_wrlock(&hal_lock);
+    locked(site, start);
+}
+
+void power_lock_shared(const char *site)
+{
+    int64_t start = stats_now_ns();
+
+    pthread_once(&hal_lock_once, hal_lock_init);
+    pthread_rwlock_rdlock(&hal_lock);
+    locked(site, start);
+}
+
+void power_unlock(void)
+{
+    uint64_t hold_us = (stats_now_ns() - holder_since) / 1000;
+    struct lock_site *site = NULL;
+
+    pthread_mutex_lock(&profile_lock);
+    site = find_site(holder_site);
+    hist_add(&profile.wait, holder_wait_us);
+    hist_add(&profile.hold, hold_us);
+    if (site != NULL) {
+        hist_add(&site->wait, holder_wait_us);
+        hist_add(&site->hold, hold_us);
+    }
+    add_holder(hold_us);
+    pthread_mutex_unlock(&profile_lock);
+    holder_site = NULL;
+
+    pthread_rwlock_unlock(&hal_lock);
+}
+
+void lock_profile_file_wait(uint64_t wait_us)
+{
+    hist_add(&profile.file_wait, wait_us);
+}
+
+const struct lock_profile *lock_profile_get(void)
+{
+    return &profile;
+}
+
+void lock_profile_reset(void)
+{
+    memset(&profile, 0, sizeof(profile));
+}
+
+int lock_profile_dump(int fd)
+{
+    struct lock_holder *holder = NULL;
+
+    dprintf(fd, "Lock profile:\n");
+    hist_dump(fd, "wait", &profile.wait);
+    hist_dump(fd, "hold", &profile.hold);
+    hist_dump(fd, "file_wait", &profile.file_wait);
+    for (int i = 0; i < profile.site_count; i++) {
+        dprintf(fd, "  %s:\n", profile.sites[i].site);
+        hist_dump(fd, "wait", &profile.sites[i].wait);
+        hist_dump(fd, "hold", &profile.sites[i].hold);
+    }
+
+    dprintf(fd, "Longest lock holders:\n");
+    for (int i = 0; i < NUM_LOCK_HOLDER_MAX; i++) {
+        holder = &profile.longest[i];
+        if (holder->hold_us == 0)
+            break;
+
+        dprintf(fd, "  %12.6f %-28s %-24s %lluus\n", holder->ts_ns / 1e9, holder->site
+            , (holder->scene != NULL)? holder->scene: "-", (unsigned long long)holder->hold_us);
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INCLUDE_POWER_LOCKSTAT_H
+#define INCLUDE_POWER_LOCKSTAT_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "stats.h"
+
+#define NUM_LOCK_SITE_MAX                 16
+#define NUM_LOCK_HOLDER_MAX               8
+
+/**
+ * struct lock_site - wait and hold time of the lock taken by one function
+ * @site: the function, points to __func__
+ * @wait: time waited for the lock
+ * @hold: time the lock was held
+ */
+struct lock_site {
+    const char *site;
+    struct hist wait;
+    struct hist hold;
+};
+
+/**
+ * struct lock_holder - one of the longest holds of the lock
+ * @site: the function that held the lock
+ * @scene: the first scene applied while holding it, NULL if none
+ * @ts_ns: monotonic time the lock was taken
+ * @hold_us: how long it was held
+ */
+struct lock_holder {
+    const char *site;
+    const char *scene;
+    int64_t ts_ns;
+    uint64_t hold_us;
+};
+
+/**
+ * struct lock_profile - the profile of the HAL lock
+ * @wait: time waited for the lock by all sites
+ * @hold: time the lock was held by all sites
+ * @file_wait: time waited for the locks of resource files found busy, see lock_files()
+ * @sites: the profile of every function taking the lock
+ * @longest: the longest holds, longest first
+ */
+struct lock_profile {
+    struct hist wait;
+    struct hist hold;
+    struct hist file_wait;
+    int site_count;
+    struct lock_site sites[NUM_LOCK_SITE_MAX];
+    struct lock_holder longest[NUM_LOCK_HOLDER_MAX];
+};
+
+/*
+ * Take and release the HAL lock. Hints that only enter or exit scenes and
+ * request timeouts hold it shared and serialize on the locks of the
+ * resource files they touch; everything changing the mode, the screen
+ * state or more than a scene's files holds it exclusive. Read the
+ * profile with the lock held exclusive or once no one else can take it.
+ */
+void power_lock(const char *site);
+void power_lock_shared(const char *site);
+void power_unlock(void);
+void lock_profile_file_wait(uint64_t wait_us);
+
+const struct lock_profile *lock_profile_get(void);
+void lock_profile_reset(void);
+int lock_profile_dump(int fd);
+#endif
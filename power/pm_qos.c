@@ -16,6 +16,9 @@
 
 #include "utils.h"
 #include "pm_qos.h"
+#include "stats.h"
+#include "trace.h"
+#include "vfs.h"
 
 static int pm_qos_cpuidle_fd = -1;
 
@@ -25,11 +28,19 @@ int pm_qos_cpu_clear(const char *path, struct file *file)
         return 0;
 
     if (pm_qos_cpuidle_fd > 0) {
-        close(pm_qos_cpuidle_fd);
+        vfs_close(pm_qos_cpuidle_fd);
         pm_qos_cpuidle_fd = -1;
+        flight_record(FR_EV_WRITE, __func__, file->id, 0);
+        if (TRACE_ENABLED()) {
+            char buf[128] = {'\0'};
+
+            snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
+            TRACE_COUNTER(buf, "0", 10);
+        }
     }
-    sprd_timer_settime(file->timer_id, 0);
+    req_arm_timer(file, 0);
     memset(&(file->stat), 0, sizeof(struct request_stat));
+    residency_update(file, file->value.def_value, NULL);
 
     return 1;
 }
@@ -37,7 +48,6 @@ int pm_qos_cpu_clear(const char *path, struct file *file)
 int pm_qos_cpu_set(int enable, int duration,const char *path, struct file *file)
 {
     char buf[128] = {'\0'};
-    struct timespec now;
     struct req_item *req_item = NULL;
     long long time_value;
 
@@ -47,57 +57,56 @@ int pm_qos_cpu_set(int enable, int duration,const char *path, struct file *file)
     ENTER("enable:%d, duration: %d, %s/%s: %s", enable, duration, path, file->name
         , file->value.target_value);
 
-    memset(&now, 0, sizeof(now));
     snprintf(buf, sizeof(buf), "%s/%s", path, file->name);
 
     sort_request_for_file(enable, duration, file);
-    if (DEBUG_V) {
-        char time[20] = {'\0'};
-        ALOGD(">>>>>>>>>>>>>>>>>>>>");
-        ALOGD("%s:", buf);
-        for (int i = 0; i < file->stat.count; i++) {
-            sprd_strftime(time, sizeof(time), file->stat.items[i].duration_end_time);
-            ALOGD("  value:%s, times:%d, end_time: %s", file->stat.items[i].value
-                , file->stat.items[i].times, time);
-        }
-        ALOGD("<<<<<<<<<<<<<<<<<<<<");
-    }
+    if (DEBUG_V)
+        req_dump(buf, file);
+    if (defer_request_for_file(path, file))
+        return 1;
 
     if (file->stat.count <= 0) {
-        ALOGD("ALL latency requests has been handled");
+        ALOGD_IF(DEBUG_V, "ALL latency requests has been handled");
         pm_qos_cpu_clear(path, file);
         return 1;
     }
 
     // Set timer if the highest priority request has duration time
-    clock_gettime(CLOCK_MONOTONIC, &now);
     req_item = &(file->stat.items[file->stat.count - 1]);
-    time_value = calc_timespan_ms(now, req_item->duration_end_time);
+    time_value = req_remaining_ms(req_item);
     if (time_value > 0) {
-        sprd_timer_settime(file->timer_id, time_value);
+        req_arm_timer(file, time_value);
     }
 
     // If the highest priority request is the same with
     // current, don't need send the request to driver
-    if(strlen(file->stat.current.value) != 0
+    if(file->stat.current.times != 0
         && file->comp((void *)req_item, (void *)(&(file->stat.current))) == 0)
         return 1;
 
     // Update current request
-    memcpy(&(file->stat.current), req_item, sizeof(struct req_item));
+    req_set_current(file, req_item);
 
     if (pm_qos_cpuidle_fd < 0) {
-        pm_qos_cpuidle_fd = open(buf, O_RDWR);
+        pm_qos_cpuidle_fd = vfs_open(buf, O_RDWR);
         if (pm_qos_cpuidle_fd < 0) {
             ALOGE("open(%s) failed:%s", buf, strerror(errno));
             return 0;
         }
     }
 
-    if (access(buf, F_OK) == 0) {
-        int value = atoi(req_item->value);
-        ALOGD_IF(DEBUG_D, "Set %s: %s", buf, req_item->value);
-        write(pm_qos_cpuidle_fd, &value, sizeof(value));
+    if (vfs_access(buf, F_OK) == 0) {
+        int value = (int)req_item->value;
+        char str[LEN_VALUE_MAX] = {'\0'};
+        int64_t start = stats_io_begin();
+
+        req_value_format(file, req_item->value, str, sizeof(str));
+        ALOGD_IF(DEBUG_D, "Set %s: %s", buf, str);
+        TRACE_BEGIN("write %s=%s", buf, str);
+        vfs_write(pm_qos_cpuidle_fd, &value, sizeof(value));
+        TRACE_END();
+        stats_io_end(start);
+        NODE_VALUE(buf, file, str, 10);
     }
 
     return 1;
@@ -0,0 +1,641 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "clock.h"
+#include "psi_monitor.h"
+#include "thread_sched.h"
+#include "utils.h"
+#include "vfs.h"
+
+/**
+ * struct psi_source - an entered scene that escalates under pressure
+ * @scene: the scene, NULL if the slot is free
+ * @until_ns: when the scene ends in clock_monotonic_ns(), INT64_MAX
+ *            until it is exited
+ */
+struct psi_source {
+    const struct scene *scene;
+    int64_t until_ns;
+};
+
+static struct psi_source sources[NUM_PSI_SOURCE_MAX];
+// Guards sources[], boost() runs on many threads with the HAL lock shared
+static pthread_mutex_t source_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * struct psi_trigger - a PSI trigger on a pressure file
+ * @path: the pressure file
+ * @kind: "some" or "full"
+ * @stall_us: the stall within @window_us that fires it
+ * @window_us: the window of the trigger
+ * @fd: the registered trigger, -1 if it isn't
+ */
+struct psi_trigger {
+    const char *path;
+    const char *kind;
+    int stall_us;
+    int window_us;
+    int fd;
+};
+
+static struct psi_trigger triggers[PSI_TRIGGER_MAX] = {
+    [PSI_TRIGGER_CPU] = { PATH_PSI_CPU, "some", 0, 0, -1 },
+    [PSI_TRIGGER_MEM_SOME] = { PATH_PSI_MEMORY, "some", 0, 0, -1 },
+    [PSI_TRIGGER_MEM_FULL] = { PATH_PSI_MEMORY, "full", 0, 0, -1 },
+};
+
+const char *const psi_mem_level_scenes[PSI_MEM_LEVEL_MAX][2] = {
+    [PSI_MEM_LEVEL_SOME] = { "vm_fault_around", NULL },
+    [PSI_MEM_LEVEL_FULL] = { "gts_memory", "gts_memory_pss" },
+};
+
+static struct sprd_power_module *psi_pm = NULL;
+static pthread_t psi_thread;
+static int stop_fd = -1;
+static bool running = false;
+static struct psi_stats cpu_stats;
+static struct psi_mem_stats mem_stats;
+
+// The scenes entered on top, only used by the power_psi thread
+static char escalated[NUM_PSI_SOURCE_MAX][LEN_SCENE_NAME_MAX];
+static unsigned int escalated_generation[NUM_PSI_SOURCE_MAX];
+static int escalated_count = 0;
+static int64_t escalate_ns = 0;
+static uint64_t sample_stall_us = 0;
+static int64_t sample_ns = 0;
+
+/**
+ * struct psi_mem_state - the memory level, only used by the power_psi thread
+ * @level: PSI_MEM_LEVEL_*, read by the dump
+ * @entered: the scenes of each level that were entered
+ * @generation: clear_generation when each of them was entered
+ * @level_ns: when @level was reached
+ * @calm_ns: since when the pressure has been low enough to drop @level, 0 if it isn't
+ * @sample_ns: when the stalls and @allocstall were sampled
+ * @stall_us: the some and full stall totals at @sample_ns
+ * @allocstall: the direct reclaim count at @sample_ns
+ */
+struct psi_mem_state {
+    int level;
+    bool entered[PSI_MEM_LEVEL_MAX][2];
+    unsigned int generation[PSI_MEM_LEVEL_MAX][2];
+    int64_t level_ns;
+    int64_t calm_ns;
+    int64_t sample_ns;
+    uint64_t stall_us[2];
+    uint64_t allocstall;
+};
+
+static struct psi_mem_state mem;
+
+void psi_monitor_scene(const struct scene *scene, int enable, int duration)
+{
+    struct psi_source *slot = NULL;
+    int64_t until = 0;
+
+    if (scene->escalate[0] == '\0')
+        return;
+
+    pthread_mutex_lock(&source_lock);
+    for (int i = 0; i < NUM_PSI_SOURCE_MAX; i++) {
+        if (sources[i].scene == scene) {
+            slot = &sources[i];
+            break;
+        }
+        if (sources[i].scene == NULL && slot == NULL)
+            slot = &sources[i];
+    }
+
+    if (slot != NULL) {
+        if (enable && duration > 0) {
+            until = clock_monotonic_ns() + (int64_t)duration * MS_TO_NS;
+            if (slot->scene == scene && slot->until_ns > until)
+                until = slot->until_ns;
+        } else if (enable) {
+            until = INT64_MAX;
+        }
+        slot->scene = (until != 0)? scene: NULL;
+        slot->until_ns = until;
+    }
+    pthread_mutex_unlock(&source_lock);
+}
+
+// Collect the escalation targets of the scenes entered now into @names, returns the count
+static int active_targets(char names[][LEN_SCENE_NAME_MAX])
+{
+    int64_t now = clock_monotonic_ns();
+    const char *target = NULL;
+    bool found = false;
+    int count = 0;
+
+    pthread_mutex_lock(&source_lock);
+    for (int i = 0; i < NUM_PSI_SOURCE_MAX; i++) {
+        if (sources[i].scene == NULL)
+            continue;
+        if (sources[i].until_ns <= now) {
+            sources[i].scene = NULL;
+            continue;
+        }
+
+        target = sources[i].scene->escalate;
+        found = false;
+        for (int j = 0; j < count && !found; j++)
+            found = (strcmp(names[j], target) == 0);
+        if (!found)
+            snprintf(names[count++], LEN_SCENE_NAME_MAX, "%s", target);
+    }
+    pthread_mutex_unlock(&source_lock);
+
+    return count;
+}
+
+// The total stall of @trigger's kind in its pressure file in us, 0 if it can't be read
+static uint64_t read_stall_us(const struct psi_trigger *trigger)
+{
+    char buf[256] = {'\0'};
+    unsigned long long total = 0;
+    char *ptr = NULL;
+
+    if (sprd_read(trigger->path, buf, sizeof(buf)) != 0)
+        return 0;
+
+    ptr = strstr(buf, trigger->kind);
+    if (ptr != NULL)
+        ptr = strstr(ptr, "total=");
+    if (ptr == NULL || sscanf(ptr, "total=%llu", &total) != 1)
+        return 0;
+
+    return total;
+}
+
+// Whether @stall_us in @elapsed_us is under PSI_RELAX_PCT of the rate firing @trigger
+static bool stall_is_low(const struct psi_trigger *trigger, uint64_t stall_us, int64_t elapsed_us)
+{
+    return stall_us * 100 * trigger->window_us
+        < (uint64_t)elapsed_us * trigger->stall_us * PSI_RELAX_PCT;
+}
+
+static void escalate(void)
+{
+    char names[NUM_PSI_SOURCE_MAX][LEN_SCENE_NAME_MAX];
+    int count = 0;
+
+    __atomic_add_fetch(&cpu_stats.triggers, 1, __ATOMIC_RELAXED);
+    if (escalated_count > 0)
+        return;
+
+    count = active_targets(names);
+    if (count == 0) {
+        __atomic_add_fetch(&cpu_stats.idle, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (power_psi_escalate(psi_pm, names[i], 1, &escalated_generation[escalated_count]) > 0)
+            memcpy(escalated[escalated_count++], names[i], LEN_SCENE_NAME_MAX);
+    }
+    if (escalated_count == 0)
+        return;
+
+    ALOGD("CPU pressure, escalate to %s%s", escalated[0], (escalated_count > 1)? " ...": "");
+    __atomic_add_fetch(&cpu_stats.escalations, 1, __ATOMIC_RELAXED);
+    escalate_ns = clock_monotonic_ns();
+    sample_ns = escalate_ns;
+    sample_stall_us = read_stall_us(&triggers[PSI_TRIGGER_CPU]);
+}
+
+// Exit the escalated scenes, unless a mode switch or ctrl_power_hint() cleared them already
+static void relax(void)
+{
+    for (int i = 0; i < escalated_count; i++)
+        power_psi_escalate(psi_pm, escalated[i], 0, &escalated_generation[i]);
+    hist_add(&cpu_stats.escalated, (uint64_t)(clock_monotonic_ns() - escalate_ns) / 1000);
+    ALOGD("CPU pressure subsided, drop back from %s", escalated[0]);
+    escalated_count = 0;
+}
+
+// Drop back if the stall rate since the last sample is low or nothing escalates any more
+static void check_relax(void)
+{
+    char names[NUM_PSI_SOURCE_MAX][LEN_SCENE_NAME_MAX];
+    int64_t now = clock_monotonic_ns();
+    uint64_t stall = 0;
+    int64_t elapsed_us = 0;
+
+    if (now - sample_ns < (int64_t)PSI_CHECK_MS * MS_TO_NS)
+        return;
+
+    stall = read_stall_us(&triggers[PSI_TRIGGER_CPU]);
+    elapsed_us = (now - sample_ns) / 1000;
+    if (active_targets(names) == 0
+        || stall_is_low(&triggers[PSI_TRIGGER_CPU], stall - sample_stall_us, elapsed_us))
+        relax();
+
+    sample_ns = now;
+    sample_stall_us = stall;
+}
+
+// The direct reclaims counted in PATH_VMSTAT, the allocstall lines of every zone
+static uint64_t read_allocstall(void)
+{
+    char buf[8192] = {'\0'};
+    unsigned long long count = 0;
+    uint64_t total = 0;
+    char *ptr = buf;
+
+    if (sprd_read(PATH_VMSTAT, buf, sizeof(buf)) != 0)
+        return 0;
+
+    while ((ptr = strstr(ptr, "allocstall")) != NULL) {
+        ptr = strchr(ptr, ' ');
+        if (ptr == NULL || sscanf(ptr, " %llu", &count) != 1)
+            break;
+        total += count;
+    }
+
+    return total;
+}
+
+static void sample_mem(int64_t now)
+{
+    mem.stall_us[0] = read_stall_us(&triggers[PSI_TRIGGER_MEM_SOME]);
+    mem.stall_us[1] = read_stall_us(&triggers[PSI_TRIGGER_MEM_FULL]);
+    mem.allocstall = read_allocstall();
+    mem.sample_ns = now;
+}
+
+// Enter the scenes of the levels up to @level, or exit those above it
+static void set_mem_level(int level)
+{
+    int64_t now = clock_monotonic_ns();
+
+    if (level == mem.level)
+        return;
+
+    if (mem.level != PSI_MEM_LEVEL_NONE)
+        hist_add(&mem_stats.held[mem.level], (uint64_t)(now - mem.level_ns) / 1000);
+    __atomic_add_fetch((level > mem.level)? &mem_stats.raised: &mem_stats.lowered, 1, __ATOMIC_RELAXED);
+    ALOGD("Memory pressure level %d -> %d", mem.level, level);
+
+    for (int l = mem.level + 1; l <= level; l++) {
+        for (int i = 0; i < 2 && psi_mem_level_scenes[l][i] != NULL; i++)
+            mem.entered[l][i] = (power_psi_escalate(psi_pm, psi_mem_level_scenes[l][i], 1
+                , &mem.generation[l][i]) > 0);
+    }
+    for (int l = mem.level; l > level; l--) {
+        for (int i = 0; i < 2; i++) {
+            if (mem.entered[l][i])
+                power_psi_escalate(psi_pm, psi_mem_level_scenes[l][i], 0, &mem.generation[l][i]);
+            mem.entered[l][i] = false;
+        }
+    }
+
+    __atomic_store_n(&mem.level, level, __ATOMIC_RELAXED);
+    mem.level_ns = now;
+    mem.calm_ns = 0;
+    if (level != PSI_MEM_LEVEL_NONE)
+        sample_mem(now);
+}
+
+/*
+ * Raise the level on direct reclaim, drop it one step once its pressure
+ * has been low for PSI_MEM_HOLD_MS
+ */
+static void check_mem(void)
+{
+    int64_t now = clock_monotonic_ns();
+    int64_t elapsed_us = (now - mem.sample_ns) / 1000;
+    uint64_t some = 0;
+    uint64_t full = 0;
+    uint64_t allocstall = 0;
+    bool calm = false;
+
+    if (now - mem.sample_ns < (int64_t)PSI_MEM_CHECK_MS * MS_TO_NS)
+        return;
+
+    some = read_stall_us(&triggers[PSI_TRIGGER_MEM_SOME]);
+    full = read_stall_us(&triggers[PSI_TRIGGER_MEM_FULL]);
+    allocstall = read_allocstall();
+    if (allocstall > mem.allocstall)
+        __atomic_add_fetch(&mem_stats.direct_reclaims, allocstall - mem.allocstall, __ATOMIC_RELAXED);
+
+    if (allocstall > mem.allocstall && mem.level < PSI_MEM_LEVEL_FULL) {
+        set_mem_level(PSI_MEM_LEVEL_FULL);
+        return;
+    }
+
+    if (mem.level == PSI_MEM_LEVEL_FULL)
+        calm = allocstall == mem.allocstall
+            && stall_is_low(&triggers[PSI_TRIGGER_MEM_FULL], full - mem.stall_us[1], elapsed_us);
+    else
+        calm = stall_is_low(&triggers[PSI_TRIGGER_MEM_SOME], some - mem.stall_us[0], elapsed_us);
+
+    mem.stall_us[0] = some;
+    mem.stall_us[1] = full;
+    mem.allocstall = allocstall;
+    mem.sample_ns = now;
+    if (!calm) {
+        mem.calm_ns = 0;
+    } else if (mem.calm_ns == 0) {
+        mem.calm_ns = now;
+    } else if (now - mem.calm_ns >= (int64_t)PSI_MEM_HOLD_MS * MS_TO_NS) {
+        set_mem_level(mem.level - 1);
+    }
+}
+
+static int poll_timeout_ms(void)
+{
+    if (escalated_count > 0)
+        return PSI_CHECK_MS;
+    if (mem.level != PSI_MEM_LEVEL_NONE)
+        return PSI_MEM_CHECK_MS;
+
+    return -1;
+}
+
+// One pass of the power_psi thread after poll() returned
+void psi_monitor_step(unsigned int fired)
+{
+    for (int i = 0; i < PSI_TRIGGER_MAX; i++) {
+        if (!(fired & (1u << i)))
+            continue;
+
+        if (i == PSI_TRIGGER_CPU) {
+            escalate();
+        } else {
+            __atomic_add_fetch(&mem_stats.triggers[i - PSI_TRIGGER_MEM_SOME], 1, __ATOMIC_RELAXED);
+            if (mem.level < PSI_MEM_LEVEL_SOME + i - PSI_TRIGGER_MEM_SOME)
+                set_mem_level(PSI_MEM_LEVEL_SOME + i - PSI_TRIGGER_MEM_SOME);
+            else
+                mem.calm_ns = 0;
+        }
+    }
+
+    if (escalated_count > 0)
+        check_relax();
+    if (mem.level != PSI_MEM_LEVEL_NONE)
+        check_mem();
+}
+
+static void *psi_monitor_loop(void __unused *args)
+{
+    struct pollfd fds[PSI_TRIGGER_MAX + 1];
+    unsigned int fired = 0;
+
+    prctl(PR_SET_NAME, "power_psi");
+    thread_sched_apply(THREAD_PSI);
+    fds[0].fd = stop_fd;
+    fds[0].events = POLLIN;
+    for (int i = 0; i < PSI_TRIGGER_MAX; i++) {
+        fds[i + 1].fd = triggers[i].fd;
+        fds[i + 1].events = POLLPRI;
+    }
+
+    for (;;) {
+        if (poll(fds, PSI_TRIGGER_MAX + 1, poll_timeout_ms()) < 0) {
+            if (errno == EINTR)
+                continue;
+            ALOGE("%s: poll failed: %s", __func__, strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents != 0)
+            break;
+
+        fired = 0;
+        for (int i = 0; i < PSI_TRIGGER_MAX; i++) {
+            if (fds[i + 1].revents & POLLERR) {
+                ALOGE("%s: the %s trigger of %s is gone", __func__, triggers[i].kind, triggers[i].path);
+                fds[i + 1].fd = -1;
+            } else if (fds[i + 1].revents & POLLPRI) {
+                fired |= 1u << i;
+            }
+        }
+        psi_monitor_step(fired);
+    }
+
+    return NULL;
+}
+
+/*
+ * Register @trigger, falling back to the window unprivileged triggers
+ * take. Returns 0, or -errno leaving @trigger unregistered.
+ */
+static int register_trigger(struct psi_trigger *trigger)
+{
+    char buf[64] = {'\0'};
+    int len = 0;
+    int ret = 0;
+
+    trigger->fd = vfs_open(trigger->path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (trigger->fd < 0)
+        return -errno;
+
+    len = snprintf(buf, sizeof(buf), "%s %d %d", trigger->kind, trigger->stall_us, trigger->window_us);
+    if (vfs_write(trigger->fd, buf, len + 1) >= 0)
+        return 0;
+
+    ret = -errno;
+    if (ret == -EINVAL && trigger->window_us % PSI_WINDOW_UNPRIV_US != 0) {
+        trigger->stall_us = (int)((int64_t)trigger->stall_us * PSI_WINDOW_UNPRIV_US / trigger->window_us);
+        trigger->window_us = PSI_WINDOW_UNPRIV_US;
+        len = snprintf(buf, sizeof(buf), "%s %d %d", trigger->kind, trigger->stall_us, trigger->window_us);
+        if (vfs_write(trigger->fd, buf, len + 1) >= 0) {
+            ALOGD("PSI %s trigger of %s takes %dus in a %dus window"
+                , trigger->kind, trigger->path, trigger->stall_us, trigger->window_us);
+            return 0;
+        }
+        ret = -errno;
+    }
+
+    vfs_close(trigger->fd);
+    trigger->fd = -1;
+    return ret;
+}
+
+static void unregister_triggers(void)
+{
+    for (int i = 0; i < PSI_TRIGGER_MAX; i++) {
+        if (triggers[i].fd >= 0)
+            vfs_close(triggers[i].fd);
+        triggers[i].fd = -1;
+    }
+}
+
+// Start the power_psi thread, returns 0 or -errno
+static int start_loop(void)
+{
+    int ret = 0;
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        ret = -errno;
+        ALOGE("%s: eventfd failed: %s", __func__, strerror(errno));
+        return ret;
+    }
+
+    if (pthread_create(&psi_thread, NULL, &psi_monitor_loop, NULL) != 0) {
+        ALOGE("%s: Thread create fail", __func__);
+        close(stop_fd);
+        stop_fd = -1;
+        return -EAGAIN;
+    }
+
+    return 0;
+}
+
+int psi_monitor_init(struct sprd_power_module *pm)
+{
+    if (property_get_int32(POWER_PSI_MONITOR_PROP, 0) == 0)
+        return 0;
+
+    return psi_monitor_start(pm);
+}
+
+int psi_monitor_start(struct sprd_power_module *pm)
+{
+    int registered = 0;
+    int ret = 0;
+
+    if (running)
+        return 0;
+
+    triggers[PSI_TRIGGER_CPU].stall_us = property_get_int32(POWER_PSI_CPU_STALL_PROP, PSI_CPU_STALL_US_DEFAULT);
+    triggers[PSI_TRIGGER_CPU].window_us = property_get_int32(POWER_PSI_CPU_WINDOW_PROP, PSI_CPU_WINDOW_US_DEFAULT);
+    triggers[PSI_TRIGGER_MEM_SOME].stall_us = property_get_int32(POWER_PSI_MEM_SOME_PROP, PSI_MEM_SOME_US_DEFAULT);
+    triggers[PSI_TRIGGER_MEM_SOME].window_us = PSI_MEM_WINDOW_US;
+    triggers[PSI_TRIGGER_MEM_FULL].stall_us = property_get_int32(POWER_PSI_MEM_FULL_PROP, PSI_MEM_FULL_US_DEFAULT);
+    triggers[PSI_TRIGGER_MEM_FULL].window_us = PSI_MEM_WINDOW_US;
+
+    for (int i = 0; i < PSI_TRIGGER_MAX; i++) {
+        if (triggers[i].stall_us <= 0 || triggers[i].window_us <= 0
+            || triggers[i].stall_us >= triggers[i].window_us) {
+            ALOGE("%s: bad %s stall %dus in window %dus of %s", __func__, triggers[i].kind
+                , triggers[i].stall_us, triggers[i].window_us, triggers[i].path);
+            continue;
+        }
+
+        ret = register_trigger(&triggers[i]);
+        if (ret != 0) {
+            ALOGE("%s: register the %s trigger of %s failed: %s", __func__, triggers[i].kind
+                , triggers[i].path, strerror(-ret));
+            continue;
+        }
+        registered++;
+    }
+    if (registered == 0)
+        return -ENODEV;
+
+    psi_pm = pm;
+    escalated_count = 0;
+    memset(&mem, 0, sizeof(mem));
+    // On the virtual clock the host tool runs the passes, with psi_monitor_step()
+    if (!clock_is_virtual()) {
+        ret = start_loop();
+        if (ret != 0) {
+            unregister_triggers();
+            return ret;
+        }
+    }
+
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+    ALOGD("PSI monitor watches %d triggers", registered);
+    return 0;
+}
+
+void psi_monitor_stop(void)
+{
+    uint64_t one = 1;
+
+    if (!running)
+        return;
+
+    if (stop_fd >= 0) {
+        if (write(stop_fd, &one, sizeof(one)) != sizeof(one))
+            ALOGE("%s: stop failed: %s", __func__, strerror(errno));
+        pthread_join(psi_thread, NULL);
+        close(stop_fd);
+        stop_fd = -1;
+    }
+
+    if (escalated_count > 0)
+        relax();
+    set_mem_level(PSI_MEM_LEVEL_NONE);
+    __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+    unregister_triggers();
+}
+
+const struct psi_stats *psi_monitor_stats_get(void)
+{
+    return &cpu_stats;
+}
+
+const struct psi_mem_stats *psi_monitor_mem_stats_get(void)
+{
+    return &mem_stats;
+}
+
+int psi_monitor_mem_level(void)
+{
+    return __atomic_load_n(&mem.level, __ATOMIC_RELAXED);
+}
+
+int psi_monitor_dump(int fd)
+{
+    const struct psi_trigger *cpu = &triggers[PSI_TRIGGER_CPU];
+
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+        return 0;
+
+    if (cpu->fd >= 0) {
+        dprintf(fd, "PSI cpu: stall=%dus window=%dus triggers=%llu idle=%llu escalations=%llu\n"
+            , cpu->stall_us, cpu->window_us
+            , (unsigned long long)__atomic_load_n(&cpu_stats.triggers, __ATOMIC_RELAXED)
+            , (unsigned long long)__atomic_load_n(&cpu_stats.idle, __ATOMIC_RELAXED)
+            , (unsigned long long)__atomic_load_n(&cpu_stats.escalations, __ATOMIC_RELAXED));
+        hist_dump(fd, "escalated", &cpu_stats.escalated);
+    }
+
+    dprintf(fd, "PSI memory: level=%d some=%dus full=%dus window=%dus triggers=%llu/%llu"
+        " raised=%llu lowered=%llu direct_reclaims=%llu\n"
+        , psi_monitor_mem_level()
+        , triggers[PSI_TRIGGER_MEM_SOME].stall_us, triggers[PSI_TRIGGER_MEM_FULL].stall_us
+        , triggers[PSI_TRIGGER_MEM_SOME].window_us
+        , (unsigned long long)__atomic_load_n(&mem_stats.triggers[0], __ATOMIC_RELAXED)
+        , (unsigned long long)__atomic_load_n(&mem_stats.triggers[1], __ATOMIC_RELAXED)
+        , (unsigned long long)__atomic_load_n(&mem_stats.raised, __ATOMIC_RELAXED)
+        , (unsigned long long)__atomic_load_n(&mem_stats.lowered, __ATOMIC_RELAXED)
+        , (unsigned long long)__atomic_load_n(&mem_stats.direct_reclaims, __ATOMIC_RELAXED));
+    hist_dump(fd, "held_some", &mem_stats.held[PSI_MEM_LEVEL_SOME]);
+    hist_dump(fd, "held_full", &mem_stats.held[PSI_MEM_LEVEL_FULL]);
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_PSI_MONITOR_H
+#define INCLUDE_POWER_PSI_MONITOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "sprd_power.h"
+#include "stats.h"
+
+#define POWER_PSI_MONITOR_PROP            "persist.vendor.power.psi"
+#define POWER_PSI_CPU_STALL_PROP          "persist.vendor.power.psi_cpu_stall_us"
+#define POWER_PSI_CPU_WINDOW_PROP         "persist.vendor.power.psi_cpu_window_us"
+#define POWER_PSI_MEM_SOME_PROP           "persist.vendor.power.psi_mem_some_us"
+#define POWER_PSI_MEM_FULL_PROP           "persist.vendor.power.psi_mem_full_us"
+#define PATH_PSI_CPU                      "/proc/pressure/cpu"
+#define PATH_PSI_MEMORY                   "/proc/pressure/memory"
+#define PATH_VMSTAT                       "/proc/vmstat"
+
+// Some task stalled this long within the window escalates a boost
+#define PSI_CPU_STALL_US_DEFAULT          100000
+#define PSI_CPU_WINDOW_US_DEFAULT         1000000
+// Since Linux 6.5 unprivileged triggers need windows in multiples of this
+#define PSI_WINDOW_UNPRIV_US              2000000
+// How often the stall is sampled while escalated
+#define PSI_CHECK_MS                      100
+// Drop back once the stall rate falls under this share of the trigger's
+#define PSI_RELAX_PCT                     50
+
+/*
+ * The memory stall within PSI_MEM_WINDOW_US raising the memory level, the
+ * defaults of lmkd's ro.lmk.psi_partial_stall_ms and psi_complete_stall_ms
+ */
+#define PSI_MEM_SOME_US_DEFAULT           70000
+#define PSI_MEM_FULL_US_DEFAULT           700000
+#define PSI_MEM_WINDOW_US                 1000000
+// How often the memory stall and /proc/vmstat are sampled while the level is up
+#define PSI_MEM_CHECK_MS                  500
+// The pressure must stay low this long before the level drops
+#define PSI_MEM_HOLD_MS                   5000
+
+#define NUM_PSI_SOURCE_MAX                8
+
+enum {
+    PSI_TRIGGER_CPU = 0,
+    PSI_TRIGGER_MEM_SOME,
+    PSI_TRIGGER_MEM_FULL,
+    PSI_TRIGGER_MAX,
+};
+
+/**
+ * struct psi_stats - what the PSI monitor did about CPU pressure
+ * @triggers: PSI trigger events
+ * @idle: trigger events with no escalating scene entered
+ * @escalations: times the stronger scenes were entered
+ * @escalated: how long each escalation lasted
+ */
+struct psi_stats {
+    uint64_t triggers;
+    uint64_t idle;
+    uint64_t escalations;
+    struct hist escalated;
+};
+
+enum {
+    PSI_MEM_LEVEL_NONE = 0,
+    // Some task stalls on memory: vm_fault_around
+    PSI_MEM_LEVEL_SOME,
+    // All tasks stall or direct reclaim runs: gts_memory and gts_memory_pss too
+    PSI_MEM_LEVEL_FULL,
+    PSI_MEM_LEVEL_MAX,
+};
+
+// The scenes entered at each memory level besides those of the levels below
+extern const char *const psi_mem_level_scenes[PSI_MEM_LEVEL_MAX][2];
+
+/**
+ * struct psi_mem_stats - what the PSI monitor did about memory pressure
+ * @triggers: PSI trigger events of the some and the full trigger
+ * @raised: times the level went up
+ * @lowered: times the level went down
+ * @direct_reclaims: direct reclaims (allocstall) seen while the level was up
+ * @held: how long each level above PSI_MEM_LEVEL_NONE lasted
+ */
+struct psi_mem_stats {
+    uint64_t triggers[2];
+    uint64_t raised;
+    uint64_t lowered;
+    uint64_t direct_reclaims;
+    struct hist held[PSI_MEM_LEVEL_MAX];
+};
+
+/*
+ * A scene with an escalate attribute, e.g.
+ *
+ *   <scene name="launch" escalate="performance">
+ *
+ * has the named scene entered on top of it when the CPU PSI trigger
+ * fires while it is entered, some task having stalled for the
+ * persist.vendor.power.psi_cpu_stall_us of a window. The stronger scene
+ * is exited once the stall rate, sampled every PSI_CHECK_MS, falls
+ * under PSI_RELAX_PCT of the trigger's or no escalating scene is
+ * entered any more.
+ *
+ * Memory pressure enters the memory scenes of power_scene_id_define.txt
+ * the config defines by level: the "some" trigger on /proc/pressure/memory
+ * raises it to PSI_MEM_LEVEL_SOME, the "full" trigger or a direct
+ * reclaim counted in /proc/vmstat to PSI_MEM_LEVEL_FULL. The level drops
+ * one step once the stall rate of its trigger has stayed under
+ * PSI_RELAX_PCT of the threshold, without direct reclaim for the full
+ * level, for PSI_MEM_HOLD_MS. No shipped config defines these scenes,
+ * a product adds them with its own tuning; the fake product
+ * host/config_files/psi has them for powerhint_verify.
+ *
+ * With persist.vendor.power.psi set, psi_monitor_init() registers the
+ * triggers the kernel has and starts the power_psi thread;
+ * psi_monitor_start() skips the property, for host tools. On the virtual
+ * clock it starts no thread: the host tool runs each pass of it with
+ * psi_monitor_step(), @fired holding 1 << PSI_TRIGGER_* of every trigger
+ * that fired, the stall totals and direct reclaims then being read
+ * back from the fake pressure files and /proc/vmstat.
+ *
+ * psi_monitor_scene() is called by boost() for every scene it enters
+ * or exits.
+ */
+int psi_monitor_init(struct sprd_power_module *pm);
+int psi_monitor_start(struct sprd_power_module *pm);
+void psi_monitor_step(unsigned int fired);
+void psi_monitor_stop(void);
+void psi_monitor_scene(const struct scene *scene, int enable, int duration);
+const struct psi_stats *psi_monitor_stats_get(void);
+const struct psi_mem_stats *psi_monitor_mem_stats_get(void);
+int psi_monitor_mem_level(void);
+int psi_monitor_dump(int fd);
+
+/*
+ * Enters or exits the scene @name for the PSI monitor, returns 1 if it
+ * was applied, 0 if the current mode has no such scene. Entering stores
+ * clear_generation in @generation; the exit is skipped if the requests
+ * were cleared since, as by a mode switch. Defined by sprd_power.c.
+ */
+int power_psi_escalate(struct sprd_power_module *pm, const char *name, int enable
+    , unsigned int *generation);
+#endif
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <cutils/compiler.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "utils.h"
+#include "common.h"
+#include "recorder.h"
+#include "vfs.h"
+
+/*
+ * Writers claim a slot with one atomic increment of head, so recording
+ * never blocks nor takes the HAL lock. A slot's seq is cleared while it is
+ * filled and published last, readers skip the slots that change under
+ * them. Nothing is formatted until the ring is dumped.
+ */
+static struct flight_record records[NUM_FLIGHT_RECORD_MAX];
+static uint32_t head = 0;
+
+static const char *event_names[FR_EV_MAX] = {
+    [FR_EV_ENTER] = "enter",
+    [FR_EV_EXIT] = "exit",
+    [FR_EV_HINT] = "hint",
+    [FR_EV_BOOST] = "boost",
+    [FR_EV_DEBOOST] = "deboost",
+    [FR_EV_WRITE] = "write",
+    [FR_EV_TIMEOUT] = "timeout",
+    [FR_EV_MODE] = "mode",
+};
+
+static int crash_signals[] = { SIGSEGV, SIGBUS, SIGABRT, SIGFPE, SIGILL };
+static struct sigaction old_actions[sizeof(crash_signals) / sizeof(crash_signals[0])];
+// Resolved at install, the crash handler can't call vfs_path()
+static char crash_path[LEN_VFS_PATH_MAX];
+
+void flight_record(int event, const char *func, int node, int64_t value)
+{
+    struct timespec now;
+    uint32_t index = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    struct flight_record *record = &records[index & (NUM_FLIGHT_RECORD_MAX - 1)];
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    __atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->ts_ns = (int64_t)now.tv_sec * SEC_TO_MS * MS_TO_NS + now.tv_nsec;
+    record->func = func;
+    record->value = value;
+    record->event = event;
+    record->node = (node < 0)? FR_NODE_NONE: node;
+    __atomic_store_n(&record->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+static const char *node_name(int node, char *buf, int size)
+{
+    struct file *file = NULL;
+
+    if (node == FR_NODE_NONE)
+        return "-";
+
+    file = find_file_by_id(node);
+    if (file == NULL) {
+        snprintf(buf, size, "#%d", node);
+        return buf;
+    }
+
+    return file->name;
+}
+
+/**
+ * flight_recorder_dump - decode the ring to @fd, oldest record first
+ */
+int flight_recorder_dump(int fd)
+{
+    uint32_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    uint32_t start = (end > NUM_FLIGHT_RECORD_MAX)? end - NUM_FLIGHT_RECORD_MAX: 0;
+    struct flight_record record;
+    char buf[16];
+
+    dprintf(fd, "Flight recorder (%u events):\n", end);
+    for (uint32_t i = start; i != end; i++) {
+        struct flight_record *slot = &records[i & (NUM_FLIGHT_RECORD_MAX - 1)];
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != i + 1)
+            continue;
+        memcpy(&record, slot, sizeof(record));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != i + 1)
+            continue;
+
+        dprintf(fd, "  %5lld.%06lld %-8s %-36s %-28s %lld(0x%llx)\n"
+            , (long long)(record.ts_ns / (SEC_TO_MS * MS_TO_NS))
+            , (long long)(record.ts_ns % (SEC_TO_MS * MS_TO_NS) / MS_TO_US)
+            , (record.event < FR_EV_MAX && event_names[record.event] != NULL)
+                ? event_names[record.event]: "?"
+            , (record.func != NULL)? record.func: "-"
+            , node_name(record.node, buf, sizeof(buf))
+            , (long long)record.value, (unsigned long long)record.value);
+    }
+
+    return 0;
+}
+
+/*
+ * The crash handler may only call async-signal-safe functions: lines
+ * are formatted by hand into a buffer and written with write(2).
+ */
+struct crash_line {
+    char buf[160];
+    int len;
+};
+
+static void line_puts(struct crash_line *line, const char *s)
+{
+    while (*s != '\0' && line->len < (int)sizeof(line->buf))
+        line->buf[line->len++] = *s++;
+}
+
+static void line_putu(struct crash_line *line, unsigned long long v, int base, int width)
+{
+    char digits[24];
+    int count = 0;
+
+    do {
+        digits[count++] = "0123456789abcdef"[v % base];
+        v /= base;
+    } while (v != 0 && count < (int)sizeof(digits));
+    while (count < width && count < (int)sizeof(digits))
+        digits[count++] = '0';
+    while (count > 0 && line->len < (int)sizeof(line->buf))
+        line->buf[line->len++] = digits[--count];
+}
+
+// Write @line with a newline, returns false if it failed, nothing to do about it in a crash
+static bool line_write(int fd, struct crash_line *line)
+{
+    int len = 0;
+
+    line_puts(line, "\n");
+    len = line->len;
+    line->len = 0;
+    return write(fd, line->buf, len) == len;
+}
+
+// The ring as "<sec>.<usec> <event> <func> <node id> <value in hex>" lines
+static void crash_dump(int fd)
+{
+    uint32_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    uint32_t start = (end > NUM_FLIGHT_RECORD_MAX)? end - NUM_FLIGHT_RECORD_MAX: 0;
+    struct crash_line line = { .len = 0 };
+    struct flight_record *record = NULL;
+
+    for (uint32_t i = start; i != end; i++) {
+        record = &records[i & (NUM_FLIGHT_RECORD_MAX - 1)];
+        if (__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) != i + 1)
+            continue;
+
+        line_putu(&line, record->ts_ns / (SEC_TO_MS * MS_TO_NS), 10, 1);
+        line_puts(&line, ".");
+        line_putu(&line, record->ts_ns % (SEC_TO_MS * MS_TO_NS) / MS_TO_US, 10, 6);
+        line_puts(&line, " ");
+        line_puts(&line, (record->event < FR_EV_MAX && event_names[record->event] != NULL)
+            ? event_names[record->event]: "?");
+        line_puts(&line, " ");
+        line_puts(&line, (record->func != NULL)? record->func: "-");
+        line_puts(&line, " ");
+        if (record->node == FR_NODE_NONE)
+            line_puts(&line, "-");
+        else
+            line_putu(&line, record->node, 10, 1);
+        line_puts(&line, " 0x");
+        line_putu(&line, (unsigned long long)record->value, 16, 1);
+        line_write(fd, &line);
+    }
+}
+
+static void crash_handler(int signo, siginfo_t *info, void __unused *ucontext)
+{
+    struct crash_line line = { .len = 0 };
+    int fd = open(crash_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+
+    if (fd >= 0) {
+        line_puts(&line, "Power HAL crashed by signal ");
+        line_putu(&line, signo, 10, 1);
+        line_write(fd, &line);
+        crash_dump(fd);
+        close(fd);
+    }
+
+    // Hand the signal to the previous handler, debuggerd by default
+    for (size_t i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); i++) {
+        if (crash_signals[i] == signo) {
+            sigaction(signo, &old_actions[i], NULL);
+            break;
+        }
+    }
+    // A fault raises itself again on return, a sent signal is sent again as it came
+    if (info->si_code <= 0)
+        syscall(SYS_rt_tgsigqueueinfo, getpid(), gettid(), signo, info);
+}
+
+/**
+ * flight_recorder_install_crash_handler - dump the ring when the process crashes
+ *
+ * Only with persist.vendor.power.crash_record set, the handler runs in
+ * the process of the service.
+ */
+void flight_recorder_install_crash_handler(void)
+{
+    struct sigaction action;
+
+    if (property_get_int32(POWER_FLIGHT_RECORDER_CRASH_PROP, 0) == 0)
+        return;
+
+    vfs_path(PATH_FLIGHT_RECORDER_CRASH, crash_path, sizeof(crash_path));
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_sigaction = crash_handler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+
+    for (size_t i = 0; i < sizeof(crash_signals) / sizeof(crash_signals[0]); i++) {
+        if (sigaction(crash_signals[i], &action, &old_actions[i]) != 0)
+            ALOGE("%s: sigaction(%d) failed", __func__, crash_signals[i]);
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_RECORDER_H
+#define INCLUDE_POWER_RECORDER_H
+
+#include <stdint.h>
+
+#define POWER_FLIGHT_RECORDER_CRASH_PROP  "persist.vendor.power.crash_record"
+#define PATH_FLIGHT_RECORDER_CRASH        "/data/vendor/power/flight_recorder.txt"
+
+// Must be a power of 2
+#define NUM_FLIGHT_RECORD_MAX             1024
+#define FR_NODE_NONE                      0xffff
+
+enum {
+    FR_EV_ENTER = 1,
+    FR_EV_EXIT,
+    FR_EV_HINT,
+    FR_EV_BOOST,
+    FR_EV_DEBOOST,
+    FR_EV_WRITE,
+    FR_EV_TIMEOUT,
+    FR_EV_MODE,
+    FR_EV_MAX,
+};
+
+/**
+ * struct flight_record - one event of the flight recorder, 32 bytes
+ * @ts_ns: monotonic time of the event
+ * @func: the function that records the event, points to __func__
+ * @value: the event payload: the written value, hint or scene id
+ * @seq: index of the record plus 1, 0 while the record is being written
+ * @event: FR_EV_*
+ * @node: the id of the node, FR_NODE_NONE if the event has no node
+ */
+struct flight_record {
+    int64_t ts_ns;
+    const char *func;
+    int64_t value;
+    uint32_t seq;
+    uint16_t event;
+    uint16_t node;
+};
+
+void flight_record(int event, const char *func, int node, int64_t value);
+int flight_recorder_dump(int fd);
+void flight_recorder_install_crash_handler(void);
+#endif
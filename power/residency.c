@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+#include "common.h"
+#include "utils.h"
+#include "clock.h"
+#include "residency.h"
+
+static struct node_residency nodes[NUM_RESIDENCY_NODE_MAX];
+static struct scene_residency scenes[NUM_RESIDENCY_SCENE_MAX];
+// Guards owned, since_ns and boosted_ns of scenes[], nodes change owner concurrently
+static pthread_mutex_t owner_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Files are accounted concurrently, a slot is claimed atomically
+static struct scene_residency *find_scene(const char *name)
+{
+    for (int i = 0; i < NUM_RESIDENCY_SCENE_MAX; i++) {
+        const char *slot = __atomic_load_n(&scenes[i].name, __ATOMIC_ACQUIRE);
+
+        if (slot == name)
+            return &scenes[i];
+        if (slot == NULL) {
+            const char *expected = NULL;
+            if (__atomic_compare_exchange_n(&scenes[i].name, &expected, name, false
+                    , __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) || expected == name)
+                return &scenes[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct value_residency *find_value(struct node_residency *node, const char *value)
+{
+    for (int i = 0; i < NUM_RESIDENCY_VALUE_MAX; i++) {
+        if (node->values[i].entries == 0) {
+            strncpy(node->values[i].value, value, LEN_RESIDENCY_VALUE_MAX - 1);
+            return &node->values[i];
+        }
+        if (strncmp(node->values[i].value, value, LEN_RESIDENCY_VALUE_MAX - 1) == 0)
+            return &node->values[i];
+    }
+
+    return NULL;
+}
+
+// Close the interval of the value in force at @now
+static void account(struct node_residency *node, int id, int64_t now)
+{
+    struct value_residency *value = NULL;
+    struct scene_residency *scene = NULL;
+    uint64_t delta = 0;
+
+    if (node->since_ns == 0) return;
+
+    delta = now - node->since_ns;
+    value = find_value(node, node->value);
+    if (value != NULL)
+        value->time_ns += delta;
+    else
+        node->other_ns += delta;
+
+    if (node->scene != NULL && (scene = find_scene(node->scene)) != NULL)
+        __atomic_fetch_add(&scene->node_ns[id], delta, __ATOMIC_RELAXED);
+}
+
+// A node passes from scene @from to scene @to at @now, either may be NULL
+static void change_owner(const char *from, const char *to, int64_t now)
+{
+    struct scene_residency *scene = NULL;
+
+    if (from == to)
+        return;
+
+    pthread_mutex_lock(&owner_lock);
+    if (from != NULL && (scene = find_scene(from)) != NULL && scene->owned > 0
+        && --scene->owned == 0)
+        scene->boosted_ns += now - scene->since_ns;
+    if (to != NULL && (scene = find_scene(to)) != NULL && scene->owned++ == 0)
+        scene->since_ns = now;
+    pthread_mutex_unlock(&owner_lock);
+}
+
+/**
+ * residency_update - the effective value of @file changed
+ * @value: the value now in force, the default value when requests are cleared
+ * @scene: the scene owning @value, NULL if the node is not boosted
+ *
+ * Must be called with the lock of @file held.
+ */
+void residency_update(const struct file *file, const char *value, const char *scene)
+{
+    struct node_residency *node = NULL;
+    struct value_residency *entry = NULL;
+    int64_t now = clock_monotonic_ns();
+
+    if (CC_UNLIKELY(file == NULL || file->id < 0 || file->id >= NUM_RESIDENCY_NODE_MAX))
+        return;
+
+    node = &nodes[file->id];
+    account(node, file->id, now);
+    change_owner(node->scene, scene, now);
+
+    memset(node->value, 0, sizeof(node->value));
+    strncpy(node->value, (value != NULL)? value: "", LEN_RESIDENCY_VALUE_MAX - 1);
+    node->scene = scene;
+    node->since_ns = now;
+
+    entry = find_value(node, node->value);
+    if (entry != NULL)
+        entry->entries++;
+}
+
+int residency_dump(int fd)
+{
+    struct node_residency *node = NULL;
+    struct file *file = NULL;
+    int64_t now = clock_monotonic_ns();
+
+    dprintf(fd, "Node residency:\n");
+    for (int i = 0; i < NUM_RESIDENCY_NODE_MAX; i++) {
+        node = &nodes[i];
+        if (node->since_ns == 0 || (file = find_file_by_id(i)) == NULL)
+            continue;
+
+        dprintf(fd, "  %s: now=%s owner=%s\n", file->name
+            , (strlen(node->value) > 0)? node->value: "(released)"
+            , (node->scene != NULL)? node->scene: "-");
+        for (int j = 0; j < NUM_RESIDENCY_VALUE_MAX && node->values[j].entries > 0; j++) {
+            uint64_t time_ns = node->values[j].time_ns;
+
+            if (strcmp(node->values[j].value, node->value) == 0)
+                time_ns += now - node->since_ns;
+            dprintf(fd, "    %-16s %10llums entries=%u\n"
+                , (strlen(node->values[j].value) > 0)? node->values[j].value: "(released)"
+                , (unsigned long long)(time_ns / MS_TO_NS), node->values[j].entries);
+        }
+        if (node->other_ns > 0)
+            dprintf(fd, "    %-16s %10llums\n", "(other)"
+                , (unsigned long long)(node->other_ns / MS_TO_NS));
+    }
+
+    dprintf(fd, "Boosted time per scene:\n");
+    for (int i = 0; i < NUM_RESIDENCY_SCENE_MAX && scenes[i].name != NULL; i++) {
+        uint64_t node_ns[NUM_RESIDENCY_NODE_MAX];
+        uint64_t boosted_ns = 0;
+
+        pthread_mutex_lock(&owner_lock);
+        boosted_ns = scenes[i].boosted_ns;
+        if (scenes[i].owned > 0)
+            boosted_ns += now - scenes[i].since_ns;
+        pthread_mutex_unlock(&owner_lock);
+
+        memcpy(node_ns, scenes[i].node_ns, sizeof(node_ns));
+        for (int j = 0; j < NUM_RESIDENCY_NODE_MAX; j++) {
+            if (nodes[j].since_ns != 0 && nodes[j].scene == scenes[i].name)
+                node_ns[j] += now - nodes[j].since_ns;
+        }
+
+        dprintf(fd, "  %s: %llums\n", scenes[i].name, (unsigned long long)(boosted_ns / MS_TO_NS));
+        for (int j = 0; j < NUM_RESIDENCY_NODE_MAX; j++) {
+            if (node_ns[j] > 0 && (file = find_file_by_id(j)) != NULL)
+                dprintf(fd, "    %-28s %10llums\n", file->name, (unsigned long long)(node_ns[j] / MS_TO_NS));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_RESIDENCY_H
+#define INCLUDE_POWER_RESIDENCY_H
+
+#include <stdint.h>
+
+struct file;
+
+#define NUM_RESIDENCY_NODE_MAX            64
+#define NUM_RESIDENCY_VALUE_MAX           8
+#define NUM_RESIDENCY_SCENE_MAX           48
+#define LEN_RESIDENCY_VALUE_MAX           16
+
+/**
+ * struct value_residency - time a node spent at one effective value
+ * @value: the effective value, empty if no request is in force
+ * @time_ns: the accumulated time
+ * @entries: how many times the node switched to the value
+ */
+struct value_residency {
+    char value[LEN_RESIDENCY_VALUE_MAX];
+    uint64_t time_ns;
+    uint32_t entries;
+};
+
+/**
+ * struct node_residency - residency of one resource file
+ * @value: the effective value in force
+ * @scene: the scene owning the value in force, NULL if not boosted
+ * @since_ns: when the value in force was applied
+ * @values: time at every seen value
+ * @other_ns: time at the values that don't fit in values[]
+ */
+struct node_residency {
+    char value[LEN_RESIDENCY_VALUE_MAX];
+    const char *scene;
+    int64_t since_ns;
+    struct value_residency values[NUM_RESIDENCY_VALUE_MAX];
+    uint64_t other_ns;
+};
+
+/**
+ * struct scene_residency - boosted time caused by one scene
+ * @name: points to the scene name owned by the scene id table
+ * @owned: how many nodes the scene owns the value of now
+ * @since_ns: when @owned last became non-zero
+ * @boosted_ns: wall time the scene owned the value of at least one node
+ * @node_ns: boosted time per node, they add up past @boosted_ns
+ */
+struct scene_residency {
+    const char *name;
+    int owned;
+    int64_t since_ns;
+    uint64_t boosted_ns;
+    uint64_t node_ns[NUM_RESIDENCY_NODE_MAX];
+};
+
+void residency_update(const struct file *file, const char *value, const char *scene);
+int residency_dump(int fd);
+#endif
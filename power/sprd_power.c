@@ -19,7 +19,20 @@
 #include "sprd_power.h"
 #include "utils.h"
 #include "common.h"
+#include "boost_adapt.h"
+#include "hint_class.h"
 #include "hint_id.h"
+#include "hint_ring.h"
+#include "hint_server.h"
+#include "hint_trace.h"
+#include "input_boost.h"
+#include "lockstat.h"
+#include "psi_monitor.h"
+#include "stats.h"
+#include "thread_sched.h"
+#include "trace.h"
+#include "vfs.h"
+#include "write_latency.h"
 
 extern int scene_name_to_scene_id(char *scene_name);
 extern struct sprd_power_module power_impl;
@@ -37,10 +50,14 @@ int DEBUG_D = 0;
 // if Screenoff boost when Charging
 static int is_screenoff_ign_charge = 0;
 
+static void drain_queued(int64_t locked_ns);
+
 static void power_set_interactive(struct sprd_power_module __unused *module, int on)
 {
     struct sprd_power_module *pm = (struct sprd_power_module *)module;
 
+    HINT_TRACE(HINT_TRACE_INTERACTIVE, 0, &on);
+
     // get prop
     if (CC_UNLIKELY(!has_get_prop)) {
         power_hint_enable = property_get_int32(POWER_HINT_ENABLE_PROP, 1);
@@ -59,9 +76,14 @@ static void power_set_interactive(struct sprd_power_module __unused *module, int
     ENTER("%d", on);
 
     if (is_in_interactive != !!on) {
+        struct stats_ctx ctx;
+
         is_in_interactive = !!on;
 
-        pthread_mutex_lock(&pm->lock);
+        stats_begin(&ctx, STATS_SRC_INTERACTIVE, 0);
+        power_lock(__func__);
+        stats_locked(&ctx);
+        drain_queued(ctx.locked);
         if (power_mode == POWER_HINT_VENDOR_MODE_NORMAL) {
             if (is_in_interactive)  {
                 boost(POWER_HINT_VENDOR_SCREEN_ON_PULSE, 0, 1, BOOST_DURATION_DEFAULT);
@@ -87,7 +109,8 @@ static void power_set_interactive(struct sprd_power_module __unused *module, int
             usleep(60000);
             boost(POWER_HINT_VENDOR_SCREEN_OFF, 0, 1, 0);
         }
-        pthread_mutex_unlock(&pm->lock);
+        power_unlock();
+        stats_end(&ctx);
     }
     EXIT("%d", on);
 }
@@ -99,6 +122,7 @@ static void handle_power_mode_switch(int mode, int enable, int value)
     if (CC_UNLIKELY((power_mode == mode && enable == 1) || (power_mode != mode && enable == 0)))
         return;
 
+    flight_record(FR_EV_MODE, __func__, FR_NODE_NONE, enable? mode: POWER_HINT_VENDOR_MODE_NORMAL);
     if (enable) {
         ALOGD("switch mode: 0x%08x -> 0x%08x", power_mode, mode);
     } else {
@@ -124,32 +148,38 @@ static void handle_power_mode_switch(int mode, int enable, int value)
     }
 }
 
-static void sprd_power_hint(struct sprd_power_module *module, power_hint_t hint,
-                             void *data)
-{
-    struct sprd_power_module *pm = (struct sprd_power_module *)module;
-    static bool is_launching = false;
-
-    if (CC_UNLIKELY(power_hint_enable == 0)) return;
-
-    ALOGD_IF(DEBUG_V, "Enter %s:(%d:%d)", __func__, hint, ((data!=NULL)?(*(int*)data):0));
-    pthread_mutex_lock(&pm->lock);
-    if (CC_UNLIKELY(!pm->init_done)) {
-        pthread_mutex_unlock(&pm->lock);
-        ALOGE("%s: power hint is not inited", __func__);
-        return;
-    }
+static bool is_launching = false;
+// Ends the launch boost if its release doesn't come, see boost_adapt_launch()
+static timer_t launch_timer;
 
-#if 0
-    // TODO: delete to support boost for all modes
-    // Do not support boost in non-normal mode
-    if ((power_mode != POWER_HINT_VENDOR_MODE_NORMAL)
-        && (hint < POWER_HINT_VENDOR_MODE_NORMAL || hint > POWER_HINT_VENDOR_SCREEN_ON)) {
-        pthread_mutex_unlock(&pm->lock);
-        return;
+/*
+ * Whether handle_hint() only enters or exits a scene for @hint, so it can
+ * run alongside other such hints with the HAL lock held shared.
+ */
+static bool hint_is_shared(power_hint_t hint)
+{
+#ifdef BOOST_SPECIFICED
+    switch ((int)hint) {
+        case POWER_HINT_LAUNCH:
+        case POWER_HINT_LOW_POWER:
+        case POWER_HINT_VENDOR_MODE_NORMAL:
+        case POWER_HINT_VENDOR_MODE_LOW_POWER:
+        case POWER_HINT_VENDOR_MODE_POWER_SAVE:
+        case POWER_HINT_VENDOR_MODE_ULTRA_POWER_SAVE:
+        case POWER_HINT_VENDOR_MODE_PERFORMANCE:
+            return false;
+        default:
+            return true;
     }
+#else
+    // _boost() sets every resource file then, no scene is independent
+    return false;
 #endif
+}
 
+// Called with the HAL lock held, shared if hint_is_shared()
+static void handle_hint(power_hint_t hint, void *data)
+{
     switch (hint) {
         case POWER_HINT_INTERACTION:
         {
@@ -168,12 +198,13 @@ static void sprd_power_hint(struct sprd_power_module *module, power_hint_t hint,
             if (duration < BOOST_DURATION_DEFAULT || duration > BOOST_DURATION_MAX)
                 duration = BOOST_DURATION_DEFAULT;
 
-            boost(POWER_HINT_INTERACTION, 0, 1, duration);
+            boost(POWER_HINT_INTERACTION, 0, 1, boost_adapt_interaction(duration));
             break;
         }
         case POWER_HINT_LAUNCH:
         {
             bool launch = (data != NULL)? true: false;
+            int window = 0;
 
             if (launch) {
                 if (!is_in_interactive) {
@@ -182,10 +213,14 @@ static void sprd_power_hint(struct sprd_power_module *module, power_hint_t hint,
                 }
             }
 
+            // Learn from every release, even of a launch the window ended
+            window = boost_adapt_launch(launch);
             if (is_launching == launch) break;
 
             is_launching = launch;
             boost(POWER_HINT_LAUNCH, 0, (is_launching? 1: 0), 0);
+            if (boost_adapt)
+                sprd_timer_settime(launch_timer, window);
             break;
         }
         case POWER_HINT_VSYNC:
@@ -240,11 +275,300 @@ static void sprd_power_hint(struct sprd_power_module *module, power_hint_t hint,
         }
 
     }
+}
+
+// Called with the HAL lock held exclusive, @locked_ns is when it was taken
+static void apply_queued(const struct hint_queued *ops, int count, int64_t locked_ns)
+{
+    int data = 0;
+
+    begin_deferred_requests();
+    for (int i = 0; i < count; i++) {
+        data = ops[i].op.data;
+        hint_class_locked(HINT_CLASS_BACKGROUND, ops[i].enqueue_ns, locked_ns);
+        flight_record(FR_EV_HINT, __func__, FR_NODE_NONE
+            , ((int64_t)ops[i].op.hint << 32) | (uint32_t)(ops[i].op.enable? data: 0));
+        handle_hint(ops[i].op.hint, ops[i].op.enable? &data: NULL);
+    }
+    apply_deferred_requests();
+}
+
+/*
+ * Apply the background hints still queued before a hint that holds the
+ * HAL lock exclusive runs, they came first. Power hint may have been
+ * disabled since they were queued.
+ */
+static void drain_queued(int64_t locked_ns)
+{
+    struct hint_queued ops[NUM_HINT_CLASS_QUEUE_MAX];
+    int count = hint_class_take(ops);
+
+    if (count > 0 && power_hint_enable != 0)
+        apply_queued(ops, count, locked_ns);
+}
+
+// The adaptive window of the launch in progress is over
+static void launch_timeout(void)
+{
+    struct stats_ctx ctx;
+    int window = 0;
+
+    stats_begin(&ctx, STATS_SRC_TIMER, 0);
+    power_lock(__func__);
+    stats_locked(&ctx);
+    drain_queued(ctx.locked);
+    window = boost_adapt_launch_timeout();
+    if (window > 0) {
+        sprd_timer_settime(launch_timer, window);
+    } else if (window == 0 && is_launching) {
+        ALOGD("%s: end the launch boost, no release came", __func__);
+        flight_record(FR_EV_HINT, __func__, FR_NODE_NONE, (int64_t)POWER_HINT_LAUNCH << 32);
+        is_launching = false;
+        boost(POWER_HINT_LAUNCH, 0, 0, 0);
+    }
+    power_unlock();
+    stats_end(&ctx);
+}
+
+void power_boost_adapt_init(void)
+{
+    boost_adapt_init();
+    if (boost_adapt)
+        add_timing_timer(&launch_timer, launch_timeout);
+}
+
+/*
+ * Takes the HAL lock for a call of hint class @cls on behalf of @site,
+ * shared if @shared, after stats_begin(). Taken exclusive, the queued
+ * background hints are applied first, they came before.
+ * return: false, with the lock released again, if the HAL isn't inited
+ */
+static bool lock_for_hints(struct sprd_power_module *pm, struct stats_ctx *ctx, int cls, bool shared
+    , const char *site)
+{
+    hint_class_enter(cls);
+    if (shared)
+        power_lock_shared(site);
+    else
+        power_lock(site);
+    stats_locked(ctx);
+    hint_class_locked(cls, ctx->enter, ctx->locked);
+    if (CC_UNLIKELY(!pm->init_done)) {
+        power_unlock();
+        hint_class_exit(cls);
+        stats_end(ctx);
+        ALOGE("%s: power hint is not inited", site);
+        return false;
+    }
+
+    if (!shared)
+        drain_queued(ctx->locked);
+
+    return true;
+}
+
+static void unlock_for_hints(struct stats_ctx *ctx, int cls)
+{
+    power_unlock();
+    hint_class_exit(cls);
+    stats_end(ctx);
+}
 
-    pthread_mutex_unlock(&pm->lock);
+/*
+ * Handles @count hints under one acquisition of the HAL lock on behalf of
+ * @site, shared for a single hint that only enters or exits a scene.
+ * Each node a batch touches is arbitrated and written once, after all
+ * its hints are in, so an exit followed by an enter of scenes sharing
+ * a node leaves it at the final value without the transient one.
+ * return: whether the HAL was inited
+ */
+static bool dispatch_hints(struct sprd_power_module *pm, int cls, const struct power_hint_op *ops, int count
+    , const char *site)
+{
+    struct stats_ctx ctx;
+    int data = 0;
+
+    stats_begin(&ctx, STATS_SRC_HINT, ops[0].hint);
+    if (!lock_for_hints(pm, &ctx, cls
+            , count == 1 && hint_is_shared(ops[0].hint) && resource_defaults_read(), site))
+        return false;
+
+    if (count > 1)
+        begin_deferred_requests();
+    for (int i = 0; i < count; i++) {
+        data = ops[i].data;
+        flight_record(FR_EV_HINT, site, FR_NODE_NONE
+            , ((int64_t)ops[i].hint << 32) | (uint32_t)(ops[i].enable? data: 0));
+        handle_hint(ops[i].hint, ops[i].enable? &data: NULL);
+    }
+    if (count > 1)
+        apply_deferred_requests();
+
+    unlock_for_hints(&ctx, cls);
+    return true;
+}
+
+static void sprd_power_hint(struct sprd_power_module *module, power_hint_t hint,
+                             void *data)
+{
+    struct sprd_power_module *pm = (struct sprd_power_module *)module;
+    struct power_hint_op op = { hint, (data != NULL)? 1: 0, (data != NULL)? *(int *)data: 0 };
+
+    HINT_TRACE(HINT_TRACE_HINT, hint, (int *)data);
+    if (CC_UNLIKELY(power_hint_enable == 0)) return;
+
+    ALOGD_IF(DEBUG_V, "Enter %s:(%d:%d)", __func__, hint, ((data!=NULL)?(*(int*)data):0));
+    // The input boost entered the scene on the event this hint is about
+    if (input_boost_dedup(hint, (const int *)data))
+        return;
+
+    // Background hints are applied by the power_hint_bg thread
+    if (hint_class_defer(hint, (const int *)data))
+        return;
+
+    dispatch_hints(pm, hint_class_of(hint), &op, 1, __func__);
     ALOGD_IF(DEBUG_V, "Exit %s:(%d:%d)", __func__, hint, ((data!=NULL)?(*(int*)data):0));
 }
 
+/*
+ * The scene is entered as for the framework hint, but the call isn't
+ * traced: a replay has no input thread to drop the later hint with.
+ */
+int power_input_boost(struct sprd_power_module *pm, power_hint_t hint, int duration)
+{
+    struct stats_ctx ctx;
+    int cls = hint_class_of(hint);
+    bool exclusive = false;
+    int ret = 0;
+
+    if (CC_UNLIKELY(power_hint_enable == 0)) return 0;
+
+    stats_begin(&ctx, STATS_SRC_INPUT, 0);
+    flight_record(FR_EV_HINT, __func__, FR_NODE_NONE, ((int64_t)hint << 32) | (uint32_t)duration);
+    hint_class_enter(cls);
+    if (hint_is_shared(hint) && resource_defaults_read())
+        power_lock_shared(__func__);
+    else {
+        power_lock(__func__);
+        exclusive = true;
+    }
+    stats_locked(&ctx);
+    hint_class_locked(cls, ctx.enter, ctx.locked);
+    if (exclusive && pm->init_done)
+        drain_queued(ctx.locked);
+    // The power key turns a screen that is on off
+    if (pm->init_done && ((int)hint != POWER_HINT_VENDOR_INTERACTION_WAKEUP || !is_in_interactive))
+        ret = boost(hint, 0, 1, duration);
+    power_unlock();
+    hint_class_exit(cls);
+    stats_end(&ctx);
+
+    return ret;
+}
+
+int power_psi_escalate(struct sprd_power_module *pm, const char *name, int enable
+    , unsigned int *generation)
+{
+    struct stats_ctx ctx;
+    int scene_id = 0;
+    int subtype = 0;
+    int ret = 0;
+
+    if (CC_UNLIKELY(power_hint_enable == 0)) return 0;
+    if (scene_name_to_id_subtype(name, &scene_id, &subtype) == 0) return 0;
+
+    stats_begin(&ctx, STATS_SRC_PSI, 0);
+    power_lock(__func__);
+    stats_locked(&ctx);
+    if (pm->init_done)
+        drain_queued(ctx.locked);
+    if (!enable && *generation != clear_generation)
+        ALOGD("%s: %s was cleared since it was entered", __func__, name);
+    else if (pm->init_done)
+        ret = boost(scene_id, subtype, enable, 0);
+    *generation = clear_generation;
+    power_unlock();
+    stats_end(&ctx);
+
+    return ret;
+}
+
+// The background hints queued by hint_class_defer(), applied in order as a batch
+void power_hint_apply_queued(struct sprd_power_module *pm)
+{
+    struct stats_ctx ctx;
+
+    stats_begin(&ctx, STATS_SRC_HINT, 0);
+    power_lock(__func__);
+    stats_locked(&ctx);
+    if (pm->init_done)
+        drain_queued(ctx.locked);
+    power_unlock();
+    stats_end(&ctx);
+}
+
+/**
+ * power_hint_batch - handle @count hints as one, as powerHint() would each
+ *
+ * The batch is as urgent as its most urgent hint. Returns @count, or
+ * -ENODEV if power hint is disabled or not inited.
+ */
+int power_hint_batch(struct sprd_power_module *pm, const struct power_hint_op *ops, int count)
+{
+    int cls = HINT_CLASS_MAX - 1;
+    int data = 0;
+
+    if (CC_UNLIKELY(power_hint_enable == 0)) return -ENODEV;
+    if (ops == NULL || count <= 0) return 0;
+
+    ALOGD_IF(DEBUG_V, "Enter %s: count:%d", __func__, count);
+    for (int i = 0; i < count; i++) {
+        data = ops[i].data;
+        HINT_TRACE(HINT_TRACE_HINT, ops[i].hint, ops[i].enable? &data: NULL);
+        if (hint_class_of(ops[i].hint) < cls)
+            cls = hint_class_of(ops[i].hint);
+    }
+
+    if (!dispatch_hints(pm, cls, ops, count, __func__))
+        return -ENODEV;
+    ALOGD_IF(DEBUG_V, "Exit %s: count:%d", __func__, count);
+
+    return count;
+}
+
+/**
+ * power_boost_batch - enter or exit @count scenes under one lock acquisition
+ *
+ * Returns the number of scenes applied, or -ENODEV if power hint is
+ * disabled or not inited.
+ */
+int power_boost_batch(struct sprd_power_module *module, const struct hint_msg_boost *boosts, int count)
+{
+    struct sprd_power_module *pm = (struct sprd_power_module *)module;
+    struct stats_ctx ctx;
+    int applied = 0;
+
+    if (CC_UNLIKELY(power_hint_enable == 0)) return -ENODEV;
+
+    stats_begin(&ctx, STATS_SRC_SOCKET, 0);
+    if (!lock_for_hints(pm, &ctx, HINT_CLASS_NORMAL, false, __func__))
+        return -ENODEV;
+
+    begin_deferred_requests();
+    for (int i = 0; i < count; i++) {
+        if (boosts[i].duration < 0)
+            continue;
+
+        applied += boost(boosts[i].scene_id, boosts[i].subtype, !!boosts[i].enable
+            , (boosts[i].duration > BOOST_DURATION_MAX)? BOOST_DURATION_MAX: boosts[i].duration);
+    }
+    apply_deferred_requests();
+
+    unlock_for_hints(&ctx, HINT_CLASS_NORMAL);
+
+    return applied;
+}
+
 static int get_scene_id(struct sprd_power_module *module, char *scene_name)
 {
     struct sprd_power_module *pm = (struct sprd_power_module *)module;
@@ -253,26 +577,27 @@ static int get_scene_id(struct sprd_power_module *module, char *scene_name)
     if (CC_UNLIKELY(power_hint_enable == 0) || scene_name == NULL)
         return 0;
 
-    pthread_mutex_lock(&pm->lock);
+    power_lock_shared(__func__);
     if (CC_UNLIKELY(!pm->init_done)) {
-        pthread_mutex_unlock(&pm->lock);
+        power_unlock();
         ALOGE("%s: PowerHAL is not inited", __func__);
         return 0;
     }
-    pthread_mutex_unlock(&pm->lock);
+    power_unlock();
 
     return scene_name_to_scene_id(scene_name);
 }
 
-static void ctrl_power_hint(struct sprd_power_module *module, int enable) {
-    struct sprd_power_module *pm = (struct sprd_power_module *)module;
+static void ctrl_power_hint(struct sprd_power_module __unused *module, int enable) {
+    HINT_TRACE(HINT_TRACE_CTRL, 0, &enable);
 
-    pthread_mutex_lock(&pm->lock);
+    power_lock(__func__);
+    drain_queued(stats_now_ns());
 
     if (power_hint_enable != enable) {
         power_hint_enable = enable;
     } else {
-        pthread_mutex_unlock(&pm->lock);
+        power_unlock();
         return;
     }
 
@@ -283,7 +608,7 @@ static void ctrl_power_hint(struct sprd_power_module *module, int enable) {
         ALOGD("%s: Power Hint enable!", __func__);
     }
 
-    pthread_mutex_unlock(&pm->lock);
+    power_unlock();
 }
 
 void set_feature(struct sprd_power_module *module, feature_t feature, int state)
@@ -299,30 +624,65 @@ void set_feature(struct sprd_power_module *module, feature_t feature, int state)
 #endif
 }
 
+int power_dump(struct sprd_power_module __unused *pm, int fd)
+{
+    if (fd < 0) return -EINVAL;
+
+    stats_dump(fd);
+
+    power_lock(__func__);
+    residency_dump(fd);
+    lock_profile_dump(fd);
+    write_latency_dump(fd);
+    boost_adapt_dump(fd);
+    power_unlock();
+    thread_sched_dump(fd);
+    hint_class_dump(fd);
+    hint_ring_dump(fd);
+    input_boost_dump(fd);
+    psi_monitor_dump(fd);
+
+    return flight_recorder_dump(fd);
+}
+
 static void power_init(struct sprd_power_module __unused *module) {
 
     struct sprd_power_module *pm = (struct sprd_power_module *)module;
 
     ALOGD_IF(DEBUG_V, "Delete get prop");
     //power_hint_enable = property_get_int32(POWER_HINT_ENABLE_PROP, 1);
-    if (access(PATH_POWER_HINT_DISABLE, F_OK) == 0) {
+    if (vfs_access(PATH_POWER_HINT_DISABLE, F_OK) == 0) {
         power_hint_enable = 0;
     }
     if (CC_UNLIKELY(power_hint_enable == 0)) return;
 
     if (CC_UNLIKELY(pm == NULL || pm->init_done)) return;
 
-    pthread_mutex_lock(&pm->lock);
+    trace_init();
+    hint_trace_init();
+    flight_recorder_install_crash_handler();
+
+    power_lock(__func__);
     // Read config file
     if (config_read() == 0) {
-        pthread_mutex_unlock(&pm->lock);
+        power_unlock();
         return;
     }
+    stats_init();
+    write_latency_init();
+    power_boost_adapt_init();
 
     // Must at the bottom
     start_thread_for_timing_request(module);
     pm->init_done = true;
-    pthread_mutex_unlock(&pm->lock);
+    power_unlock();
+
+    // The workers that apply hints and boost on their own, start them when inited
+    hint_class_start(module);
+    hint_ring_init(module);
+    hint_server_init(module);
+    input_boost_init(module);
+    psi_monitor_init(module);
 }
 
 struct sprd_power_module power_impl = {
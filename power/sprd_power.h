@@ -112,6 +112,18 @@ typedef struct {
     power_state_subsystem_sleep_state_t *states;
 } power_state_subsystem_t;
 
+/**
+ * struct power_hint_op - one hint of power_hint_batch()
+ * @hint: the hint, as passed to powerHint()
+ * @enable: if 0 powerHint() is passed NULL data, which ends most hints
+ * @data: the int the data of powerHint() points to if @enable
+ */
+struct power_hint_op {
+    power_hint_t hint;
+    int enable;
+    int data;
+};
+
 struct sprd_power_module {
 
     /*
@@ -253,6 +265,7 @@ struct sprd_power_module {
      */
     void (*ctrl_power_hint)(struct sprd_power_module *module, int enable);
 
+    /* Unused, the HAL takes power_lock() instead; kept for the layout */
     pthread_mutex_t lock;
 
     /* Indicate if has call init() */
@@ -262,4 +275,18 @@ struct sprd_power_module {
     int isCharging;
 };
 
+/*
+ * Writes the HAL statistics and the flight recorder to @fd as text. Not
+ * a member: the service is built against the layout above. Reached
+ * through HINT_MSG_DUMP of the hint server.
+ */
+int power_dump(struct sprd_power_module *pm, int fd);
+
+/*
+ * Handles @count hints under one lock acquisition, writing every node
+ * they touch once with its final value. Module-private like power_dump(),
+ * reached through HINT_MSG_HINT of the hint server.
+ */
+int power_hint_batch(struct sprd_power_module *pm, const struct power_hint_op *ops, int count);
+
 #endif
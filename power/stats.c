@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cutils/compiler.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "utils.h"
+#include "common.h"
+#include "stats.h"
+#include "config.h"
+#include "vfs.h"
+
+/**
+ * struct scene_stats - latency of the calls that applied a scene
+ * @name: points to the scene name owned by the scene id table
+ * @hists: one histogram per STATS_PHASE_*
+ */
+struct scene_stats {
+    const char *name;
+    struct hist hists[STATS_PHASE_MAX];
+};
+
+struct hint_count {
+    int hint;
+    uint64_t count;
+};
+
+struct thread_cpu {
+    int tid;
+    int src;
+    uint64_t cpu_ns;
+};
+
+static struct scene_stats scene_stats[NUM_STATS_SCENE_MAX];
+static struct hint_count hint_counts[NUM_STATS_HINT_MAX];
+static struct thread_cpu thread_cpus[NUM_STATS_THREAD_MAX];
+static uint64_t src_cpu_ns[STATS_SRC_MAX];
+static uint64_t src_calls[STATS_SRC_MAX];
+static int64_t last_flush_ns = 0;
+// Rewrites PATH_POWER_STATS on the timer thread, not on the one ending a call
+static timer_t flush_timer;
+static bool flush_timer_added = false;
+
+static const char *phase_names[STATS_PHASE_MAX] = {
+    "total", "lock_wait", "arbitration", "io",
+};
+
+static const char *src_names[STATS_SRC_MAX] = {
+    "hint", "interactive", "timer", "socket", "input", "psi",
+};
+
+// The call being measured by current thread
+static __thread struct stats_ctx *current_ctx = NULL;
+
+static int64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * SEC_TO_MS * MS_TO_NS + ts.tv_nsec;
+}
+
+int64_t stats_now_ns(void)
+{
+    return clock_ns(CLOCK_MONOTONIC);
+}
+
+static int hist_index(uint64_t value)
+{
+    int msb = 0;
+    int shift = 0;
+
+    if (value < (1 << HIST_SUB_BUCKET_BITS))
+        return (int)value;
+
+    if (value >= (1ULL << HIST_MAGNITUDE_MAX))
+        value = (1ULL << HIST_MAGNITUDE_MAX) - 1;
+
+    msb = 63 - __builtin_clzll(value);
+    shift = msb - HIST_SUB_BUCKET_BITS;
+
+    return ((shift + 1) << HIST_SUB_BUCKET_BITS)
+        + (int)((value >> shift) & ((1 << HIST_SUB_BUCKET_BITS) - 1));
+}
+
+// The highest value that falls into bucket @index
+static uint64_t hist_bucket_value(int index)
+{
+    int shift = 0;
+    uint64_t sub = 0;
+
+    if (index < (1 << HIST_SUB_BUCKET_BITS))
+        return index;
+
+    shift = (index >> HIST_SUB_BUCKET_BITS) - 1;
+    sub = index & ((1 << HIST_SUB_BUCKET_BITS) - 1);
+
+    return ((((1ULL << HIST_SUB_BUCKET_BITS) | sub) + 1) << shift) - 1;
+}
+
+void hist_add(struct hist *hist, uint64_t value_us)
+{
+    uint64_t max = 0;
+
+    __atomic_fetch_add(&hist->buckets[hist_index(value_us)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->sum_us, value_us, __ATOMIC_RELAXED);
+
+    max = __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+    while (value_us > max
+        && !__atomic_compare_exchange_n(&hist->max_us, &max, value_us, true
+            , __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+uint64_t hist_percentile(const struct hist *hist, int percent)
+{
+    uint64_t count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    uint64_t target = 0;
+    uint64_t seen = 0;
+
+    if (count == 0) return 0;
+
+    target = (count * percent + 99) / 100;
+    for (int i = 0; i < NUM_HIST_BUCKET; i++) {
+        seen += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        if (seen >= target) {
+            uint64_t value = hist_bucket_value(i);
+            uint64_t max = __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+            return (value < max)? value: max;
+        }
+    }
+
+    return __atomic_load_n(&hist->max_us, __ATOMIC_RELAXED);
+}
+
+void hist_dump(int fd, const char *name, const struct hist *hist)
+{
+    uint64_t count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+
+    if (count == 0) return;
+
+    dprintf(fd, "    %-12s count=%llu avg=%lluus p50=%lluus p90=%lluus p99=%lluus max=%lluus\n"
+        , name, (unsigned long long)count
+        , (unsigned long long)(__atomic_load_n(&hist->sum_us, __ATOMIC_RELAXED) / count)
+        , (unsigned long long)hist_percentile(hist, 50)
+        , (unsigned long long)hist_percentile(hist, 90)
+        , (unsigned long long)hist_percentile(hist, 99)
+        , (unsigned long long)__atomic_load_n(&hist->max_us, __ATOMIC_RELAXED));
+}
+
+// Find the slot of a scene, the name pointer is the key
+static struct scene_stats *find_scene_stats(const char *name)
+{
+    for (int i = 0; i < NUM_STATS_SCENE_MAX; i++) {
+        const char *slot = __atomic_load_n(&scene_stats[i].name, __ATOMIC_ACQUIRE);
+
+        if (slot == name)
+            return &scene_stats[i];
+        if (slot == NULL) {
+            const char *expected = NULL;
+            if (__atomic_compare_exchange_n(&scene_stats[i].name, &expected, name, false
+                    , __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) || expected == name)
+                return &scene_stats[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void count_hint(int hint)
+{
+    for (int i = 0; i < NUM_STATS_HINT_MAX; i++) {
+        int slot = __atomic_load_n(&hint_counts[i].hint, __ATOMIC_ACQUIRE);
+
+        if (slot == 0) {
+            int expected = 0;
+            if (__atomic_compare_exchange_n(&hint_counts[i].hint, &expected, hint, false
+                    , __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                slot = hint;
+            else
+                slot = expected;
+        }
+
+        if (slot == hint) {
+            __atomic_fetch_add(&hint_counts[i].count, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
+
+static void account_thread_cpu(int src, uint64_t cpu_ns)
+{
+    int tid = gettid();
+
+    __atomic_fetch_add(&src_cpu_ns[src], cpu_ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&src_calls[src], 1, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < NUM_STATS_THREAD_MAX; i++) {
+        int slot = __atomic_load_n(&thread_cpus[i].tid, __ATOMIC_ACQUIRE);
+
+        if (slot == 0) {
+            int expected = 0;
+            if (__atomic_compare_exchange_n(&thread_cpus[i].tid, &expected, tid, false
+                    , __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                thread_cpus[i].src = src;
+                slot = tid;
+            } else {
+                slot = expected;
+            }
+        }
+
+        if (slot == tid) {
+            __atomic_fetch_add(&thread_cpus[i].cpu_ns, cpu_ns, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
+
+void stats_begin(struct stats_ctx *ctx, int src, int hint)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->src = src;
+    ctx->hint = hint;
+    ctx->cpu_enter = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    ctx->enter = stats_now_ns();
+    ctx->locked = ctx->enter;
+    current_ctx = ctx;
+}
+
+void stats_locked(struct stats_ctx *ctx)
+{
+    ctx->locked = stats_now_ns();
+}
+
+void stats_end(struct stats_ctx *ctx)
+{
+    struct scene_stats *stats = NULL;
+    int64_t now = stats_now_ns();
+    int64_t last = (ctx->last_io > 0)? ctx->last_io: now;
+    int64_t arbitration = now - ctx->locked - ctx->io_ns;
+    int64_t flushed = 0;
+
+    current_ctx = NULL;
+    account_thread_cpu(ctx->src, clock_ns(CLOCK_THREAD_CPUTIME_ID) - ctx->cpu_enter);
+    if (ctx->hint != 0)
+        count_hint(ctx->hint);
+
+    if (ctx->scene != NULL && (stats = find_scene_stats(ctx->scene)) != NULL) {
+        hist_add(&stats->hists[STATS_PHASE_TOTAL], (last - ctx->enter) / MS_TO_US);
+        hist_add(&stats->hists[STATS_PHASE_LOCK], (ctx->locked - ctx->enter) / MS_TO_US);
+        hist_add(&stats->hists[STATS_PHASE_ARBITRATION]
+            , ((arbitration > 0)? arbitration: 0) / MS_TO_US);
+        hist_add(&stats->hists[STATS_PHASE_IO], ctx->io_ns / MS_TO_US);
+    }
+
+    flushed = __atomic_load_n(&last_flush_ns, __ATOMIC_RELAXED);
+    if (flush_timer_added && now - flushed > STATS_FLUSH_INTERVAL_MS * MS_TO_NS
+        && __atomic_compare_exchange_n(&last_flush_ns, &flushed, now, false
+            , __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        sprd_timer_settime(flush_timer, 1);
+}
+
+/**
+ * stats_set_scene - called by boost(), attribute current call to @scene
+ */
+void stats_set_scene(const char *scene)
+{
+    if (current_ctx != NULL && current_ctx->scene == NULL)
+        current_ctx->scene = scene;
+}
+
+/**
+ * stats_get_scene - the first scene applied by the call of this thread, NULL if none
+ */
+const char *stats_get_scene(void)
+{
+    return (current_ctx != NULL)? current_ctx->scene: NULL;
+}
+
+int64_t stats_io_begin(void)
+{
+    if (current_ctx == NULL) return 0;
+
+    return stats_now_ns();
+}
+
+void stats_io_end(int64_t start)
+{
+    int64_t now;
+
+    if (current_ctx == NULL || start == 0) return;
+
+    now = stats_now_ns();
+    current_ctx->io_ns += now - start;
+    current_ctx->last_io = now;
+}
+
+int stats_dump(int fd)
+{
+    char *name = NULL;
+
+    dprintf(fd, "Hint latency per scene:\n");
+    for (int i = 0; i < NUM_STATS_SCENE_MAX; i++) {
+        if (scene_stats[i].name == NULL)
+            continue;
+        dprintf(fd, "  %s:\n", scene_stats[i].name);
+        for (int j = 0; j < STATS_PHASE_MAX; j++)
+            hist_dump(fd, phase_names[j], &scene_stats[i].hists[j]);
+    }
+
+    dprintf(fd, "Hint count:\n");
+    for (int i = 0; i < NUM_STATS_HINT_MAX; i++) {
+        if (hint_counts[i].hint == 0)
+            continue;
+        name = scene_id_to_string(hint_counts[i].hint, 0);
+        dprintf(fd, "  0x%08x %-24s %llu\n", hint_counts[i].hint, (name != NULL)? name: "-"
+            , (unsigned long long)__atomic_load_n(&hint_counts[i].count, __ATOMIC_RELAXED));
+    }
+
+    dprintf(fd, "HAL cpu time:\n");
+    for (int i = 0; i < STATS_SRC_MAX; i++) {
+        dprintf(fd, "  %-12s calls=%llu cpu=%lluus\n", src_names[i]
+            , (unsigned long long)__atomic_load_n(&src_calls[i], __ATOMIC_RELAXED)
+            , (unsigned long long)__atomic_load_n(&src_cpu_ns[i], __ATOMIC_RELAXED) / MS_TO_US);
+    }
+    for (int i = 0; i < NUM_STATS_THREAD_MAX; i++) {
+        if (thread_cpus[i].tid == 0)
+            continue;
+        dprintf(fd, "  tid %-8d %-12s cpu=%lluus\n", thread_cpus[i].tid, src_names[thread_cpus[i].src]
+            , (unsigned long long)__atomic_load_n(&thread_cpus[i].cpu_ns, __ATOMIC_RELAXED) / MS_TO_US);
+    }
+
+    return 0;
+}
+
+/**
+ * stats_flush_file - rewrite PATH_POWER_STATS
+ */
+void stats_flush_file(void)
+{
+    int fd = -1;
+
+    __atomic_store_n(&last_flush_ns, stats_now_ns(), __ATOMIC_RELAXED);
+    fd = vfs_open(PATH_POWER_STATS, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        ALOGD_IF(DEBUG_V, "open %s failed: %s", PATH_POWER_STATS, strerror(errno));
+        return;
+    }
+    stats_dump(fd);
+    vfs_close(fd);
+}
+
+static void flush_timeout(void)
+{
+    stats_flush_file();
+}
+
+/**
+ * stats_init - have the timer thread flush the statistics, called before
+ * start_thread_for_timing_request()
+ */
+void stats_init(void)
+{
+    flush_timer_added = (add_timing_timer(&flush_timer, flush_timeout) == 0);
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_STATS_H
+#define INCLUDE_POWER_STATS_H
+
+#include <stdint.h>
+#include <linux/time.h>
+
+#define PATH_POWER_STATS                  "/data/vendor/power/hint_stats.txt"
+#define STATS_FLUSH_INTERVAL_MS           60000L
+
+#define NUM_STATS_SCENE_MAX               48
+#define NUM_STATS_HINT_MAX                64
+#define NUM_STATS_THREAD_MAX              24
+
+/*
+ * Log-linear (HDR style) histogram of microseconds: every power of two
+ * is split into 1 << HIST_SUB_BUCKET_BITS buckets, so the relative error
+ * of a reported percentile is bounded by 25%.
+ */
+#define HIST_SUB_BUCKET_BITS              2
+#define HIST_MAGNITUDE_MAX                24
+#define NUM_HIST_BUCKET                   ((HIST_MAGNITUDE_MAX - HIST_SUB_BUCKET_BITS + 1) \
+                                                << HIST_SUB_BUCKET_BITS)
+
+/**
+ * struct hist - latency histogram, updated with relaxed atomics
+ * @buckets: sample count of every bucket
+ * @count: total sample count
+ * @sum_us: sum of all samples
+ * @max_us: the biggest sample
+ */
+struct hist {
+    uint32_t buckets[NUM_HIST_BUCKET];
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+};
+
+enum {
+    STATS_PHASE_TOTAL = 0,
+    STATS_PHASE_LOCK,
+    STATS_PHASE_ARBITRATION,
+    STATS_PHASE_IO,
+    STATS_PHASE_MAX,
+};
+
+enum {
+    STATS_SRC_HINT = 0,
+    STATS_SRC_INTERACTIVE,
+    STATS_SRC_TIMER,
+    STATS_SRC_SOCKET,
+    STATS_SRC_INPUT,
+    STATS_SRC_PSI,
+    STATS_SRC_MAX,
+};
+
+/**
+ * struct stats_ctx - the measurement of one entry point call, lives on stack
+ * @src: which entry point, STATS_SRC_*
+ * @hint: the hint id, 0 if the call is not a hint
+ * @scene: the first scene applied by the call
+ * @enter: monotonic time at entry
+ * @locked: monotonic time when the HAL lock was acquired
+ * @last_io: monotonic time when the last write finished
+ * @cpu_enter: thread cpu time at entry
+ * @io_ns: time spent in sysfs writes
+ */
+struct stats_ctx {
+    int src;
+    int hint;
+    const char *scene;
+    int64_t enter;
+    int64_t locked;
+    int64_t last_io;
+    int64_t cpu_enter;
+    int64_t io_ns;
+};
+
+int64_t stats_now_ns(void);
+
+void stats_begin(struct stats_ctx *ctx, int src, int hint);
+void stats_locked(struct stats_ctx *ctx);
+void stats_end(struct stats_ctx *ctx);
+
+void stats_set_scene(const char *scene);
+const char *stats_get_scene(void);
+int64_t stats_io_begin(void);
+void stats_io_end(int64_t start);
+
+void hist_add(struct hist *hist, uint64_t value_us);
+uint64_t hist_percentile(const struct hist *hist, int percent);
+void hist_dump(int fd, const char *name, const struct hist *hist);
+
+/*
+ * With stats_init() called, the first stats_end() and then one at most
+ * every STATS_FLUSH_INTERVAL_MS has the timer thread rewrite
+ * PATH_POWER_STATS.
+ */
+void stats_init(void);
+int stats_dump(int fd);
+void stats_flush_file(void);
+#endif
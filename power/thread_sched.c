@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sched.h>
+#include <stdio.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+#include "common.h"
+#include "utils.h"
+#include "thread_sched.h"
+
+static const char *thread_names[THREAD_MAX] = {
+    [THREAD_TIMER] = "timer",
+    [THREAD_RING] = "ring",
+    [THREAD_SOCKET] = "socket",
+    [THREAD_BACKGROUND] = "background",
+    [THREAD_INPUT] = "input",
+    [THREAD_PSI] = "psi",
+};
+
+static struct thread_sched scheds[THREAD_MAX];
+// What thread_sched_apply() got for every thread: 0, or the first -errno
+static int sched_results[THREAD_MAX];
+static bool sched_applied[THREAD_MAX];
+
+static struct timer_latency timer_latency;
+
+static int find_thread(const char *name)
+{
+    for (int i = 0; i < THREAD_MAX; i++) {
+        if (strcmp(thread_names[i], name) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+// Forget the <thread> elements of a resource file read before
+void thread_sched_reset(void)
+{
+    memset(scheds, 0, sizeof(scheds));
+}
+
+/**
+ * thread_sched_parse - record the attributes of a <thread> element
+ * return: 1 on success, 0 if the element is incorrect
+ */
+int thread_sched_parse(const char *name, const char *nice, const char *cpus, const char *timer_slack_ns)
+{
+    struct thread_sched *sched = NULL;
+    int thread = (name == NULL)? -1: find_thread(name);
+
+    if (thread < 0) {
+        ALOGE("!!!Don't support thread %s", name);
+        return 0;
+    }
+
+    sched = &scheds[thread];
+    memset(sched, 0, sizeof(*sched));
+    sched->nice = (nice == NULL)? 0: atoi(nice);
+    if (cpus != NULL)
+        strncpy(sched->cpus, cpus, LEN_THREAD_CPUS_MAX - 1);
+    sched->timer_slack_ns = (timer_slack_ns == NULL)? 0: atol(timer_slack_ns);
+    sched->configured = true;
+
+    return 1;
+}
+
+/*
+ * Parse a CPU list as sysfs prints it, "0-3", "0,2" or "0 1 2 3"
+ * return: the number of CPUs in @set
+ */
+static int parse_cpus(const char *str, cpu_set_t *set)
+{
+    char *end = NULL;
+    long first = 0;
+    long last = 0;
+
+    CPU_ZERO(set);
+    while (*str != '\0') {
+        if (*str == ' ' || *str == ',') {
+            str++;
+            continue;
+        }
+
+        first = strtol(str, &end, 10);
+        if (end == str || first < 0)
+            break;
+        last = first;
+        if (*end == '-') {
+            str = end + 1;
+            last = strtol(str, &end, 10);
+            if (end == str || last < first)
+                break;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, set);
+        str = end;
+    }
+
+    return CPU_COUNT(set);
+}
+
+static int resolve_cpus(const char *cpus, cpu_set_t *set)
+{
+    char buf[LEN_VALUE_MAX] = {'\0'};
+
+    if (strcmp(cpus, "little") != 0)
+        return parse_cpus(cpus, set);
+
+    if (sprd_read(PATH_LITTLE_CLUSTER_CPUS, buf, sizeof(buf)) != 0)
+        return 0;
+
+    return parse_cpus(buf, set);
+}
+
+/**
+ * thread_sched_apply - schedule the calling thread as its <thread> element says
+ * @thread: THREAD_*
+ */
+void thread_sched_apply(int thread)
+{
+    struct thread_sched *sched = &scheds[thread];
+    cpu_set_t set;
+    int ret = 0;
+
+    if (!sched->configured)
+        return;
+
+    if (setpriority(PRIO_PROCESS, 0, sched->nice) != 0) {
+        ALOGE("%s: set nice %d for %s fail: %s", __func__, sched->nice
+            , thread_names[thread], strerror(errno));
+        ret = -errno;
+    }
+
+    if (sched->cpus[0] != '\0') {
+        if (resolve_cpus(sched->cpus, &set) == 0) {
+            ALOGE("%s: no CPU in %s for %s", __func__, sched->cpus, thread_names[thread]);
+            if (ret == 0) ret = -EINVAL;
+        } else if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            ALOGE("%s: bind %s to %s fail: %s", __func__, thread_names[thread]
+                , sched->cpus, strerror(errno));
+            if (ret == 0) ret = -errno;
+        }
+    }
+
+    if (sched->timer_slack_ns > 0 && prctl(PR_SET_TIMERSLACK, sched->timer_slack_ns) != 0) {
+        ALOGE("%s: set timer slack of %s fail: %s", __func__, thread_names[thread], strerror(errno));
+        if (ret == 0) ret = -errno;
+    }
+
+    sched_results[thread] = ret;
+    __atomic_store_n(&sched_applied[thread], true, __ATOMIC_RELEASE);
+}
+
+/**
+ * thread_sched_timer_latency - record how late a request timeout was applied
+ * @due_ns: the deadline of the timer
+ * @wake_ns: when the timer thread woke for it
+ * @apply_ns: when the expired request was written
+ */
+void thread_sched_timer_latency(int64_t due_ns, int64_t wake_ns, int64_t apply_ns)
+{
+    // A timer re-armed while its signal was pending expires later
+    if (wake_ns < due_ns)
+        return;
+
+    hist_add(&timer_latency.wake, (wake_ns - due_ns) / MS_TO_US);
+    hist_add(&timer_latency.apply, (apply_ns - due_ns) / MS_TO_US);
+}
+
+const struct timer_latency *thread_sched_timer_latency_get(void)
+{
+    return &timer_latency;
+}
+
+int thread_sched_dump(int fd)
+{
+    struct thread_sched *sched = NULL;
+
+    dprintf(fd, "# Worker threads: thread nice cpus timer_slack_ns state\n");
+    for (int i = 0; i < THREAD_MAX; i++) {
+        sched = &scheds[i];
+        if (!sched->configured)
+            continue;
+
+        dprintf(fd, "%s %d %s %ld ", thread_names[i], sched->nice
+            , (sched->cpus[0] != '\0')? sched->cpus: "any"
+            , sched->timer_slack_ns);
+        if (!__atomic_load_n(&sched_applied[i], __ATOMIC_ACQUIRE))
+            dprintf(fd, "not-started\n");
+        else if (sched_results[i] != 0)
+            dprintf(fd, "partial(%s)\n", strerror(-sched_results[i]));
+        else
+            dprintf(fd, "applied\n");
+    }
+
+    dprintf(fd, "# Request timeout latency past the deadline\n");
+    hist_dump(fd, "wake", &timer_latency.wake);
+    hist_dump(fd, "apply", &timer_latency.apply);
+
+    return 0;
+}
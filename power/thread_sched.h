@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INCLUDE_POWER_THREAD_SCHED_H
+#define INCLUDE_POWER_THREAD_SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stats.h"
+
+#define RESOURCE_THREAD_PATH              "/resources/thread"
+// The CPUs of the cluster of cpu0, what cpus="little" stands for
+#define PATH_LITTLE_CLUSTER_CPUS          "/sys/devices/system/cpu/cpu0/cpufreq/related_cpus"
+
+#define LEN_THREAD_CPUS_MAX               32
+
+enum {
+    THREAD_TIMER = 0,
+    THREAD_RING,
+    THREAD_SOCKET,
+    THREAD_BACKGROUND,
+    THREAD_INPUT,
+    THREAD_PSI,
+    THREAD_MAX,
+};
+
+/**
+ * struct thread_sched - how a HAL worker thread is scheduled
+ * @configured: a <thread> element names the thread, else it is left as created
+ * @nice: the nice level
+ * @cpus: the CPU list the thread runs on, "little" for the cluster of
+ *        cpu0, empty for any CPU
+ * @timer_slack_ns: the timer slack of the thread, 0 to keep the default
+ */
+struct thread_sched {
+    bool configured;
+    int nice;
+    char cpus[LEN_THREAD_CPUS_MAX];
+    long timer_slack_ns;
+};
+
+/**
+ * struct timer_latency - how late request timeouts are applied
+ * @wake: from the deadline to the timer thread running
+ * @apply: from the deadline to the expired request being written
+ */
+struct timer_latency {
+    struct hist wake;
+    struct hist apply;
+};
+
+/*
+ * The worker threads of the HAL read their scheduling from the <thread>
+ * elements of the resource file, e.g.
+ *
+ *   <thread name="timer" nice="-10" cpus="little" timer_slack_ns="50000" />
+ *
+ * name is timer, ring, socket, background, input or psi. There is no
+ * real-time policy: SCHED_FIFO takes CAP_SYS_NICE, which the HAL
+ * service doesn't have, while init's RLIMIT_NICE lets it lower the
+ * nice level down to -20. Every thread calls thread_sched_apply() on
+ * itself once it starts; a thread with no element keeps the scheduling
+ * it was created with.
+ */
+void thread_sched_reset(void);
+int thread_sched_parse(const char *name, const char *nice, const char *cpus, const char *timer_slack_ns);
+void thread_sched_apply(int thread);
+void thread_sched_timer_latency(int64_t due_ns, int64_t wake_ns, int64_t apply_ns);
+const struct timer_latency *thread_sched_timer_latency_get(void);
+int thread_sched_dump(int fd);
+#endif
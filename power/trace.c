@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "trace.h"
+
+#define LEN_TRACE_MSG_MAX                 256
+
+int trace_marker_fd = -1;
+
+/**
+ * trace_init - open and cache the trace_marker fd if tracing is enabled
+ */
+void trace_init(void)
+{
+    if (trace_marker_fd >= 0 || property_get_int32(POWER_HINT_TRACE_PROP, 0) == 0)
+        return;
+
+    trace_marker_fd = open(PATH_TRACE_MARKER, O_WRONLY | O_CLOEXEC);
+    if (trace_marker_fd < 0)
+        trace_marker_fd = open(PATH_TRACE_MARKER_DEBUGFS, O_WRONLY | O_CLOEXEC);
+
+    if (trace_marker_fd < 0)
+        ALOGE("open trace_marker failed: %s", strerror(errno));
+    else
+        ALOGD("Power HAL trace markers enabled");
+}
+
+static void trace_write(const char *msg, int len)
+{
+    if (len <= 0) return;
+    if (len >= LEN_TRACE_MSG_MAX)
+        len = LEN_TRACE_MSG_MAX - 1;
+
+    write(trace_marker_fd, msg, len);
+}
+
+void trace_begin(const char *fmt, ...)
+{
+    char msg[LEN_TRACE_MSG_MAX];
+    int len = 0;
+    va_list ap;
+
+    len = snprintf(msg, sizeof(msg), "B|%d|", getpid());
+    va_start(ap, fmt);
+    len += vsnprintf(msg + len, sizeof(msg) - len, fmt, ap);
+    va_end(ap);
+
+    trace_write(msg, len);
+}
+
+void trace_end(void)
+{
+    char msg[16];
+
+    trace_write(msg, snprintf(msg, sizeof(msg), "E|%d", getpid()));
+}
+
+/**
+ * trace_counter - emit the effective value of a node
+ * @name: the counter name, the full node path
+ * @value: the value string written to the node
+ * @base: the base of @value, 16 for the hex frequency nodes
+ */
+void trace_counter(const char *name, const char *value, int base)
+{
+    char msg[LEN_TRACE_MSG_MAX];
+
+    trace_write(msg, snprintf(msg, sizeof(msg), "C|%d|%s|%lld", getpid(), name
+        , (value != NULL)? strtoll(value, NULL, base): 0));
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_TRACE_H
+#define INCLUDE_POWER_TRACE_H
+
+#include <cutils/compiler.h>
+
+#define POWER_HINT_TRACE_PROP             "persist.vendor.power.trace"
+#define PATH_TRACE_MARKER                 "/sys/kernel/tracing/trace_marker"
+#define PATH_TRACE_MARKER_DEBUGFS         "/sys/kernel/debug/tracing/trace_marker"
+
+// Build with -DPOWER_TRACE=0 to remove every marker from the binary
+#ifndef POWER_TRACE
+#define POWER_TRACE                       1
+#endif
+
+// The cached trace_marker fd, -1 if tracing is disabled
+extern int trace_marker_fd;
+
+void trace_init(void);
+void trace_begin(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void trace_end(void);
+void trace_counter(const char *name, const char *value, int base);
+
+#if POWER_TRACE
+#define TRACE_ENABLED()                   CC_UNLIKELY(trace_marker_fd >= 0)
+#define TRACE_BEGIN(fmt, ...) \
+    do { if (TRACE_ENABLED()) trace_begin(fmt, ##__VA_ARGS__); } while (0)
+#define TRACE_END() \
+    do { if (TRACE_ENABLED()) trace_end(); } while (0)
+#define TRACE_COUNTER(name, value, base) \
+    do { if (TRACE_ENABLED()) trace_counter(name, value, base); } while (0)
+#else
+#define TRACE_ENABLED()                   0
+#define TRACE_BEGIN(fmt, ...)             do { } while (0)
+#define TRACE_END()                       do { } while (0)
+#define TRACE_COUNTER(name, value, base)  do { } while (0)
+#endif
+
+#endif
@@ -29,6 +29,9 @@
 #include <utils/Log.h>
 
 #include "utils.h"
+#include "stats.h"
+#include "trace.h"
+#include "vfs.h"
 
 long long calc_timespan_ms(struct timespec start, struct timespec end)
 {
@@ -54,7 +57,7 @@ void sprd_strftime(char *buf, int size, struct timespec ts)
         return;
     }
 
-    clock_gettime(CLOCK_MONOTONIC, &now_monotonic);
+    clock_monotonic(&now_monotonic);
     clock_gettime(CLOCK_REALTIME, &now_real);
 
     now_real.tv_sec += (ts.tv_sec - now_monotonic.tv_sec);
@@ -77,22 +80,28 @@ void sprd_write(const char *path, const char *s)
 {
     int len;
     int fd = -1;
+    int64_t start = stats_io_begin();
 
     ALOGD_IF(DEBUG_V, "##Enter %s:%s" , __func__, path);
-    fd = open(path, O_WRONLY);
+    TRACE_BEGIN("write %s=%s", path, s);
+    fd = vfs_open(path, O_WRONLY);
 
     if (fd < 0) {
         ALOGE("Error opening %s: %s\n", path, strerror(errno));
+        stats_io_end(start);
+        TRACE_END();
         return;
     }
 
     ALOGD_IF(DEBUG_V, "Open() completed!");
-    len = write(fd, s, strlen(s));
+    len = vfs_write(fd, s, strlen(s));
     if (len < 0) {
         ALOGE("Error writing to %s: %s\n", path, strerror(errno));
     }
 
-    close(fd);
+    vfs_close(fd);
+    stats_io_end(start);
+    TRACE_END();
     ALOGD_IF(DEBUG_V, "##Exit %s:%s" , __func__, path);
 }
 
@@ -100,14 +109,14 @@ int sprd_read(const char *path, char *s, int size)
 {
     int count;
     int ret = 0;
-    int fd = open(path, O_RDONLY);
+    int fd = vfs_open(path, O_RDONLY);
 
     if (fd < 0) {
         ALOGE("Error opening %s: %s\n", path, strerror(errno));
         return -1;
     }
 
-    if ((count = read(fd, s, size - 1)) < 0) {
+    if ((count = vfs_read(fd, s, size - 1)) < 0) {
         ALOGE("Error writing to %s: %s\n", path, strerror(errno));
         ret = -1;
     } else {
@@ -117,7 +126,7 @@ int sprd_read(const char *path, char *s, int size)
             s[count] = '\0';
     }
 
-    close(fd);
+    vfs_close(fd);
 
     return ret;
 }
@@ -135,6 +144,11 @@ void sprd_timer_create(int signo, timer_t *timer_id, int tid)
 {
     struct sigevent sev;
 
+    if (CC_UNLIKELY(clock_is_virtual())) {
+        clock_timer_create(timer_id);
+        return;
+    }
+
     sev.sigev_notify = SIGEV_THREAD_ID;
     sev.sigev_signo = signo;
     sev.sigev_value.sival_ptr = timer_id;
@@ -153,6 +167,11 @@ void sprd_timer_settime(timer_t timer_id, long long value)
     if (DEBUG_V)
         ALOGD("set timerid=0x%lx, value=%lld", (long)timer_id, value);
 
+    if (CC_UNLIKELY(clock_is_virtual())) {
+        clock_timer_settime(timer_id, value);
+        return;
+    }
+
     memset(&its, 0, sizeof(struct itimerspec));
     its.it_value.tv_sec = value / SEC_TO_MS;
     its.it_value.tv_nsec = (value % SEC_TO_MS) * MS_TO_NS;
@@ -21,8 +21,20 @@
 #include <string.h>
 #include <linux/time.h>
 
-#define ENTER(x,...)                    ALOGD("Enter %s: " x, __func__, ##__VA_ARGS__)
-#define EXIT(x,...)                     ALOGD("Exit %s: " x, __func__, ##__VA_ARGS__)
+#include "clock.h"
+#include "recorder.h"
+
+// Recorded by the flight recorder, only logged when DEBUG_V is set
+#define ENTER(x,...) \
+    do { \
+        flight_record(FR_EV_ENTER, __func__, FR_NODE_NONE, 0); \
+        ALOGD_IF(DEBUG_V, "Enter %s: " x, __func__, ##__VA_ARGS__); \
+    } while (0)
+#define EXIT(x,...) \
+    do { \
+        flight_record(FR_EV_EXIT, __func__, FR_NODE_NONE, 0); \
+        ALOGD_IF(DEBUG_V, "Exit %s: " x, __func__, ##__VA_ARGS__); \
+    } while (0)
 
 #define STR(x)                          #x
 #define MACOR_VALUE_TO_STR2(x)          STR(x)
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cutils/compiler.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "vfs.h"
+
+static char vfs_root[LEN_VFS_PATH_MAX] = {'\0'};
+static struct vfs_fault faults[NUM_VFS_FAULT_MAX];
+static int fault_count = 0;
+// The fault matched when an fd was opened plus 1, indexed by fd. Atomic
+// as the fds closed by one thread are reused by another
+static signed char fd_faults[NUM_VFS_FD_MAX];
+static struct vfs_stats vfs_stats;
+// The writes of the calling thread, files are set concurrently
+static __thread uint64_t thread_writes = 0;
+
+/**
+ * vfs_set_root - resolve all paths under @root, NULL or "" for the real fs
+ */
+void vfs_set_root(const char *root)
+{
+    memset(vfs_root, 0, sizeof(vfs_root));
+    if (root != NULL)
+        strncpy(vfs_root, root, sizeof(vfs_root) - 1);
+    if (strlen(vfs_root) > 0 && vfs_root[strlen(vfs_root) - 1] == '/')
+        vfs_root[strlen(vfs_root) - 1] = '\0';
+}
+
+const char *vfs_get_root(void)
+{
+    return vfs_root;
+}
+
+/**
+ * vfs_path - the real path of @path, @buf is only used if a root is set
+ */
+const char *vfs_path(const char *path, char *buf, int size)
+{
+    if (CC_LIKELY(vfs_root[0] == '\0') || path == NULL)
+        return path;
+
+    snprintf(buf, size, "%s%s", vfs_root, path);
+    return buf;
+}
+
+// Apply the first fault matching @path and @op, return its index or -1
+static int find_fault(const char *path, int op)
+{
+    for (int i = 0; i < fault_count; i++) {
+        if ((faults[i].ops & op) && strstr(path, faults[i].match) != NULL)
+            return i;
+    }
+
+    return -1;
+}
+
+// Inject the fault @index for @op, return -1 with errno set if it fails the op
+static int inject_fault(int index, int op)
+{
+    if (index < 0 || !(faults[index].ops & op))
+        return 0;
+    if (faults[index].count > 0
+        && __atomic_fetch_add(&faults[index].hits, 1, __ATOMIC_RELAXED) >= faults[index].count)
+        return 0;
+
+    __atomic_fetch_add(&vfs_stats.faults, 1, __ATOMIC_RELAXED);
+    if (faults[index].latency_us > 0)
+        usleep(faults[index].latency_us);
+    if (faults[index].error != 0) {
+        errno = faults[index].error;
+        return -1;
+    }
+
+    return 0;
+}
+
+int vfs_open(const char *path, int flags, ...)
+{
+    char buf[LEN_VFS_PATH_MAX];
+    int fault = -1;
+    mode_t mode = 0;
+    int fd = -1;
+
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = (mode_t)va_arg(ap, int);
+        va_end(ap);
+    }
+
+    __atomic_fetch_add(&vfs_stats.opens, 1, __ATOMIC_RELAXED);
+    if (CC_UNLIKELY(fault_count > 0)) {
+        fault = find_fault(path, VFS_OP_OPEN | VFS_OP_READ | VFS_OP_WRITE);
+        if (inject_fault(fault, VFS_OP_OPEN) < 0)
+            return -1;
+    }
+
+    fd = open(vfs_path(path, buf, sizeof(buf)), flags, mode);
+    if (fd >= 0 && fd < NUM_VFS_FD_MAX)
+        __atomic_store_n(&fd_faults[fd], fault + 1, __ATOMIC_RELAXED);
+
+    return fd;
+}
+
+int vfs_access(const char *path, int mode)
+{
+    char buf[LEN_VFS_PATH_MAX];
+
+    return access(vfs_path(path, buf, sizeof(buf)), mode);
+}
+
+FILE *vfs_fopen(const char *path, const char *mode)
+{
+    char buf[LEN_VFS_PATH_MAX];
+
+    return fopen(vfs_path(path, buf, sizeof(buf)), mode);
+}
+
+ssize_t vfs_read(int fd, void *buf, size_t count)
+{
+    __atomic_fetch_add(&vfs_stats.reads, 1, __ATOMIC_RELAXED);
+    if (CC_UNLIKELY(fault_count > 0) && fd >= 0 && fd < NUM_VFS_FD_MAX
+        && inject_fault(__atomic_load_n(&fd_faults[fd], __ATOMIC_RELAXED) - 1, VFS_OP_READ) < 0)
+        return -1;
+
+    return read(fd, buf, count);
+}
+
+ssize_t vfs_write(int fd, const void *buf, size_t count)
+{
+    __atomic_fetch_add(&vfs_stats.writes, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&vfs_stats.write_bytes, count, __ATOMIC_RELAXED);
+    thread_writes++;
+    if (CC_UNLIKELY(fault_count > 0) && fd >= 0 && fd < NUM_VFS_FD_MAX
+        && inject_fault(__atomic_load_n(&fd_faults[fd], __ATOMIC_RELAXED) - 1, VFS_OP_WRITE) < 0)
+        return -1;
+
+    // A fake node is a regular file, keep only the last value like sysfs
+    if (CC_UNLIKELY(vfs_root[0] != '\0')) {
+        ssize_t len = pwrite(fd, buf, count, 0);
+        if (len >= 0)
+            ftruncate(fd, len);
+        return len;
+    }
+
+    return write(fd, buf, count);
+}
+
+int vfs_close(int fd)
+{
+    __atomic_fetch_add(&vfs_stats.closes, 1, __ATOMIC_RELAXED);
+    if (fd >= 0 && fd < NUM_VFS_FD_MAX)
+        __atomic_store_n(&fd_faults[fd], 0, __ATOMIC_RELAXED);
+
+    return close(fd);
+}
+
+/**
+ * vfs_add_fault - inject latency and/or an error into the I/O of matching paths
+ * @count: only into the first @count operations, 0 for all of them
+ * return: 1 if sucessfull, else 0
+ */
+int vfs_add_fault(const char *match, int ops, int error, int latency_us, int count)
+{
+    struct vfs_fault *fault = NULL;
+
+    if (match == NULL || fault_count >= NUM_VFS_FAULT_MAX)
+        return 0;
+
+    fault = &faults[fault_count];
+    memset(fault, 0, sizeof(*fault));
+    strncpy(fault->match, match, LEN_VFS_MATCH_MAX - 1);
+    fault->ops = ops;
+    fault->error = error;
+    fault->latency_us = latency_us;
+    fault->count = count;
+    fault_count++;
+
+    return 1;
+}
+
+void vfs_clear_faults(void)
+{
+    fault_count = 0;
+    memset(faults, 0, sizeof(faults));
+    memset(fd_faults, 0, sizeof(fd_faults));
+}
+
+/**
+ * vfs_thread_writes - the writes issued by the calling thread so far
+ */
+uint64_t vfs_thread_writes(void)
+{
+    return thread_writes;
+}
+
+void vfs_get_stats(struct vfs_stats *stats)
+{
+    stats->opens = __atomic_load_n(&vfs_stats.opens, __ATOMIC_RELAXED);
+    stats->closes = __atomic_load_n(&vfs_stats.closes, __ATOMIC_RELAXED);
+    stats->reads = __atomic_load_n(&vfs_stats.reads, __ATOMIC_RELAXED);
+    stats->writes = __atomic_load_n(&vfs_stats.writes, __ATOMIC_RELAXED);
+    stats->write_bytes = __atomic_load_n(&vfs_stats.write_bytes, __ATOMIC_RELAXED);
+    stats->faults = __atomic_load_n(&vfs_stats.faults, __ATOMIC_RELAXED);
+}
+
+void vfs_reset_stats(void)
+{
+    memset(&vfs_stats, 0, sizeof(vfs_stats));
+}
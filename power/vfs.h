@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_POWER_VFS_H
+#define INCLUDE_POWER_VFS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LEN_VFS_PATH_MAX                  256
+#define LEN_VFS_MATCH_MAX                 64
+#define NUM_VFS_FAULT_MAX                 8
+#define NUM_VFS_FD_MAX                    1024
+
+enum {
+    VFS_OP_OPEN = 1 << 0,
+    VFS_OP_READ = 1 << 1,
+    VFS_OP_WRITE = 1 << 2,
+};
+
+/**
+ * struct vfs_fault - latency or error injected into matching I/O
+ * @match: substring of the absolute path the fault applies to
+ * @ops: the operations affected, VFS_OP_*
+ * @error: errno returned by the operation, 0 to only add latency
+ * @latency_us: delay added before the operation
+ * @count: how many operations it applies to, 0 for all of them
+ * @hits: the operations it applied to so far
+ */
+struct vfs_fault {
+    char match[LEN_VFS_MATCH_MAX];
+    int ops;
+    int error;
+    int latency_us;
+    int count;
+    int hits;
+};
+
+/**
+ * struct vfs_stats - I/O issued through the vfs since the last reset
+ */
+struct vfs_stats {
+    uint64_t opens;
+    uint64_t closes;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t write_bytes;
+    uint64_t faults;
+};
+
+/*
+ * All node and config I/O of the HAL goes through these calls. Paths
+ * are absolute device paths; when a root is set they are resolved
+ * under it, so the HAL core can run against a fake node tree.
+ */
+void vfs_set_root(const char *root);
+const char *vfs_get_root(void);
+const char *vfs_path(const char *path, char *buf, int size);
+
+int vfs_open(const char *path, int flags, ...);
+int vfs_access(const char *path, int mode);
+FILE *vfs_fopen(const char *path, const char *mode);
+ssize_t vfs_read(int fd, void *buf, size_t count);
+ssize_t vfs_write(int fd, const void *buf, size_t count);
+int vfs_close(int fd);
+
+int vfs_add_fault(const char *match, int ops, int error, int latency_us, int count);
+void vfs_clear_faults(void);
+uint64_t vfs_thread_writes(void);
+void vfs_get_stats(struct vfs_stats *stats);
+void vfs_reset_stats(void);
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cutils/properties.h>
+
+#define LOG_TAG "PowerHAL"
+#include <utils/Log.h>
+
+#include "common.h"
+#include "utils.h"
+#include "vfs.h"
+#include "write_latency.h"
+
+bool write_latency_profile = false;
+
+static struct node_write_latency nodes[NUM_WRITE_LATENCY_NODE_MAX];
+static int64_t last_flush_ns = 0;
+// Saves the averages on the timer thread, off the HAL lock
+static timer_t flush_timer;
+
+static void flush_timeout(void)
+{
+    write_latency_flush_file();
+}
+
+// Seed the averages from PATH_WRITE_LATENCY, "<node> <ewma_us> ..." per line
+static void load_file(void)
+{
+    char line[LEN_PATH_MAX + LEN_FILE_MAX + 64] = {'\0'};
+    char node[LEN_PATH_MAX + LEN_FILE_MAX + 2] = {'\0'};
+    char buf[LEN_PATH_MAX + LEN_FILE_MAX + 2] = {'\0'};
+    unsigned long long ewma_us = 0;
+    struct file *file = NULL;
+    FILE *fp = NULL;
+    int loaded = 0;
+
+    fp = vfs_fopen(PATH_WRITE_LATENCY, "r");
+    if (fp == NULL)
+        return;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%91s %llu", node, &ewma_us) != 2)
+            continue;
+
+        for (int i = 0; i < resources.count; i++) {
+            for (int j = 0; j < resources.path_files[i].count; j++) {
+                file = &(resources.path_files[i].files[j]);
+                snprintf(buf, sizeof(buf), "%s/%s", resources.path_files[i].path, file->name);
+                if (strcmp(buf, node) == 0 && file->id >= 0 && file->id < NUM_WRITE_LATENCY_NODE_MAX) {
+                    nodes[file->id].ewma_ns = ewma_us * MS_TO_US;
+                    loaded++;
+                }
+            }
+        }
+    }
+    fclose(fp);
+
+    ALOGD("Load write latency of %d nodes", loaded);
+}
+
+/**
+ * write_latency_init - load the saved write latencies, called after config_read()
+ * and before start_thread_for_timing_request()
+ */
+void write_latency_init(void)
+{
+    memset(nodes, 0, sizeof(nodes));
+    write_latency_profile = property_get_int32(POWER_WRITE_PROFILE_PROP, 0) != 0;
+    last_flush_ns = stats_now_ns();
+    load_file();
+    if (write_latency_profile)
+        add_timing_timer(&flush_timer, flush_timeout);
+    ALOGD_IF(write_latency_profile, "Power HAL write latency profile enabled");
+}
+
+/**
+ * write_latency_begin - start timing a set call if profiling
+ * @writes: returns the node writes issued by this thread so far
+ * return: the start time, 0 if not profiling
+ */
+int64_t write_latency_begin(uint64_t *writes)
+{
+    if (CC_LIKELY(!write_latency_profile))
+        return 0;
+
+    *writes = vfs_thread_writes();
+    return stats_now_ns();
+}
+
+/**
+ * write_latency_end - account the set call of @file started at @start
+ * @writes: what write_latency_begin() returned in @writes
+ *
+ * A call that wrote nothing, e.g. because a higher request is in force,
+ * says nothing about the node and is dropped.
+ */
+void write_latency_end(const struct file *file, int64_t start, uint64_t writes)
+{
+    struct node_write_latency *node = NULL;
+    uint64_t count = 0;
+    int64_t last = 0;
+    int64_t now = 0;
+    int64_t ns = 0;
+
+    if (CC_LIKELY(start == 0) || file == NULL || file->id < 0 || file->id >= NUM_WRITE_LATENCY_NODE_MAX)
+        return;
+
+    count = vfs_thread_writes() - writes;
+    if (count == 0)
+        return;
+
+    now = stats_now_ns();
+    ns = (now - start) / count;
+    node = &nodes[file->id];
+    hist_add(&node->hist, ns / MS_TO_US);
+    if (node->ewma_ns == 0)
+        node->ewma_ns = ns;
+    else
+        node->ewma_ns += (ns - (int64_t)node->ewma_ns) >> WRITE_LATENCY_EWMA_SHIFT;
+
+    // Files are set concurrently, one of them arms the flush
+    last = __atomic_load_n(&last_flush_ns, __ATOMIC_RELAXED);
+    if (now - last > WRITE_LATENCY_FLUSH_INTERVAL_MS * MS_TO_NS
+        && __atomic_compare_exchange_n(&last_flush_ns, &last, now, false
+            , __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        sprd_timer_settime(flush_timer, 1);
+}
+
+static uint64_t cost(const struct boost_entry *entry)
+{
+    int id = entry->file->id;
+
+    return (id >= 0 && id < NUM_WRITE_LATENCY_NODE_MAX)? nodes[id].ewma_ns: 0;
+}
+
+/**
+ * write_latency_sort - order @entries by ascending write latency
+ *
+ * Stable, so nodes of unknown latency keep the order of the config.
+ */
+void write_latency_sort(struct boost_entry *entries, int count)
+{
+    struct boost_entry entry;
+    int j = 0;
+
+    for (int i = 1; i < count; i++) {
+        entry = entries[i];
+        for (j = i - 1; j >= 0 && cost(&entries[j]) > cost(&entry); j--)
+            entries[j + 1] = entries[j];
+        entries[j + 1] = entry;
+    }
+}
+
+int write_latency_dump(int fd)
+{
+    struct node_write_latency *node = NULL;
+    struct file *file = NULL;
+
+    dprintf(fd, "# Write latency per node%s: node ewma_us p50_us p99_us max_us count\n"
+        , write_latency_profile? "": " (profile disabled)");
+    for (int i = 0; i < resources.count; i++) {
+        for (int j = 0; j < resources.path_files[i].count; j++) {
+            file = &(resources.path_files[i].files[j]);
+            if (file->id < 0 || file->id >= NUM_WRITE_LATENCY_NODE_MAX)
+                continue;
+
+            node = &nodes[file->id];
+            if (node->ewma_ns == 0)
+                continue;
+
+            dprintf(fd, "%s/%s %llu %llu %llu %llu %llu\n", resources.path_files[i].path, file->name
+                , (unsigned long long)(node->ewma_ns / MS_TO_US)
+                , (unsigned long long)hist_percentile(&node->hist, 50)
+                , (unsigned long long)hist_percentile(&node->hist, 99)
+                , (unsigned long long)node->hist.max_us
+                , (unsigned long long)node->hist.count);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * write_latency_flush_file - save the write latencies to PATH_WRITE_LATENCY
+ */
+void write_latency_flush_file(void)
+{
+    int fd = -1;
+
+    __atomic_store_n(&last_flush_ns, stats_now_ns(), __ATOMIC_RELAXED);
+    fd = vfs_open(PATH_WRITE_LATENCY, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        ALOGD_IF(DEBUG_V, "open %s failed: %s", PATH_WRITE_LATENCY, strerror(errno));
+        return;
+    }
+    write_latency_dump(fd);
+    vfs_close(fd);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INCLUDE_POWER_WRITE_LATENCY_H
+#define INCLUDE_POWER_WRITE_LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stats.h"
+
+struct file;
+struct boost_entry;
+
+#define POWER_WRITE_PROFILE_PROP          "persist.vendor.power.write_profile"
+#define PATH_WRITE_LATENCY                "/data/vendor/power/write_latency.txt"
+#define WRITE_LATENCY_FLUSH_INTERVAL_MS   60000L
+
+#define NUM_WRITE_LATENCY_NODE_MAX        64
+// The weight of a new sample in the moving average is 1/(1 << WRITE_LATENCY_EWMA_SHIFT)
+#define WRITE_LATENCY_EWMA_SHIFT          3
+
+/**
+ * struct node_write_latency - the write cost of one resource file
+ * @ewma_ns: moving average of the time a set call spends per node write
+ * @hist: the profiled samples in microseconds
+ */
+struct node_write_latency {
+    uint64_t ewma_ns;
+    struct hist hist;
+};
+
+// Whether persist.vendor.power.write_profile is set
+extern bool write_latency_profile;
+
+/*
+ * With the profile enabled every set call of _boost() that writes is
+ * timed per resource file, and the averages are saved to
+ * PATH_WRITE_LATENCY by the timer thread at most every
+ * WRITE_LATENCY_FLUSH_INTERVAL_MS. The saved
+ * averages are loaded at init whether or not profiling is on, and
+ * _boost() applies the nodes of a scene fastest first so quick cpufreq
+ * writes don't wait behind slow governor or hotplug writes.
+ * All calls but write_latency_init() are made with the HAL lock held, and
+ * write_latency_end() with the lock of the file too.
+ */
+void write_latency_init(void);
+int64_t write_latency_begin(uint64_t *writes);
+void write_latency_end(const struct file *file, int64_t start, uint64_t writes);
+void write_latency_sort(struct boost_entry *entries, int count);
+int write_latency_dump(int fd);
+void write_latency_flush_file(void);
+#endif